@@ -25,6 +25,17 @@ bool InputStreamDevice::Peek(char& ch) const
     return peek(ch);
 }
 
+bool InputStreamDevice::TryGetBufferView(bufferview& view) const
+{
+    EnsureAccess(DeviceAccess::Read);
+    return tryGetBufferView(view);
+}
+
+bool InputStreamDevice::tryGetBufferView(bufferview&) const
+{
+    return false;
+}
+
 void InputStreamDevice::checkRead() const
 {
     EnsureAccess(DeviceAccess::Read);
@@ -10,6 +10,7 @@
 #include <istream>
 #include <fstream>
 
+#include "basetypes.h"
 #include "StreamDeviceBase.h"
 #include "InputStream.h"
 
@@ -31,12 +32,26 @@ public:
      */
     bool Peek(char& ch) const;
 
+    /** Get a view of the whole device content, if it is
+     * backed by a single contiguous memory buffer
+     * \param view the view on the content. It stays valid
+     * as long as the device is not modified or destroyed
+     * \returns true if the device content is contiguous in memory
+     * \remarks the view is not affected by the current position
+     */
+    bool TryGetBufferView(bufferview& view) const;
+
 protected:
     /** Peek at next char in stream.
      *  /returns true if success, false if EOF
      */
     virtual bool peek(char& ch) const = 0;
 
+    /** Get a view of the whole device content
+     * \remarks the default implementation returns false
+     */
+    virtual bool tryGetBufferView(bufferview& view) const;
+
     void checkRead() const override;
 };
 
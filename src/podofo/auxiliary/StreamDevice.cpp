@@ -11,6 +11,16 @@
 
 #include <podofo/private/FileSystem.h>
 
+#ifdef _WIN32
+#include <podofo/private/WindowsLeanMean.h>
+#include <podofo/private/utfcpp_extensions.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // _WIN32
+
 using namespace std;
 using namespace PoDoFo;
 
@@ -86,6 +96,8 @@ void seek(TStream& stream, ssize_t pos, SeekDirection direction)
 }
 
 static FILE* createFile(const string_view& filename, FileMode mode, DeviceAccess access);
+static const char* mapFile(const string_view& filename, size_t& length);
+static void unmapFile(const char* buffer, size_t length);
 
 StreamDevice::StreamDevice(DeviceAccess access)
     : InputStreamDevice(false), OutputStreamDevice(false)
@@ -553,6 +565,105 @@ void FileStreamDevice::close()
     m_file = nullptr;
 }
 
+MmapStreamDevice::MmapStreamDevice(const string_view& filepath)
+    : StreamDevice(DeviceAccess::Read), m_Position(0), m_Filepath(filepath)
+{
+    m_buffer = mapFile(filepath, m_Length);
+}
+
+MmapStreamDevice::~MmapStreamDevice()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+        // Do nothing, it should not throw
+    }
+}
+
+size_t MmapStreamDevice::GetLength() const
+{
+    return m_Length;
+}
+
+size_t MmapStreamDevice::GetPosition() const
+{
+    return m_Position;
+}
+
+bool MmapStreamDevice::CanSeek() const
+{
+    return true;
+}
+
+bool MmapStreamDevice::Eof() const
+{
+    return m_Position == m_Length;
+}
+
+void MmapStreamDevice::writeBuffer(const char*, size_t)
+{
+    PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "A memory mapped file device is read-only");
+}
+
+size_t MmapStreamDevice::readBuffer(char* buffer, size_t size, bool& eof)
+{
+    size_t readCount = std::min(size, m_Length - m_Position);
+    std::memcpy(buffer, m_buffer + m_Position, readCount);
+    m_Position += readCount;
+    eof = m_Position == m_Length;
+    return readCount;
+}
+
+bool MmapStreamDevice::readChar(char& ch)
+{
+    if (m_Position == m_Length)
+    {
+        ch = '\0';
+        return false;
+    }
+
+    ch = m_buffer[m_Position];
+    m_Position++;
+    return true;
+}
+
+bool MmapStreamDevice::peek(char& ch) const
+{
+    if (m_Position == m_Length)
+    {
+        ch = '\0';
+        return false;
+    }
+
+    ch = m_buffer[m_Position];
+    return true;
+}
+
+bool MmapStreamDevice::tryGetBufferView(bufferview& view) const
+{
+    view = bufferview(m_buffer, m_Length);
+    return true;
+}
+
+void MmapStreamDevice::seek(ssize_t offset, SeekDirection direction)
+{
+    m_Position = SeekPosition(m_Position, m_Length, offset, direction);
+}
+
+void MmapStreamDevice::close()
+{
+    if (m_buffer == nullptr)
+        return;
+
+    unmapFile(m_buffer, m_Length);
+    m_buffer = nullptr;
+    m_Length = 0;
+    m_Position = 0;
+}
+
 NullStreamDevice::NullStreamDevice()
     : StreamDevice(DeviceAccess::ReadWrite), m_Length(0), m_Position(0)
 {
@@ -714,11 +825,128 @@ bool SpanStreamDevice::peek(char& ch) const
     return true;
 }
 
+bool SpanStreamDevice::tryGetBufferView(bufferview& view) const
+{
+    view = bufferview(m_buffer, m_Length);
+    return true;
+}
+
 void SpanStreamDevice::seek(ssize_t offset, SeekDirection direction)
 {
     m_Position = SeekPosition(m_Position, m_Length, offset, direction);
 }
 
+AppendStreamDevice::AppendStreamDevice(shared_ptr<InputStreamDevice> base, shared_ptr<StreamDevice> tail)
+    : StreamDevice(DeviceAccess::ReadWrite), m_base(std::move(base)), m_tail(std::move(tail))
+{
+    if (m_base == nullptr || m_tail == nullptr)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "The base and tail devices must be not null");
+
+    if (!m_base->CanSeek() || !m_tail->CanSeek())
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::NotImplemented, "The base and tail devices must be seekable");
+
+    m_BaseLength = m_base->GetLength();
+    m_Position = m_BaseLength + m_tail->GetLength();
+}
+
+size_t AppendStreamDevice::GetLength() const
+{
+    return m_BaseLength + m_tail->GetLength();
+}
+
+size_t AppendStreamDevice::GetPosition() const
+{
+    return m_Position;
+}
+
+bool AppendStreamDevice::Eof() const
+{
+    return m_Position == GetLength();
+}
+
+bool AppendStreamDevice::CanSeek() const
+{
+    return true;
+}
+
+void AppendStreamDevice::writeBuffer(const char* buffer, size_t size)
+{
+    if (m_Position < m_BaseLength)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::IOError, "Attempt to overwrite the read-only base device");
+
+    size_t tailPos = m_Position - m_BaseLength;
+    if (m_tail->GetPosition() != tailPos)
+        m_tail->Seek(tailPos);
+
+    m_tail->Write(buffer, size);
+    m_Position += size;
+}
+
+void AppendStreamDevice::flush()
+{
+    m_tail->Flush();
+}
+
+size_t AppendStreamDevice::readBuffer(char* buffer, size_t size, bool& eof)
+{
+    size_t read = 0;
+    if (m_Position < m_BaseLength)
+    {
+        if (m_base->GetPosition() != m_Position)
+            m_base->Seek(m_Position);
+
+        bool baseEof;
+        read = m_base->Read(buffer, std::min(size, m_BaseLength - m_Position), baseEof);
+        m_Position += read;
+        if (m_Position < m_BaseLength || read == size)
+        {
+            eof = false;
+            return read;
+        }
+    }
+
+    size_t tailPos = m_Position - m_BaseLength;
+    if (m_tail->GetPosition() != tailPos)
+        m_tail->Seek(tailPos);
+
+    bool tailEof;
+    size_t tailRead = m_tail->Read(buffer + read, size - read, tailEof);
+    m_Position += tailRead;
+    eof = m_Position == GetLength();
+    return read + tailRead;
+}
+
+bool AppendStreamDevice::readChar(char& ch)
+{
+    if (!peek(ch))
+        return false;
+
+    m_Position++;
+    return true;
+}
+
+bool AppendStreamDevice::peek(char& ch) const
+{
+    if (m_Position < m_BaseLength)
+    {
+        if (m_base->GetPosition() != m_Position)
+            m_base->Seek(m_Position);
+
+        return m_base->Peek(ch);
+    }
+
+    size_t tailPos = m_Position - m_BaseLength;
+    if (m_tail->GetPosition() != tailPos)
+        m_tail->Seek(tailPos);
+
+    return m_tail->Peek(ch);
+}
+
+void AppendStreamDevice::seek(ssize_t offset, SeekDirection direction)
+{
+    m_Position = SeekPosition(m_Position, GetLength(), offset, direction);
+}
+
 FILE* createFile(const string_view& filepath, FileMode mode, DeviceAccess access)
 {
     string cmode;
@@ -858,3 +1086,80 @@ FILE* createFile(const string_view& filepath, FileMode mode, DeviceAccess access
 
     return stream;
 }
+
+const char* mapFile(const string_view& filename, size_t& length)
+{
+    // NOTE: Empty files can't be mapped, just return an empty buffer
+#ifdef _WIN32
+    auto filename16 = utf8::utf8to16((string)filename);
+    HANDLE file = CreateFileW((LPCWSTR)filename16.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::IOError, "Error accessing file {}", filename);
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::IOError, "Failed to determine the length of file {}", filename);
+    }
+
+    length = (size_t)size.QuadPart;
+    if (length == 0)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    // NOTE: The view keeps the mapping alive, so handles can be closed right away
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::IOError, "Failed to map file {}", filename);
+
+    auto ret = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (ret == nullptr)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::IOError, "Failed to map file {}", filename);
+
+    return ret;
+#else
+    int fd = ::open(string(filename).c_str(), O_RDONLY);
+    if (fd == -1)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::IOError, "Error accessing file {}", filename);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        ::close(fd);
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::IOError, "Error accessing regular file {}", filename);
+    }
+
+    length = (size_t)info.st_size;
+    if (length == 0)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    // NOTE: The mapping stays valid after the descriptor is closed
+    void* ret = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ret == MAP_FAILED)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::IOError, "Failed to map file {}", filename);
+
+    return (const char*)ret;
+#endif // _WIN32
+}
+
+void unmapFile(const char* buffer, size_t length)
+{
+#ifdef _WIN32
+    (void)length;
+    if (!UnmapViewOfFile(buffer))
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::IOError, "Failed to unmap file");
+#else
+    if (::munmap(const_cast<char*>(buffer), length) != 0)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::IOError, "Failed to unmap file");
+#endif // _WIN32
+}
@@ -140,6 +140,53 @@ private:
     std::string m_Filepath;
 };
 
+/**
+ * A read-only StreamDevice that maps a whole file in memory.
+ * Reads are served directly from the mapping, so the file
+ * pages are loaded lazily by the OS and shared among all
+ * processes mapping the same file
+ * \remarks The file must not be truncated while it's mapped
+ */
+class PODOFO_API MmapStreamDevice final : public StreamDevice
+{
+public:
+    /** Map for reading the supplied filepath
+     */
+    MmapStreamDevice(const std::string_view& filepath);
+
+    ~MmapStreamDevice();
+
+public:
+    const std::string& GetFilepath() const { return m_Filepath; }
+
+    size_t GetLength() const override;
+
+    size_t GetPosition() const override;
+
+    bool CanSeek() const override;
+
+    bool Eof() const override;
+
+protected:
+    void writeBuffer(const char* buffer, size_t size) override;
+    size_t readBuffer(char* buffer, size_t size, bool& eof) override;
+    bool readChar(char& ch) override;
+    bool peek(char& ch) const override;
+    bool tryGetBufferView(bufferview& view) const override;
+    void seek(ssize_t offset, SeekDirection direction) override;
+    void close() override;
+
+private:
+    MmapStreamDevice(const MmapStreamDevice&) = delete;
+    MmapStreamDevice& operator=(const MmapStreamDevice&) = delete;
+
+private:
+    const char* m_buffer;
+    size_t m_Length;
+    size_t m_Position;
+    std::string m_Filepath;
+};
+
 template <typename TContainer>
 class ContainerStreamDevice : public StreamDevice
 {
@@ -215,6 +262,12 @@ protected:
         return true;
     }
 
+    bool tryGetBufferView(bufferview& view) const override
+    {
+        view = bufferview(m_container->data(), m_container->size());
+        return true;
+    }
+
     void seek(ssize_t offset, SeekDirection direction) override
     {
         m_Position = SeekPosition(m_Position, m_container->size(), offset, direction);
@@ -257,6 +310,7 @@ protected:
     size_t readBuffer(char* buffer, size_t size, bool& eof) override;
     bool readChar(char& ch) override;
     bool peek(char& ch) const override;
+    bool tryGetBufferView(bufferview& view) const override;
     void seek(ssize_t offset, SeekDirection direction) override;
 
 private:
@@ -268,6 +322,59 @@ private:
     size_t m_Position;
 };
 
+/**
+ * A StreamDevice that exposes a read-only base device followed
+ * by a writable tail device, as if they were a single contiguous
+ * stream. Reads are served from the base device for offsets
+ * before its length and from the tail otherwise. Writes are only
+ * allowed at or after the end of the base device and always
+ * land in the tail, so the base is never modified.
+ * This allows to perform incremental updates (eg. signing) on a
+ * document without copying it first: the resulting document is
+ * the base content concatenated with the tail content
+ * \remarks The base device length is cached at construction and
+ * must not change for the lifetime of this device
+ */
+class PODOFO_API AppendStreamDevice final : public StreamDevice
+{
+public:
+    /** Construct a device splicing the given base and tail devices
+     * \param base the read-only base device. It must be seekable
+     * \param tail the device where appended data will be written.
+     *      It must be seekable and readable
+     * \remarks the position is initially set at the end of the device
+     */
+    AppendStreamDevice(std::shared_ptr<InputStreamDevice> base,
+        std::shared_ptr<StreamDevice> tail);
+
+public:
+    /** Get the length of the base device
+     */
+    size_t GetBaseLength() const { return m_BaseLength; }
+
+    size_t GetLength() const override;
+
+    size_t GetPosition() const override;
+
+    bool Eof() const override;
+
+    bool CanSeek() const override;
+
+protected:
+    void writeBuffer(const char* buffer, size_t size) override;
+    void flush() override;
+    size_t readBuffer(char* buffer, size_t size, bool& eof) override;
+    bool readChar(char& ch) override;
+    bool peek(char& ch) const override;
+    void seek(ssize_t offset, SeekDirection direction) override;
+
+private:
+    std::shared_ptr<InputStreamDevice> m_base;
+    std::shared_ptr<StreamDevice> m_tail;
+    size_t m_BaseLength;
+    size_t m_Position;
+};
+
 /**
  * An StreamDevice device that does nothing
  */
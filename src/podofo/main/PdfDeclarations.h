@@ -490,6 +490,20 @@ enum class PdfSaveOptions
      * a regular save operation
      */
     SaveOnSigning = 64,
+    /** Pack the objects that are not streams in Flate compressed
+     * object streams, which requires a XRef stream. In incremental
+     * updates it has effect only if the document already uses
+     * XRef streams. It has no effect on PDF/A-1 documents
+     * \remarks Objects are compressed only if NoFlateCompress
+     * is not set as well
+     */
+    ObjectStreams = 128,
+    /** Serialize, compress and encrypt the objects in multiple
+     * threads. The output is identical to a serial write. It's not
+     * effective on documents with a memory budget set. The garbage
+     * collection before saving is also performed in multiple threads
+     */
+    ParallelWrite = 256,
 
     /**
       * \deprecated Use NoMetadataUpdate instead
@@ -497,6 +511,32 @@ enum class PdfSaveOptions
     NoModifyDateUpdate = NoMetadataUpdate
 };
 
+enum class PdfLoadOptions
+{
+    None = 0,
+    /** Load all the objects immediately instead of on demand
+     */
+    LoadAll = 1,
+    /** Parse the objects in multiple threads when loading all of
+     * them. It's effective only for documents read from a buffer
+     * in memory or a memory mapped file, see MemoryMap, and that
+     * are not encrypted
+     */
+    ParallelLoad = 2,
+    /** When loading from a file, read the document structure from
+     * the index file "<filename>.xrefidx", if it's valid, otherwise
+     * create it. It avoids reading the xref sections on repeated
+     * loads of the same file
+     */
+    XRefIndex = 4,
+    /** When loading from a file, map it in memory instead of reading
+     * it through the stdio. If the file can't be mapped it's read
+     * normally. A mapped file can't be saved over while the document
+     * is loaded
+     */
+    MemoryMap = 8,
+};
+
 enum class PdfAdditionalMetadata : uint8_t
 {
     PdfAIdAmd = 1,
@@ -882,6 +922,7 @@ using PdfFilterList = std::vector<PdfFilterType>;
 };
 
 ENABLE_BITMASK_OPERATORS(PoDoFo::PdfSaveOptions);
+ENABLE_BITMASK_OPERATORS(PoDoFo::PdfLoadOptions);
 ENABLE_BITMASK_OPERATORS(PoDoFo::PdfWriteFlags);
 ENABLE_BITMASK_OPERATORS(PoDoFo::PdfInfoInitial);
 ENABLE_BITMASK_OPERATORS(PoDoFo::PdfFontStyle);
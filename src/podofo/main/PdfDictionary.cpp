@@ -10,9 +10,86 @@
 #include <podofo/auxiliary/OutputDevice.h>
 #include <podofo/auxiliary/StreamDevice.h>
 
+#include <mutex>
+#include <new>
+
 using namespace std;
 using namespace PoDoFo;
 
+namespace
+{
+    // Blocks are grouped in size classes multiple of 16 bytes
+    constexpr size_t BlockAlignment = 16;
+    constexpr size_t MaxBlockSize = 256;
+    constexpr size_t SizeClassCount = MaxBlockSize / BlockAlignment;
+    // Chunks are aligned to their size, so the chunk
+    // of a block is found by masking the block address
+    constexpr size_t ChunkSize = 64 * 1024;
+    // Count of blocks moved at once between the thread
+    // free lists and the shared free lists
+    constexpr unsigned BlockBatchSize = 128;
+
+    struct FreeBlock
+    {
+        FreeBlock* Next;
+    };
+
+    // Header of a chunk, carved in blocks of a single size class
+    struct Chunk
+    {
+        // Siblings in the list of chunks with free blocks
+        Chunk* Prev;
+        Chunk* Next;
+        FreeBlock* FreeList;
+        unsigned FreeCount;
+        unsigned BlockCount;
+    };
+
+    constexpr size_t ChunkHeaderSize = (sizeof(Chunk) + BlockAlignment - 1) / BlockAlignment * BlockAlignment;
+
+    struct FreeList
+    {
+        FreeBlock* Head;
+        unsigned Count;
+    };
+
+    struct SharedMemoryPool
+    {
+        mutex Mutex;
+        // Chunks with free blocks for each size class
+        Chunk* Chunks[SizeClassCount];
+        size_t ChunkCount;
+    };
+
+    struct ThreadMemoryPool
+    {
+        FreeList FreeLists[SizeClassCount];
+        bool Initialized;
+        bool Exited;
+    };
+
+    // Returns the blocks of the current thread to the shared pool on exit
+    class ThreadMemoryPoolGuard final
+    {
+    public:
+        ThreadMemoryPoolGuard();
+        ~ThreadMemoryPoolGuard();
+        void Init() { }
+    };
+}
+
+static SharedMemoryPool& getSharedPool();
+static void* allocateShared(size_t sizeClass, FreeList* list);
+static void deallocateShared(FreeBlock* head, size_t sizeClass);
+static Chunk* createChunk(size_t blockSize);
+static void linkChunk(Chunk*& chunks, Chunk* chunk);
+static void unlinkChunk(Chunk*& chunks, Chunk* chunk);
+
+// NOTE: The pool is trivially destructible, so it's still accessible
+// after the guard is destroyed, e.g. when static objects are destroyed
+static thread_local ThreadMemoryPool s_threadPool;
+static thread_local ThreadMemoryPoolGuard s_threadPoolGuard;
+
 PdfDictionary::PdfDictionary() { }
 
 PdfDictionary::PdfDictionary(const PdfDictionary& rhs)
@@ -422,3 +499,245 @@ size_t PdfDictionary::size() const
 {
     return m_Map.size();
 }
+
+void* PdfDictionary::operator new(size_t size)
+{
+    return PdfDictionaryMemoryPool::Allocate(size);
+}
+
+void PdfDictionary::operator delete(void* ptr, size_t size) noexcept
+{
+    PdfDictionaryMemoryPool::Deallocate(ptr, size);
+}
+
+void* PdfDictionaryMemoryPool::Allocate(size_t size)
+{
+    if (size == 0 || size > MaxBlockSize)
+        return ::operator new(size);
+
+    size_t sizeClass = (size - 1) / BlockAlignment;
+    auto& pool = s_threadPool;
+    auto& list = pool.FreeLists[sizeClass];
+    if (list.Head != nullptr)
+    {
+        auto block = list.Head;
+        list.Head = block->Next;
+        list.Count--;
+        return block;
+    }
+
+    if (pool.Exited)
+        return allocateShared(sizeClass, nullptr);
+
+    // Ensure the guard is constructed, so the blocks
+    // will be returned to the shared pool on thread exit
+    if (!pool.Initialized)
+        s_threadPoolGuard.Init();
+
+    return allocateShared(sizeClass, &list);
+}
+
+void PdfDictionaryMemoryPool::Deallocate(void* ptr, size_t size) noexcept
+{
+    if (ptr == nullptr)
+        return;
+
+    if (size == 0 || size > MaxBlockSize)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    size_t sizeClass = (size - 1) / BlockAlignment;
+    auto block = static_cast<FreeBlock*>(ptr);
+    auto& pool = s_threadPool;
+    if (pool.Exited)
+    {
+        block->Next = nullptr;
+        deallocateShared(block, sizeClass);
+        return;
+    }
+
+    if (!pool.Initialized)
+        s_threadPoolGuard.Init();
+
+    auto& list = pool.FreeLists[sizeClass];
+    block->Next = list.Head;
+    list.Head = block;
+    list.Count++;
+    if (list.Count < BlockBatchSize * 2)
+        return;
+
+    // Return a batch of blocks to the shared pool, so they
+    // can be reused by other threads
+    auto head = list.Head;
+    auto tail = head;
+    for (unsigned i = 1; i < BlockBatchSize; i++)
+        tail = tail->Next;
+
+    list.Head = tail->Next;
+    list.Count -= BlockBatchSize;
+    tail->Next = nullptr;
+    deallocateShared(head, sizeClass);
+}
+
+size_t PdfDictionaryMemoryPool::GetChunkCount()
+{
+    auto& shared = getSharedPool();
+    lock_guard<mutex> lock(shared.Mutex);
+    return shared.ChunkCount;
+}
+
+ThreadMemoryPoolGuard::ThreadMemoryPoolGuard()
+{
+    s_threadPool.Initialized = true;
+}
+
+ThreadMemoryPoolGuard::~ThreadMemoryPoolGuard()
+{
+    auto& pool = s_threadPool;
+    for (size_t i = 0; i < SizeClassCount; i++)
+    {
+        auto& list = pool.FreeLists[i];
+        if (list.Head == nullptr)
+            continue;
+
+        deallocateShared(list.Head, i);
+        list = { };
+    }
+
+    pool.Exited = true;
+}
+
+SharedMemoryPool& getSharedPool()
+{
+    // NOTE: The shared pool is never destroyed, as blocks
+    // may be released until the very end of the process
+    static SharedMemoryPool* pool = new SharedMemoryPool{ };
+    return *pool;
+}
+
+// Allocate a block, moving also a batch of free
+// blocks in the given list, if not null
+void* allocateShared(size_t sizeClass, FreeList* list)
+{
+    size_t blockSize = (sizeClass + 1) * BlockAlignment;
+    unsigned batchSize = list == nullptr ? 1 : BlockBatchSize;
+    auto& shared = getSharedPool();
+    lock_guard<mutex> lock(shared.Mutex);
+    auto& chunks = shared.Chunks[sizeClass];
+    FreeBlock* ret = nullptr;
+    FreeBlock* tail = nullptr;
+    unsigned count = 0;
+    while (count < batchSize)
+    {
+        auto chunk = chunks;
+        if (chunk == nullptr)
+        {
+            // Don't allocate a new chunk just to fill the batch
+            if (count != 0)
+                break;
+
+            chunk = createChunk(blockSize);
+            linkChunk(chunks, chunk);
+            shared.ChunkCount++;
+        }
+
+        auto block = chunk->FreeList;
+        chunk->FreeList = block->Next;
+        chunk->FreeCount--;
+        if (chunk->FreeCount == 0)
+            unlinkChunk(chunks, chunk);
+
+        if (ret == nullptr)
+            ret = block;
+        else
+            tail->Next = block;
+
+        tail = block;
+        count++;
+    }
+
+    tail->Next = nullptr;
+    if (list != nullptr)
+    {
+        list->Head = ret->Next;
+        list->Count = count - 1;
+    }
+
+    return ret;
+}
+
+// Return a null terminated list of blocks to their chunks, releasing
+// the chunks which become unused. One unused chunk is kept for each
+// size class, to not allocate it again on the next allocation
+void deallocateShared(FreeBlock* head, size_t sizeClass)
+{
+    auto& shared = getSharedPool();
+    lock_guard<mutex> lock(shared.Mutex);
+    auto& chunks = shared.Chunks[sizeClass];
+    while (head != nullptr)
+    {
+        auto block = head;
+        head = head->Next;
+        auto chunk = reinterpret_cast<Chunk*>(reinterpret_cast<uintptr_t>(block) & ~(uintptr_t)(ChunkSize - 1));
+        block->Next = chunk->FreeList;
+        chunk->FreeList = block;
+        chunk->FreeCount++;
+        if (chunk->FreeCount == 1)
+            linkChunk(chunks, chunk);
+
+        if (chunk->FreeCount == chunk->BlockCount && (chunk->Prev != nullptr || chunk->Next != nullptr))
+        {
+            unlinkChunk(chunks, chunk);
+            ::operator delete(chunk, align_val_t(ChunkSize));
+            shared.ChunkCount--;
+        }
+    }
+}
+
+Chunk* createChunk(size_t blockSize)
+{
+    auto chunk = static_cast<Chunk*>(::operator new(ChunkSize, align_val_t(ChunkSize)));
+    chunk->Prev = nullptr;
+    chunk->Next = nullptr;
+    chunk->BlockCount = (unsigned)((ChunkSize - ChunkHeaderSize) / blockSize);
+    chunk->FreeCount = chunk->BlockCount;
+
+    // Link the blocks in address order
+    FreeBlock* next = nullptr;
+    char* blocks = reinterpret_cast<char*>(chunk) + ChunkHeaderSize;
+    for (unsigned i = chunk->BlockCount; i > 0; i--)
+    {
+        auto block = reinterpret_cast<FreeBlock*>(blocks + (i - 1) * blockSize);
+        block->Next = next;
+        next = block;
+    }
+
+    chunk->FreeList = next;
+    return chunk;
+}
+
+void linkChunk(Chunk*& chunks, Chunk* chunk)
+{
+    chunk->Prev = nullptr;
+    chunk->Next = chunks;
+    if (chunks != nullptr)
+        chunks->Prev = chunk;
+
+    chunks = chunk;
+}
+
+void unlinkChunk(Chunk*& chunks, Chunk* chunk)
+{
+    if (chunk->Prev == nullptr)
+        chunks = chunk->Next;
+    else
+        chunk->Prev->Next = chunk->Next;
+
+    if (chunk->Next != nullptr)
+        chunk->Next->Prev = chunk->Prev;
+
+    chunk->Prev = nullptr;
+    chunk->Next = nullptr;
+}
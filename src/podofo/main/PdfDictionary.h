@@ -14,6 +14,70 @@ namespace PoDoFo {
 
 class PdfDictionary;
 
+/** Pool of small fixed size memory blocks, used to allocate
+ * the nodes of PdfDictionary maps and the dictionaries themselves
+ *
+ * Blocks are carved from large chunks and recycled through per
+ * thread free lists, avoiding a general purpose allocation for
+ * each dictionary entry and keeping entries allocated together
+ * close in memory
+ * \remarks A chunk is released to the system when all its blocks are
+ *      free, except one spare chunk for each block size. The blocks
+ *      cached by a thread are returned to their chunks on thread exit
+ */
+class PODOFO_API PdfDictionaryMemoryPool final
+{
+public:
+    static void* Allocate(size_t size);
+    static void Deallocate(void* ptr, size_t size) noexcept;
+
+    /** Get the count of chunks currently allocated from the system
+     */
+    static size_t GetChunkCount();
+
+private:
+    PdfDictionaryMemoryPool() = delete;
+};
+
+/** Allocator for PdfDictionary map nodes
+ */
+template <typename T>
+class PdfDictionaryAllocator
+{
+public:
+    using value_type = T;
+
+    PdfDictionaryAllocator() noexcept { }
+
+    template <typename U>
+    PdfDictionaryAllocator(const PdfDictionaryAllocator<U>&) noexcept { }
+
+    T* allocate(size_t n)
+    {
+        if (n == 1)
+            return static_cast<T*>(PdfDictionaryMemoryPool::Allocate(sizeof(T)));
+        else
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept
+    {
+        if (n == 1)
+            PdfDictionaryMemoryPool::Deallocate(ptr, sizeof(T));
+        else
+            ::operator delete(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const PdfDictionaryAllocator<U>&) const noexcept { return true; }
+
+    template <typename U>
+    bool operator!=(const PdfDictionaryAllocator<U>&) const noexcept { return false; }
+};
+
+using PdfDictionaryMap = std::map<PdfName, PdfObject, PdfNameInequality,
+    PdfDictionaryAllocator<std::pair<const PdfName, PdfObject>>>;
+
 /**
  * Helper class to iterate through indirect objects
  */
@@ -67,8 +131,8 @@ private:
     PdfDictionary* m_dict;
 };
 
-using PdfDictionaryIndirectIterable = PdfDictionaryIndirectIterableBase<PdfObject, PdfNameMap<PdfObject>::iterator>;
-using PdfDictionaryConstIndirectIterable = PdfDictionaryIndirectIterableBase<const PdfObject, PdfNameMap<PdfObject>::const_iterator>;
+using PdfDictionaryIndirectIterable = PdfDictionaryIndirectIterableBase<PdfObject, PdfDictionaryMap::iterator>;
+using PdfDictionaryConstIndirectIterable = PdfDictionaryIndirectIterableBase<const PdfObject, PdfDictionaryMap::const_iterator>;
 
 /** The PDF dictionary data type of PoDoFo (inherits from PdfDataContainer,
  * the base class for such representations)
@@ -111,6 +175,9 @@ public:
     PdfDictionary& operator=(const PdfDictionary& rhs);
     PdfDictionary& operator=(PdfDictionary&& rhs) noexcept;
 
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size) noexcept;
+
     /**
      * Comparison operator. If this dictionary contains all the same keys
      * as the other dictionary, and for each key the values compare equal,
@@ -320,8 +387,8 @@ public:
     PdfDictionaryConstIndirectIterable GetIndirectIterator() const;
 
 public:
-    using iterator = PdfNameMap<PdfObject>::iterator;
-    using const_iterator = PdfNameMap<PdfObject>::const_iterator;
+    using iterator = PdfDictionaryMap::iterator;
+    using const_iterator = PdfDictionaryMap::const_iterator;
 
 public:
     iterator begin();
@@ -351,7 +418,7 @@ private:
         const PdfStatefulEncrypt* encrypt, charbuff& buffer) const;
 
 private:
-    PdfNameMap<PdfObject> m_Map;
+    PdfDictionaryMap m_Map;
 };
 
 template<typename T>
@@ -480,9 +480,9 @@ void PdfDocument::fixObjectReferences(PdfObject& obj, int difference)
     }
 }
 
-void PdfDocument::CollectGarbage()
+void PdfDocument::CollectGarbage(bool parallel)
 {
-    m_Objects.CollectGarbage();
+    m_Objects.CollectGarbage(parallel);
 }
 
 PdfOutlines& PdfDocument::GetOrCreateOutlines()
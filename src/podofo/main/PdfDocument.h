@@ -148,7 +148,11 @@ public:
      */
     PdfAcroForm& GetOrCreateAcroForm(PdfAcroFormDefaulAppearance eDefaultAppearance = PdfAcroFormDefaulAppearance::ArialBlack);
 
-    void CollectGarbage();
+    /** Deletes all the objects not reachable from the trailer
+     *  \param parallel scan the reachable objects in multiple threads
+     *  \see PdfIndirectObjectList::CollectGarbage
+     */
+    void CollectGarbage(bool parallel = false);
 
     /** Construct a new PdfImage object
      */
@@ -8,6 +8,8 @@
 #include "PdfIndirectObjectList.h"
 
 #include <algorithm>
+#include <atomic>
+#include <thread>
 
 #include "PdfArray.h"
 #include "PdfDictionary.h"
@@ -22,6 +24,32 @@ using namespace std;
 using namespace PoDoFo;
 
 static constexpr unsigned MaxXRefGenerationNum = 65535;
+// Minimum number of objects to mark the reachable ones in parallel
+static constexpr unsigned ParallelCollectMinObjectCount = 256;
+// Number of references a worker resolves at a time
+static constexpr size_t ParallelCollectBatchSize = 64;
+
+// A bitmap indexed by object number. Marking is atomic,
+// so it can be shared by concurrent workers
+struct PdfIndirectObjectList::MarkBitmap
+{
+    MarkBitmap(size_t size)
+        : Words((size + 63) / 64) { }
+
+    bool TryMark(uint32_t objectNum)
+    {
+        uint64_t mask = (uint64_t)1 << (objectNum % 64);
+        return (Words[objectNum / 64].fetch_or(mask, memory_order_relaxed) & mask) == 0;
+    }
+
+    bool IsMarked(uint32_t objectNum) const
+    {
+        uint64_t mask = (uint64_t)1 << (objectNum % 64);
+        return (Words[objectNum / 64].load(memory_order_relaxed) & mask) != 0;
+    }
+
+    vector<atomic<uint64_t>> Words;
+};
 
 namespace
 {
@@ -67,32 +95,46 @@ namespace
 
 PdfIndirectObjectList::PdfIndirectObjectList() :
     m_Document(nullptr),
+    m_objectsSize(0),
     m_ObjectCount(0),
-    m_StreamFactory(nullptr)
+    m_StreamFactory(nullptr),
+    m_MemoryBudget(0),
+    m_LoadedObjectsMemory(0)
 {
 }
 
 PdfIndirectObjectList::PdfIndirectObjectList(PdfDocument& document) :
     m_Document(&document),
+    m_objectsSize(0),
     m_ObjectCount(0),
-    m_StreamFactory(nullptr)
+    m_StreamFactory(nullptr),
+    m_MemoryBudget(0),
+    m_LoadedObjectsMemory(0)
 {
 }
 
 PdfIndirectObjectList::PdfIndirectObjectList(PdfDocument& document, const PdfIndirectObjectList& rhs)  :
     m_Document(&document),
+    m_Objects(rhs.m_Objects.size()),
+    m_objectsSize(rhs.m_objectsSize),
     m_ObjectCount(rhs.m_ObjectCount),
     m_FreeObjects(rhs.m_FreeObjects),
     m_unavailableObjects(rhs.m_unavailableObjects),
-    m_StreamFactory(nullptr)
+    m_StreamFactory(nullptr),
+    m_MemoryBudget(0),
+    m_LoadedObjectsMemory(0)
 {
     // Copy all objects from source, resetting parent and indirect reference
-    for (auto obj : rhs.m_Objects)
+    for (size_t i = 0; i < rhs.m_Objects.size(); i++)
     {
+        auto obj = rhs.m_Objects[i];
+        if (obj == nullptr)
+            continue;
+
         auto newObj = new PdfObject(*obj);
         newObj->SetIndirectReference(obj->GetIndirectReference());
         newObj->SetDocument(&document);
-        m_Objects.insert(newObj);
+        m_Objects[i] = newObj;
     }
 }
 
@@ -107,10 +149,14 @@ void PdfIndirectObjectList::Clear()
         delete obj;
 
     m_Objects.clear();
+    m_objectsSize = 0;
     m_ObjectCount = 0;
     m_FreeObjects.clear();
     m_unavailableObjects.clear();
     m_objectStreams.clear();
+    m_MemoryBudget = 0;
+    clearLoadedObjects();
+    m_dirtyObjects.clear();
 }
 
 PdfObject& PdfIndirectObjectList::MustGetObject(const PdfReference& ref) const
@@ -124,11 +170,25 @@ PdfObject& PdfIndirectObjectList::MustGetObject(const PdfReference& ref) const
 
 PdfObject* PdfIndirectObjectList::GetObject(const PdfReference& ref) const
 {
-    auto it = m_Objects.lower_bound(ref);
-    if (it == m_Objects.end() || (*it)->GetIndirectReference() != ref)
+    auto obj = getObject(ref);
+    if (obj != nullptr && m_MemoryBudget != 0)
+        touchLoadedObject(ref);
+
+    return obj;
+}
+
+PdfObject* PdfIndirectObjectList::getObject(const PdfReference& ref) const
+{
+    uint32_t objectNum = ref.ObjectNumber();
+    if (objectNum >= m_Objects.size())
+        return nullptr;
+
+    // The slot may hold an object with a different generation
+    auto obj = m_Objects[objectNum];
+    if (obj == nullptr || obj->GetIndirectReference().GenerationNumber() != ref.GenerationNumber())
         return nullptr;
 
-    return *it;
+    return obj;
 }
 
 unique_ptr<PdfObject> PdfIndirectObjectList::RemoveObject(const PdfReference& ref)
@@ -138,28 +198,30 @@ unique_ptr<PdfObject> PdfIndirectObjectList::RemoveObject(const PdfReference& re
 
 unique_ptr<PdfObject> PdfIndirectObjectList::RemoveObject(const PdfReference& ref, bool markAsFree)
 {
-    auto it = m_Objects.lower_bound(ref);
-    if (it == m_Objects.end() || (*it)->GetIndirectReference() != ref)
+    if (getObject(ref) == nullptr)
         return nullptr;
 
-    return removeObject(it, markAsFree);
+    return removeObject(ref.ObjectNumber(), markAsFree);
 }
 
 unique_ptr<PdfObject> PdfIndirectObjectList::RemoveObject(const iterator& it)
 {
-    return removeObject(it, true);
+    return removeObject((uint32_t)it.m_index, true);
 }
 
-unique_ptr<PdfObject> PdfIndirectObjectList::removeObject(const iterator& it, bool markAsFree)
+unique_ptr<PdfObject> PdfIndirectObjectList::removeObject(uint32_t objectNum, bool markAsFree)
 {
-    auto obj = *it;
-    if (m_objectStreams.find(obj->GetIndirectReference().ObjectNumber()) != m_objectStreams.end())
+    auto obj = m_Objects[objectNum];
+    if (IsObjectStream(objectNum))
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Can't remove a compressed object stream");
 
     if (markAsFree)
         SafeAddFreeObject(obj->GetIndirectReference());
 
-    m_Objects.erase(it);
+    untrackLoadedObject(obj->GetIndirectReference());
+    m_dirtyObjects.erase(obj->GetIndirectReference());
+    m_Objects[objectNum] = nullptr;
+    m_objectsSize--;
     return unique_ptr<PdfObject>(obj);
 }
 
@@ -182,7 +244,7 @@ PdfReference PdfIndirectObjectList::getNextFreeObject()
 
         // Check also if the object number it not available,
         // e.g. it reached maximum generation number (65535)
-        if (m_unavailableObjects.find(nextObjectNum) == m_unavailableObjects.end())
+        if (!hasObjectNum(m_unavailableObjects, nextObjectNum))
             break;
 
         nextObjectNum++;
@@ -256,7 +318,7 @@ int32_t PdfIndirectObjectList::tryAddFreeObject(uint32_t objnum, uint32_t gennum
     // NOTE: gennum is uint32 to accommodate overflows from callers
     if (gennum >= MaxXRefGenerationNum)
     {
-        m_unavailableObjects.insert(gennum);
+        setObjectNum(m_unavailableObjects, objnum);
         return -1;
     }
 
@@ -284,7 +346,12 @@ void PdfIndirectObjectList::AddFreeObject(const PdfReference& reference)
 
 void PdfIndirectObjectList::AddObjectStream(uint32_t objectNum)
 {
-    m_objectStreams.insert(objectNum);
+    setObjectNum(m_objectStreams, objectNum);
+}
+
+bool PdfIndirectObjectList::IsObjectStream(uint32_t objectNum) const
+{
+    return hasObjectNum(m_objectStreams, objectNum);
 }
 
 void PdfIndirectObjectList::addNewObject(PdfObject* obj)
@@ -298,102 +365,331 @@ void PdfIndirectObjectList::PushObject(PdfObject* obj)
 {
     obj->SetDocument(m_Document);
 
-    ObjectList::node_type node;
-    auto it = m_Objects.find(obj);
-    auto hintpos = it;
-    if (it != m_Objects.end())
+    uint32_t objectNum = obj->GetIndirectReference().ObjectNumber();
+    if (objectNum >= m_Objects.size())
+        m_Objects.resize(objectNum + 1);
+
+    auto& slot = m_Objects[objectNum];
+    if (slot == nullptr)
     {
-        // Delete existing object and replace
-        // the pointer on its node
-        hintpos++;
-        node = m_Objects.extract(it);
-        delete node.value();
-        node.value() = obj;
+        m_objectsSize++;
+    }
+    else
+    {
+        // Delete existing object with the same object
+        // number and replace it in its slot
+        if (slot->GetIndirectReference() != obj->GetIndirectReference())
+        {
+            untrackLoadedObject(slot->GetIndirectReference());
+            m_dirtyObjects.erase(slot->GetIndirectReference());
+        }
+
+        delete slot;
     }
 
-    pushObject(hintpos, node, obj);
-}
+    slot = obj;
 
-void PdfIndirectObjectList::pushObject(const ObjectList::const_iterator& hintpos, ObjectList::node_type& node, PdfObject* obj)
-{
-    if (node.empty())
-        m_Objects.insert(hintpos, obj);
+    // Objects may be already dirty before being
+    // added, e.g. newly created objects
+    if (obj->IsDirty())
+        m_dirtyObjects.insert(obj->GetIndirectReference());
     else
-        m_Objects.insert(hintpos, std::move(node));
+        m_dirtyObjects.erase(obj->GetIndirectReference());
+
     tryIncrementObjectCount(obj->GetIndirectReference());
 }
 
-void PdfIndirectObjectList::CollectGarbage()
+void PdfIndirectObjectList::CollectGarbage(bool parallel)
 {
     if (m_Document == nullptr)
         return;
 
-    unordered_set<PdfReference> referencedOjects;
-    visitObject(m_Document->GetTrailer().GetObject(), referencedOjects);
-    vector<PdfObject*> objectsToDelete;
-    ObjectList newlist;
-    for (PdfObject* obj : m_Objects)
+    // Objects are marked by object number: all the objects
+    // in the list have a number not greater than the count
+    MarkBitmap marked(m_ObjectCount + 1);
+    auto& trailer = m_Document->GetTrailer().GetObject();
+    unsigned threadCount = 1;
+    if (parallel && m_objectsSize >= ParallelCollectMinObjectCount)
+        threadCount = std::max(1u, thread::hardware_concurrency());
+
+    if (threadCount == 1)
+        markObjects(trailer, marked);
+    else
+        markObjectsParallel(trailer, marked, threadCount);
+
+    for (uint32_t i = 0; i < m_Objects.size(); i++)
     {
-        auto& ref = obj->GetIndirectReference();
-        if (referencedOjects.find(ref) == referencedOjects.end()
-            && m_objectStreams.find(ref.ObjectNumber()) == m_objectStreams.end())
-        {
-            SafeAddFreeObject(ref);
-            objectsToDelete.push_back(obj);
+        auto obj = m_Objects[i];
+        if (obj == nullptr || marked.IsMarked(i) || IsObjectStream(i))
             continue;
-        }
 
-        newlist.insert(obj);
+        auto& ref = obj->GetIndirectReference();
+        SafeAddFreeObject(ref);
+        untrackLoadedObject(ref);
+        m_dirtyObjects.erase(ref);
+        m_Objects[i] = nullptr;
+        m_objectsSize--;
+        delete obj;
     }
+}
 
-    for (auto obj : objectsToDelete)
-        delete obj;
+void PdfIndirectObjectList::markObjects(const PdfObject& trailer, MarkBitmap& marked) const
+{
+    // The references still to be visited are the stack itself
+    vector<PdfReference> references;
+    readReferences(trailer, references);
+    while (!references.empty())
+    {
+        auto ref = references.back();
+        references.pop_back();
 
-    m_Objects.swap(newlist);
+        // NOTE: References with a different generation
+        // than the one of the object don't keep it alive
+        auto obj = getObject(ref);
+        if (obj == nullptr || !marked.TryMark(ref.ObjectNumber()))
+            continue;
+
+        readReferences(*obj, references);
+    }
 }
 
-void PdfIndirectObjectList::visitObject(const PdfObject& obj, unordered_set<PdfReference>& referencedObjects)
+void PdfIndirectObjectList::markObjectsParallel(const PdfObject& trailer, MarkBitmap& marked, unsigned threadCount) const
 {
-    switch (obj.GetDataType())
+    struct WorkerState
     {
-        case PdfDataType::Reference:
-        {
-            // Try to check if the object has been already visited
-            auto indirectReference = obj.GetReferenceUnsafe();
-            auto inserted = referencedObjects.insert(indirectReference);
-            if (!inserted.second)
+        vector<PdfReference> References;
+        vector<const PdfObject*> Deferred;
+    };
+
+    vector<PdfReference> level;
+    readReferences(trailer, level);
+    vector<WorkerState> states(threadCount);
+    while (!level.empty())
+    {
+        atomic<size_t> next(0);
+        atomic<bool> failed(false);
+        exception_ptr error;
+        auto worker = [&](WorkerState& state) {
+            try
             {
-                // The object has been visited, just return
-                break;
+                size_t start;
+                while (!failed && (start = next.fetch_add(ParallelCollectBatchSize)) < level.size())
+                {
+                    size_t end = std::min(start + ParallelCollectBatchSize, level.size());
+                    for (size_t i = start; i < end; i++)
+                    {
+                        auto& ref = level[i];
+                        auto obj = getObject(ref);
+                        if (obj == nullptr || !marked.TryMark(ref.ObjectNumber()))
+                            continue;
+
+                        // Objects that can't be scanned concurrently
+                        // are loaded later by the calling thread
+                        if (!tryReadReferences(*obj, state.References, true))
+                            state.Deferred.push_back(obj);
+                    }
+                }
             }
+            catch (...)
+            {
+                if (!failed.exchange(true))
+                    error = std::current_exception();
+            }
+        };
+
+        // Small levels, e.g. in long chains of outline
+        // items, are not worth spawning threads
+        unsigned levelThreadCount = (unsigned)std::min<size_t>(threadCount,
+            (level.size() + ParallelCollectBatchSize - 1) / ParallelCollectBatchSize);
+        vector<thread> workers;
+        for (unsigned i = 1; i < levelThreadCount; i++)
+            workers.emplace_back(worker, std::ref(states[i]));
+
+        worker(states[0]);
+        for (auto& thread : workers)
+            thread.join();
+
+        if (error != nullptr)
+            std::rethrow_exception(error);
+
+        level.clear();
+        for (auto& state : states)
+        {
+            level.insert(level.end(), state.References.begin(), state.References.end());
+            state.References.clear();
+            for (auto obj : state.Deferred)
+                readReferences(*obj, level);
+
+            state.Deferred.clear();
+        }
+    }
+}
+
+void PdfIndirectObjectList::readReferences(const PdfObject& obj, vector<PdfReference>& references)
+{
+    if (tryReadReferences(obj, references, false))
+        return;
 
-            auto childObj = GetObject(indirectReference);
-            if (childObj == nullptr)
-                break;
+    obj.DelayedLoad();
+    PdfObject::collectReferences(obj.m_Variant, references);
+}
 
-            visitObject(*childObj, referencedObjects);
+bool PdfIndirectObjectList::tryReadReferences(const PdfObject& obj, vector<PdfReference>& references, bool concurrent)
+{
+    // NOTE: Don't use regular accessors, which load the object
+    if (obj.IsDelayedLoadDone())
+    {
+        PdfObject::collectReferences(obj.m_Variant, references);
+        return true;
+    }
+
+    return obj.tryReadReferences(references, concurrent);
+}
+
+void PdfIndirectObjectList::SetMemoryBudget(size_t budget)
+{
+    m_MemoryBudget = budget;
+    if (budget == 0)
+        clearLoadedObjects();
+}
+
+void PdfIndirectObjectList::ReclaimMemory()
+{
+    while (m_LoadedObjectsMemory > m_MemoryBudget && !m_loadedObjectList.empty())
+    {
+        auto ref = m_loadedObjectList.front();
+        untrackLoadedObject(ref);
+
+        // Objects that can't be unloaded, e.g. because they
+        // have been modified, just drop from the accounting
+        auto obj = getObject(ref);
+        if (obj != nullptr)
+            (void)obj->TryUnload();
+    }
+}
+
+void PdfIndirectObjectList::trackLoadedObject(const PdfObject& obj)
+{
+    if (m_MemoryBudget == 0 || !obj.IsIndirect() || isPinnedObject(obj))
+        return;
+
+    size_t memory = estimateMemory(obj);
+    if (obj.m_Stream != nullptr)
+        memory += obj.m_Stream->GetLength();
+
+    auto& ref = obj.GetIndirectReference();
+    auto found = m_loadedObjects.find(ref);
+    if (found == m_loadedObjects.end())
+    {
+        m_loadedObjectList.push_back(ref);
+        m_loadedObjects.emplace(ref, LoadedObjectInfo{ std::prev(m_loadedObjectList.end()), memory });
+    }
+    else
+    {
+        // The stream of an already tracked object has been loaded
+        m_LoadedObjectsMemory -= found->second.Memory;
+        found->second.Memory = memory;
+        m_loadedObjectList.splice(m_loadedObjectList.end(), m_loadedObjectList, found->second.Position);
+    }
+
+    m_LoadedObjectsMemory += memory;
+}
+
+void PdfIndirectObjectList::touchLoadedObject(const PdfReference& ref) const
+{
+    auto found = m_loadedObjects.find(ref);
+    if (found == m_loadedObjects.end())
+        return;
+
+    m_loadedObjectList.splice(m_loadedObjectList.end(), m_loadedObjectList, found->second.Position);
+}
+
+void PdfIndirectObjectList::untrackLoadedObject(const PdfReference& ref)
+{
+    if (m_loadedObjects.empty())
+        return;
+
+    auto found = m_loadedObjects.find(ref);
+    if (found == m_loadedObjects.end())
+        return;
+
+    m_LoadedObjectsMemory -= found->second.Memory;
+    m_loadedObjectList.erase(found->second.Position);
+    m_loadedObjects.erase(found);
+}
+
+void PdfIndirectObjectList::clearLoadedObjects()
+{
+    m_loadedObjectList.clear();
+    m_loadedObjects.clear();
+    m_LoadedObjectsMemory = 0;
+}
+
+void PdfIndirectObjectList::markObjectDirty(const PdfReference& ref)
+{
+    m_dirtyObjects.insert(ref);
+}
+
+void PdfIndirectObjectList::unmarkObjectDirty(const PdfReference& ref)
+{
+    m_dirtyObjects.erase(ref);
+}
+
+bool PdfIndirectObjectList::isPinnedObject(const PdfObject& obj)
+{
+    // The document caches wrappers holding references to
+    // direct objects contained in the catalog, in the page
+    // tree nodes and in the interactive form dictionary
+    if (obj.m_Variant.GetDataType() != PdfDataType::Dictionary)
+        return false;
+
+    auto& dict = obj.GetDictionaryUnsafe();
+    if (dict.GetKey("Fields") != nullptr)
+        return true;
+
+    auto typeObj = dict.GetKey("Type");
+    const PdfName* type;
+    if (typeObj == nullptr || !typeObj->TryGetName(type))
+        return false;
+
+    return *type == "Catalog" || *type == "Pages" || *type == "Page";
+}
+
+size_t PdfIndirectObjectList::estimateMemory(const PdfObject& obj)
+{
+    size_t ret = sizeof(PdfObject);
+    auto& variant = obj.m_Variant;
+    switch (variant.GetDataType())
+    {
+        case PdfDataType::Name:
+            ret += variant.GetName().GetRawData().size();
+            break;
+        case PdfDataType::String:
+        {
+            auto& str = variant.GetString();
+            ret += str.IsStringEvaluated() ? str.GetString().size() : str.GetRawData().size();
             break;
         }
         case PdfDataType::Array:
         {
-            auto& arr = obj.GetArrayUnsafe();
-            for (auto& child : arr)
-                visitObject(child, referencedObjects);
+            for (auto& child : obj.GetArrayUnsafe())
+                ret += estimateMemory(child);
             break;
         }
         case PdfDataType::Dictionary:
         {
-            auto& dict = obj.GetDictionaryUnsafe();
-            for (auto& pair : dict)
-                visitObject(pair.second, referencedObjects);
+            for (auto& pair : obj.GetDictionaryUnsafe())
+                ret += pair.first.GetRawData().size() + estimateMemory(pair.second);
             break;
         }
         default:
         {
-            // Nothing to do
+            // Other types have no additional storage
             break;
         }
     }
+
+    return ret;
 }
 
 void PdfIndirectObjectList::DetachObserver(Observer& observer)
@@ -440,7 +736,7 @@ void PdfIndirectObjectList::EndAppendStream(PdfObjectStream& stream)
 
 unsigned PdfIndirectObjectList::GetSize() const
 {
-    return (unsigned)m_Objects.size();
+    return m_objectsSize;
 }
 
 void PdfIndirectObjectList::AttachObserver(Observer& observer)
@@ -465,25 +761,46 @@ void PdfIndirectObjectList::tryIncrementObjectCount(const PdfReference& ref)
 
 PdfIndirectObjectList::iterator PdfIndirectObjectList::begin() const
 {
-    return m_Objects.begin();
+    if (m_objectsSize == 0)
+        return end();
+
+    // NOTE: Object number 0 is never used by indirect objects
+    iterator it(m_Objects, 0);
+    if (m_Objects[0] == nullptr)
+        ++it;
+
+    return it;
 }
 
 PdfIndirectObjectList::iterator PdfIndirectObjectList::end() const
 {
-    return m_Objects.end();
+    return iterator(m_Objects, m_Objects.size());
 }
 
 PdfIndirectObjectList::reverse_iterator PdfIndirectObjectList::rbegin() const
 {
-    return m_Objects.rbegin();
+    return reverse_iterator(end());
 }
 
 PdfIndirectObjectList::reverse_iterator PdfIndirectObjectList::rend() const
 {
-    return m_Objects.rend();
+    return reverse_iterator(begin());
 }
 
 size_t PdfIndirectObjectList::size() const
 {
-    return m_Objects.size();
+    return m_objectsSize;
+}
+
+bool PdfIndirectObjectList::hasObjectNum(const ObjectNumBitmap& bitmap, uint32_t objectNum)
+{
+    return objectNum < bitmap.size() && bitmap[objectNum];
+}
+
+void PdfIndirectObjectList::setObjectNum(ObjectNumBitmap& bitmap, uint32_t objectNum)
+{
+    if (objectNum >= bitmap.size())
+        bitmap.resize(objectNum + 1);
+
+    bitmap[objectNum] = true;
 }
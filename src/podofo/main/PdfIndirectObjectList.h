@@ -9,6 +9,8 @@
 
 #include "PdfObject.h"
 
+#include <list>
+
 namespace PoDoFo {
 
 class PdfObjectStreamProvider;
@@ -88,8 +90,47 @@ public:
      * Deletes all objects that are not references by other objects
      * besides the trailer (which references the root dictionary, which in
      * turn should reference all other objects).
+     *
+     * Objects parsed from the file that are not loaded yet are only
+     * scanned for references, and their streams are never read
+     * \param parallel scan the reachable objects in multiple threads.
+     *      It's effective only for large documents, and unloaded objects
+     *      are scanned concurrently only when the document was read
+     *      from a file or a buffer in memory
+     */
+    void CollectGarbage(bool parallel = false);
+
+    /** Set a soft limit, in bytes, to the memory used by objects
+     * loaded on demand from the parsed file
+     *
+     * When a budget is set, the objects that are loaded from the file
+     * are tracked together with an estimation of their memory footprint,
+     * ordered by their last access through this list. The budget is
+     * then enforced by calling ReclaimMemory()
+     * \param budget the memory budget in bytes. 0 means unlimited,
+     *      which is the default, and stops tracking loaded objects
+     * \remarks The budget is reset when the document is cleared or
+     *      loaded again, so it should be set after loading. Only objects
+     *      loaded after setting the budget are accounted, hence it's
+     *      meaningful only for documents loaded on demand
+     */
+    void SetMemoryBudget(size_t budget);
+
+    /** Unload the least recently used objects loaded from the
+     * parsed file, until the tracked memory fits the budget
+     *
+     * Unloaded objects are transparently read again from the
+     * file when they are accessed another time. Objects modified
+     * after being loaded, objects of the page tree, the catalog and
+     * the interactive form dictionary are never unloaded
+     * \remarks This invalidates any reference or pointer to
+     *      direct objects, dictionaries and arrays contained in
+     *      the unloaded objects, also when held by wrappers like
+     *      PdfResources. Call it only in points where such references
+     *      are not retained, e.g. after having processed a page
+     * \see SetMemoryBudget
      */
-    void CollectGarbage();
+    void ReclaimMemory();
 
 public:
     /**
@@ -115,6 +156,15 @@ public:
      */
     inline PdfDocument& GetDocument() const { return *m_Document; }
 
+    /** \returns the memory budget, or 0 if unlimited
+     */
+    inline size_t GetMemoryBudget() const { return m_MemoryBudget; }
+
+    /** \returns the estimated memory, in bytes, used by objects
+     * loaded on demand and tracked for the memory budget
+     */
+    inline size_t GetLoadedObjectsMemory() const { return m_LoadedObjectsMemory; }
+
 private:
     /** Every observer of PdfIndirectObjectList has to implement this interface.
      */
@@ -151,18 +201,92 @@ private:
         virtual std::unique_ptr<PdfObjectStreamProvider> CreateStream() = 0;
     };
 
-    using ObjectNumSet = std::set<uint32_t>;
+    using ObjectNumBitmap = std::vector<bool>;
     using ReferenceSet = std::set<PdfReference>;
     using ObserverList = std::vector<Observer*>;
-    using ObjectList = std::set<PdfObject*, PdfObjectInequality>;
+    // Objects are stored in a slot indexed by their object number
+    using ObjectList = std::vector<PdfObject*>;
+    using LoadedObjectList = std::list<PdfReference>;
+    struct LoadedObjectInfo
+    {
+        LoadedObjectList::iterator Position;
+        size_t Memory;
+    };
+    using LoadedObjectMap = std::unordered_map<PdfReference, LoadedObjectInfo>;
 
 public:
+    /** An iterator over the objects, ordered by object number
+     * \remarks The iterator stays valid when objects are added
+     *      to the list, or other objects are removed
+     */
+    class PODOFO_API Iterator final
+    {
+        friend class PdfIndirectObjectList;
+    public:
+        using difference_type = std::ptrdiff_t;
+        using value_type = PdfObject*;
+        using pointer = PdfObject* const*;
+        using reference = PdfObject* const&;
+        using iterator_category = std::bidirectional_iterator_tag;
+    public:
+        Iterator() : m_objects(nullptr), m_index(0) { }
+    private:
+        Iterator(const ObjectList& objects, size_t index)
+            : m_objects(&objects), m_index(index) { }
+    public:
+        Iterator(const Iterator&) = default;
+        Iterator& operator=(const Iterator&) = default;
+        bool operator==(const Iterator& rhs) const
+        {
+            return m_index == rhs.m_index;
+        }
+        bool operator!=(const Iterator& rhs) const
+        {
+            return m_index != rhs.m_index;
+        }
+        Iterator& operator++()
+        {
+            do
+            {
+                m_index++;
+            } while (m_index < m_objects->size() && (*m_objects)[m_index] == nullptr);
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+        Iterator& operator--()
+        {
+            do
+            {
+                m_index--;
+            } while (m_index != 0 && (*m_objects)[m_index] == nullptr);
+            return *this;
+        }
+        Iterator operator--(int)
+        {
+            auto copy = *this;
+            --*this;
+            return copy;
+        }
+        reference operator*() const
+        {
+            return (*m_objects)[m_index];
+        }
+        pointer operator->() const
+        {
+            return &(*m_objects)[m_index];
+        }
+    private:
+        const ObjectList* m_objects;
+        size_t m_index;
+    };
 
-    // An incomplete set of container typedefs, just enough to handle
-    // the begin() and end() methods we wrap from the internal vector.
-    // TODO: proper wrapper iterator class.
-    using iterator = ObjectList::const_iterator;
-    using reverse_iterator = ObjectList::const_reverse_iterator;
+    using iterator = Iterator;
+    using reverse_iterator = std::reverse_iterator<Iterator>;
 
     /** Iterator pointing at the beginning of the vector
      *  \returns beginning iterator
@@ -295,6 +419,10 @@ private:
 
     std::unique_ptr<PdfObject> RemoveObject(const PdfReference& ref, bool markAsFree);
 
+    /** \returns true if the object number belongs to a compressed object stream
+     */
+    bool IsObjectStream(uint32_t objectNum) const;
+
     /** Sets a StreamFactory which is used whenever CreateStream is called.
      *
      *  \param factory a stream factory or nullptr to reset to the default factory
@@ -302,9 +430,7 @@ private:
     void SetStreamFactory(StreamFactory* factory);
 
 private:
-    void pushObject(const ObjectList::const_iterator& hintpos, ObjectList::node_type& node, PdfObject* obj);
-
-    std::unique_ptr<PdfObject> removeObject(const iterator& it, bool markAsFree);
+    std::unique_ptr<PdfObject> removeObject(uint32_t objectNum, bool markAsFree);
 
     void addNewObject(PdfObject* obj);
 
@@ -315,7 +441,53 @@ private:
 
     int32_t tryAddFreeObject(uint32_t objnum, uint32_t gennum);
 
-    void visitObject(const PdfObject& obj, std::unordered_set<PdfReference>& referencedObj);
+    struct MarkBitmap;
+
+    /** Mark the objects reachable from the trailer, visiting
+     * them depth first with an explicit stack
+     */
+    void markObjects(const PdfObject& trailer, MarkBitmap& marked) const;
+
+    /** Mark the objects reachable from the trailer one level at
+     * a time, scanning every level in multiple threads
+     */
+    void markObjectsParallel(const PdfObject& trailer, MarkBitmap& marked, unsigned threadCount) const;
+
+    /** Read the references contained in the object, loading it
+     * only if it can't be scanned otherwise
+     */
+    static void readReferences(const PdfObject& obj, std::vector<PdfReference>& references);
+
+    static bool tryReadReferences(const PdfObject& obj, std::vector<PdfReference>& references, bool concurrent);
+
+    /** Account an object that has just been loaded, or
+     * whose stream has been loaded, for the memory budget
+     */
+    void trackLoadedObject(const PdfObject& obj);
+
+    void touchLoadedObject(const PdfReference& ref) const;
+
+    void untrackLoadedObject(const PdfReference& ref);
+
+    void clearLoadedObjects();
+
+    /** Record an indirect object that became dirty, so
+     * incremental updates can write it without visiting
+     * the whole object list
+     */
+    void markObjectDirty(const PdfReference& ref);
+
+    void unmarkObjectDirty(const PdfReference& ref);
+
+    PdfObject* getObject(const PdfReference& ref) const;
+
+    static bool isPinnedObject(const PdfObject& obj);
+
+    static bool hasObjectNum(const ObjectNumBitmap& bitmap, uint32_t objectNum);
+
+    static void setObjectNum(ObjectNumBitmap& bitmap, uint32_t objectNum);
+
+    static size_t estimateMemory(const PdfObject& obj);
 
     /**
      * Set the object count so that the object described this reference
@@ -328,13 +500,20 @@ private:
 private:
     PdfDocument* m_Document;
     ObjectList m_Objects;
+    unsigned m_objectsSize;
     unsigned m_ObjectCount;
     PdfFreeObjectList m_FreeObjects;
-    ObjectNumSet m_unavailableObjects;
-    ObjectNumSet m_objectStreams;
+    ObjectNumBitmap m_unavailableObjects;
+    ObjectNumBitmap m_objectStreams;
 
     ObserverList m_observers;
     StreamFactory* m_StreamFactory;
+
+    size_t m_MemoryBudget;
+    size_t m_LoadedObjectsMemory;
+    mutable LoadedObjectList m_loadedObjectList;
+    LoadedObjectMap m_loadedObjects;
+    ReferenceSet m_dirtyObjects;
 };
 
 };
@@ -10,12 +10,16 @@
 #include <podofo/auxiliary/StreamDevice.h>
 #include <podofo/private/PdfWriter.h>
 #include <podofo/private/PdfParser.h>
+#include <podofo/private/FileSystem.h>
 
 #include "PdfCommon.h"
 
 using namespace std;
 using namespace PoDoFo;
 
+static int64_t getModificationTime(const string_view& filename);
+static bool isSameFile(const string_view& filename1, const string_view& filename2);
+
 PdfMemDocument::PdfMemDocument()
     : PdfMemDocument(false) { }
 
@@ -24,17 +28,22 @@ PdfMemDocument::PdfMemDocument(bool empty) :
     m_Version(PdfVersionDefault),
     m_InitialVersion(PdfVersionDefault),
     m_HasXRefStream(false),
-    m_PrevXRefOffset(-1)
+    m_PrevXRefOffset(-1),
+    m_ObjectStreamSize(DefaultObjectStreamSize),
+    m_UpdateDevice(nullptr),
+    m_UpdateDeviceLength(0),
+    m_UpdateXRefOffset(-1)
 {
 }
 
-PdfMemDocument::PdfMemDocument(shared_ptr<InputStreamDevice> device, const string_view& password)
+PdfMemDocument::PdfMemDocument(shared_ptr<InputStreamDevice> device, const string_view& password,
+        PdfLoadOptions opts)
     : PdfMemDocument(true)
 {
     if (device == nullptr)
         PODOFO_RAISE_ERROR(PdfErrorCode::InvalidHandle);
 
-    loadFromDevice(std::move(device), password);
+    loadFromDevice(std::move(device), password, opts);
 }
 
 PdfMemDocument::PdfMemDocument(const PdfMemDocument& rhs) :
@@ -42,7 +51,11 @@ PdfMemDocument::PdfMemDocument(const PdfMemDocument& rhs) :
     m_Version(rhs.m_Version),
     m_InitialVersion(rhs.m_InitialVersion),
     m_HasXRefStream(rhs.m_HasXRefStream),
-    m_PrevXRefOffset(rhs.m_PrevXRefOffset)
+    m_PrevXRefOffset(rhs.m_PrevXRefOffset),
+    m_ObjectStreamSize(rhs.m_ObjectStreamSize),
+    m_UpdateDevice(nullptr),
+    m_UpdateDeviceLength(0),
+    m_UpdateXRefOffset(-1)
 {
     // Do a full copy of the encrypt session
     if (rhs.m_Encrypt != nullptr)
@@ -63,6 +76,9 @@ void PdfMemDocument::reset()
     m_InitialVersion = PdfVersionDefault;
     m_HasXRefStream = false;
     m_PrevXRefOffset = -1;
+    m_UpdateDevice = nullptr;
+    m_UpdateDeviceLength = 0;
+    m_UpdateXRefOffset = -1;
 }
 
 void PdfMemDocument::initFromParser(PdfParser& parser)
@@ -87,34 +103,51 @@ void PdfMemDocument::initFromParser(PdfParser& parser)
     Init();
 }
 
-void PdfMemDocument::Load(const string_view& filename, const string_view& password)
+void PdfMemDocument::Load(const string_view& filename, const string_view& password, PdfLoadOptions opts)
 {
     if (filename.length() == 0)
         PODOFO_RAISE_ERROR(PdfErrorCode::InvalidHandle);
 
-    auto device = std::make_shared<FileStreamDevice>(filename);
-    Load(device, password);
+    shared_ptr<InputStreamDevice> device;
+    if ((opts & PdfLoadOptions::MemoryMap) != PdfLoadOptions::None)
+    {
+        try
+        {
+            device = std::make_shared<MmapStreamDevice>(filename);
+        }
+        catch (PdfError&)
+        {
+            PoDoFo::LogMessage(PdfLogSeverity::Warning, "Unable to map the file {}, reading it instead", filename);
+        }
+    }
+
+    if (device == nullptr)
+        device = std::make_shared<FileStreamDevice>(filename);
+
+    this->Clear();
+    loadFromDevice(std::move(device), password, opts, filename);
 }
 
-void PdfMemDocument::LoadFromBuffer(const bufferview& buffer, const string_view& password)
+void PdfMemDocument::LoadFromBuffer(const bufferview& buffer, const string_view& password, PdfLoadOptions opts)
 {
     if (buffer.size() == 0)
         PODOFO_RAISE_ERROR(PdfErrorCode::InvalidHandle);
 
     auto device = std::make_shared<SpanStreamDevice>(buffer);
-    Load(device, password);
+    Load(device, password, opts);
 }
 
-void PdfMemDocument::Load(shared_ptr<InputStreamDevice> device, const string_view& password)
+void PdfMemDocument::Load(shared_ptr<InputStreamDevice> device, const string_view& password, PdfLoadOptions opts)
 {
     if (device == nullptr)
         PODOFO_RAISE_ERROR(PdfErrorCode::InvalidHandle);
 
     this->Clear();
-    loadFromDevice(std::move(device), password);
+    loadFromDevice(std::move(device), password, opts);
 }
 
-void PdfMemDocument::loadFromDevice(shared_ptr<InputStreamDevice>&& device, const string_view& password)
+void PdfMemDocument::loadFromDevice(shared_ptr<InputStreamDevice>&& device, const string_view& password,
+    PdfLoadOptions opts, const string_view& filename)
 {
     m_device = std::move(device);
 
@@ -122,24 +155,72 @@ void PdfMemDocument::loadFromDevice(shared_ptr<InputStreamDevice>&& device, cons
     // so that m_Parser is initialized for encrypted documents
     PdfParser parser(PdfDocument::GetObjects());
     parser.SetPassword(password);
-    parser.Parse(*m_device, true);
+    parser.SetParallelLoad((opts & PdfLoadOptions::ParallelLoad) != PdfLoadOptions::None);
+
+    string indexFilename;
+    int64_t modificationTime = 0;
+    if ((opts & PdfLoadOptions::XRefIndex) != PdfLoadOptions::None && filename.length() != 0)
+    {
+        indexFilename = string(filename) + ".xrefidx";
+        modificationTime = getModificationTime(filename);
+        std::error_code ec;
+        try
+        {
+            charbuff index;
+            if (fs::exists(fs::u8path(indexFilename), ec))
+            {
+                utls::ReadTo(index, indexFilename);
+                parser.SetIndex(index, modificationTime);
+            }
+        }
+        catch (PdfError&)
+        {
+            PoDoFo::LogMessage(PdfLogSeverity::Warning, "Unable to read the xref index {}", indexFilename);
+        }
+    }
+
+    parser.Parse(*m_device, (opts & PdfLoadOptions::LoadAll) == PdfLoadOptions::None);
+
+    if (indexFilename.length() != 0 && !parser.IsIndexUsed())
+    {
+        // The index is missing or outdated
+        try
+        {
+            charbuff index;
+            BufferStreamDevice indexDevice(index);
+            parser.WriteIndex(*m_device, indexDevice, modificationTime);
+            utls::WriteTo(indexFilename, index);
+        }
+        catch (PdfError&)
+        {
+            PoDoFo::LogMessage(PdfLogSeverity::Warning, "Unable to write the xref index {}", indexFilename);
+        }
+    }
+
     initFromParser(parser);
 }
 
 void PdfMemDocument::Save(const string_view& filename, PdfSaveOptions options)
 {
+    // Truncating the mapped source would fault the reads of the objects
+    // still to be loaded, and on Windows it's not even possible
+    auto mapped = dynamic_cast<const MmapStreamDevice*>(m_device.get());
+    if (mapped != nullptr && isSameFile(mapped->GetFilepath(), filename))
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "Can't save over the memory mapped file {}", filename);
+
     FileStreamDevice device(filename, FileMode::Create);
     this->Save(device, options);
 }
 
 void PdfMemDocument::Save(OutputStreamDevice& device, PdfSaveOptions opts)
 {
-    beforeWrite(opts);
+    beforeWrite(opts, false);
 
     PdfWriter writer(this->GetObjects(), this->GetTrailer().GetObject());
     writer.SetPdfVersion(GetMetadata().GetPdfVersion());
     writer.SetPdfALevel(GetMetadata().GetPdfALevel());
     writer.SetSaveOptions(opts);
+    writer.SetObjectStreamSize(m_ObjectStreamSize);
 
     if (m_Encrypt != nullptr)
         writer.SetEncrypt(*m_Encrypt);
@@ -163,13 +244,13 @@ void PdfMemDocument::SaveUpdate(const string_view& filename, PdfSaveOptions opts
 
 void PdfMemDocument::SaveUpdate(OutputStreamDevice& device, PdfSaveOptions opts)
 {
-    beforeWrite(opts);
+    beforeWrite(opts, true);
 
     PdfWriter writer(this->GetObjects(), this->GetTrailer().GetObject());
     writer.SetPdfVersion(GetMetadata().GetPdfVersion());
     writer.SetPdfALevel(GetMetadata().GetPdfALevel());
     writer.SetSaveOptions(opts);
-    writer.SetPrevXRefOffset(m_PrevXRefOffset);
+    writer.SetObjectStreamSize(m_ObjectStreamSize);
     writer.SetUseXRefStream(m_HasXRefStream);
     writer.SetIncrementalUpdate(false);
 
@@ -187,7 +268,20 @@ void PdfMemDocument::SaveUpdate(OutputStreamDevice& device, PdfSaveOptions opts)
     try
     {
         device.Seek(0, SeekDirection::End);
+
+        // Chain to the revision written by the previous incremental
+        // update only if the device still ends with it, otherwise
+        // chain to the revision the document was loaded from
+        if (&device == m_UpdateDevice && device.GetPosition() == m_UpdateDeviceLength)
+            writer.SetPrevXRefOffset(m_UpdateXRefOffset);
+        else
+            writer.SetPrevXRefOffset(m_PrevXRefOffset);
+
         writer.Write(device);
+
+        m_UpdateDevice = &device;
+        m_UpdateDeviceLength = device.GetPosition();
+        m_UpdateXRefOffset = writer.GetXRefOffset();
     }
     catch (PdfError& e)
     {
@@ -196,7 +290,7 @@ void PdfMemDocument::SaveUpdate(OutputStreamDevice& device, PdfSaveOptions opts)
     }
 }
 
-void PdfMemDocument::beforeWrite(PdfSaveOptions opts)
+void PdfMemDocument::beforeWrite(PdfSaveOptions opts, bool incremental)
 {
     if ((opts & PdfSaveOptions::NoMetadataUpdate) ==
         PdfSaveOptions::None)
@@ -208,11 +302,13 @@ void PdfMemDocument::beforeWrite(PdfSaveOptions opts)
     GetFonts().EmbedFonts();
 
     // After we are done with all operations on objects,
-    // we can collect garbage
-    if ((opts & PdfSaveOptions::NoCollectGarbage) ==
+    // we can collect garbage. Incremental updates only write
+    // dirty objects, so they don't need to visit (and load)
+    // the whole object graph
+    if (!incremental && (opts & PdfSaveOptions::NoCollectGarbage) ==
         PdfSaveOptions::None)
     {
-        CollectGarbage();
+        CollectGarbage((opts & PdfSaveOptions::ParallelWrite) != PdfSaveOptions::None);
     }
 }
 
@@ -231,6 +327,14 @@ void PdfMemDocument::SetEncrypt(unique_ptr<PdfEncrypt>&& encrypt)
         m_Encrypt.reset(new PdfEncryptSession(std::move(encrypt)));
 }
 
+void PdfMemDocument::SetObjectStreamSize(unsigned size)
+{
+    if (size == 0 || size > numeric_limits<uint16_t>::max())
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::ValueOutOfRange, "Invalid object stream size");
+
+    m_ObjectStreamSize = size;
+}
+
 const PdfEncrypt* PdfMemDocument::GetEncrypt() const
 {
     if (m_Encrypt == nullptr)
@@ -248,3 +352,19 @@ PdfVersion PdfMemDocument::GetPdfVersion() const
 {
     return m_Version;
 }
+
+int64_t getModificationTime(const string_view& filename)
+{
+    std::error_code ec;
+    auto time = fs::last_write_time(fs::u8path(filename), ec);
+    if (ec)
+        return 0;
+
+    return (int64_t)time.time_since_epoch().count();
+}
+
+bool isSameFile(const string_view& filename1, const string_view& filename2)
+{
+    std::error_code ec;
+    return fs::equivalent(fs::u8path(filename1), fs::u8path(filename2), ec);
+}
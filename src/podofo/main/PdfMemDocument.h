@@ -43,7 +43,8 @@ public:
      */
     PdfMemDocument();
 
-    PdfMemDocument(std::shared_ptr<InputStreamDevice> device, const std::string_view& password = { });
+    PdfMemDocument(std::shared_ptr<InputStreamDevice> device, const std::string_view& password = { },
+        PdfLoadOptions opts = PdfLoadOptions::None);
 
     /** Construct a copy of the given document
      */
@@ -52,29 +53,38 @@ public:
     /** Load a PdfMemDocument from a file
      *
      *  \param filename filename of the file which is going to be parsed/opened
+     *  \param opts options to control how the objects are loaded
      *
      *  When the bForUpdate is set to true, the filename is copied
      *  for later use by WriteUpdate.
      *
+     *  \remarks With PdfLoadOptions::MemoryMap the file is memory mapped
+     *  for reading, so it must not be truncated or overwritten while the
+     *  document is loaded
      *  \see WriteUpdate, LoadFromBuffer, LoadFromDevice
      */
-    void Load(const std::string_view& filename, const std::string_view& password = { });
+    void Load(const std::string_view& filename, const std::string_view& password = { },
+        PdfLoadOptions opts = PdfLoadOptions::None);
 
     /** Load a PdfMemDocument from a buffer in memory
      *
      *  \param buffer a memory area containing the PDF data
+     *  \param opts options to control how the objects are loaded
      *
      *  \see WriteUpdate, Load, LoadFromDevice
      */
-    void LoadFromBuffer(const bufferview& buffer, const std::string_view& password = { });
+    void LoadFromBuffer(const bufferview& buffer, const std::string_view& password = { },
+        PdfLoadOptions opts = PdfLoadOptions::None);
 
     /** Load a PdfMemDocument from a PdfRefCountedInputDevice
      *
      *  \param device the input device containing the PDF
+     *  \param opts options to control how the objects are loaded
      *
      *  \see WriteUpdate, Load, LoadFromBuffer
      */
-    void Load(std::shared_ptr<InputStreamDevice> device, const std::string_view& password = { });
+    void Load(std::shared_ptr<InputStreamDevice> device, const std::string_view& password = { },
+        PdfLoadOptions opts = PdfLoadOptions::None);
 
     /** Save the complete document to a file
      *
@@ -121,6 +131,15 @@ public:
      *  Writes the document changes to the output device as an incremental update.
      *  The document should be loaded with bForUpdate = true, otherwise
      *  an exception is thrown.
+     *  Further changes can be saved as a new incremental update on the same
+     *  device, without loading the document again. Updates written to any
+     *  other device chain to the revision the document was loaded from
+     *  \remarks Only the objects modified since the document was loaded or
+     *  last saved are written and no garbage collection is performed,
+     *  so the cost is proportional to the size of the changes. Newly
+     *  created objects are written even if nothing references them,
+     *  while earlier releases removed them with a garbage collection:
+     *  call CollectGarbage() before saving to drop them
      *
      *  \see Save, SaveUpdate
      */
@@ -152,6 +171,14 @@ public:
 
     const PdfEncrypt* GetEncrypt() const override;
 
+    /** Set the maximum count of objects packed in each
+     *  object stream when saving with PdfSaveOptions::ObjectStreams
+     *  \param size the count of objects, ranging from 1 to 65535
+     */
+    void SetObjectStreamSize(unsigned size);
+
+    inline unsigned GetObjectStreamSize() const { return m_ObjectStreamSize; }
+
 protected:
     /** Set the PDF Version of the document. Has to be called before Write() to
      *  have an effect.
@@ -165,7 +192,8 @@ private:
     PdfMemDocument(bool empty);
 
 private:
-    void loadFromDevice(std::shared_ptr<InputStreamDevice>&& device, const std::string_view& password);
+    void loadFromDevice(std::shared_ptr<InputStreamDevice>&& device, const std::string_view& password,
+        PdfLoadOptions opts, const std::string_view& filename = { });
 
     /** Internal method to load all objects from a PdfParser object.
      *  The objects will be removed from the parser and are now
@@ -179,7 +207,7 @@ private:
 
     void reset() override;
 
-    void beforeWrite(PdfSaveOptions options);
+    void beforeWrite(PdfSaveOptions options, bool incremental);
 
 private:
     PdfMemDocument& operator=(const PdfMemDocument&) = delete;
@@ -189,6 +217,12 @@ private:
     PdfVersion m_InitialVersion;
     bool m_HasXRefStream;
     int64_t m_PrevXRefOffset;
+    unsigned m_ObjectStreamSize;
+    // The device of the last incremental update, its length and the
+    // offset of the xref written there, used to chain further updates
+    const OutputStreamDevice* m_UpdateDevice;
+    size_t m_UpdateDeviceLength;
+    int64_t m_UpdateXRefOffset;
     std::unique_ptr<PdfEncryptSession> m_Encrypt;
     std::shared_ptr<InputStreamDevice> m_device;
 };
@@ -82,3 +82,9 @@ size_t PdfMemoryObjectStream::GetLength() const
 {
     return m_buffer.size();
 }
+
+bool PdfMemoryObjectStream::TryGetRawView(bufferview& view) const
+{
+    view = bufferview(m_buffer.data(), m_buffer.size());
+    return true;
+}
@@ -49,6 +49,8 @@ public:
 
     size_t GetLength() const override;
 
+    bool TryGetRawView(bufferview& view) const override;
+
     const charbuff& GetBuffer() const { return m_buffer; }
 
  private:
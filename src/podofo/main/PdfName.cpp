@@ -21,6 +21,7 @@ void hexchr(const unsigned char ch, T& it);
 
 static void escapeNameTo(string& dst, bufferview view);
 static charbuff unescapeName(string_view view);
+static const unordered_set<string_view>& getWellKnownNames();
 
 const PdfName PdfName::Null = PdfName();
 
@@ -148,22 +149,15 @@ void PdfName::moveFrom(PdfName&& rhs)
 
 PdfName PdfName::FromEscaped(const string_view& view)
 {
-    // Slightly optimize memory usage by checking
-    // against some well known values
-    if (view == "Filter"sv)
-        return "Filter"_n;
-    else if (view == "Length"sv)
-        return "Length"_n;
-    else if (view == "FlateDecode"sv)
-        return "FlateDecode"_n;
-    else if (view == "Type"sv)
-        return "Type"_n;
-    else if (view == "Subtype"sv)
-        return "Subtype"_n;
-    else if (view == "Parent"sv)
-        return "Parent"_n;
-    else
+    // Optimize memory usage and allocations by resolving
+    // well known names to shared read-only literals. Well
+    // known names have no characters requiring escaping
+    auto& names = getWellKnownNames();
+    auto found = names.find(view);
+    if (found == names.end())
         return PdfName(unescapeName(view));
+    else
+        return PdfName(*found->data(), found->size());
 }
 
 PdfName PdfName::FromRaw(const bufferview& rawcontent)
@@ -333,12 +327,19 @@ string_view PdfName::GetRawData() const
 
 bool PdfName::operator==(const PdfName& rhs) const
 {
-    return this->GetRawData() == rhs.GetRawData();
+    auto lhsData = this->GetRawData();
+    auto rhsData = rhs.GetRawData();
+    // Names sharing the same data, like well known
+    // names or copies, can be compared by pointer
+    if (lhsData.data() == rhsData.data())
+        return lhsData.size() == rhsData.size();
+
+    return lhsData == rhsData;
 }
 
 bool PdfName::operator!=(const PdfName& rhs) const
 {
-    return this->GetRawData() != rhs.GetRawData();
+    return !operator==(rhs);
 }
 
 bool PdfName::operator==(const char* str) const
@@ -398,3 +399,37 @@ void hexchr(const unsigned char ch, T& it)
     *(it++) = "0123456789ABCDEF"[ch / 16];
     *(it++) = "0123456789ABCDEF"[ch % 16];
 }
+
+// Names most frequently found as dictionary keys and values
+const unordered_set<string_view>& getWellKnownNames()
+{
+    static unordered_set<string_view> names = {
+        "A"sv, "AA"sv, "AcroForm"sv, "Annot"sv, "Annots"sv, "AP"sv, "AS"sv, "Ascent"sv,
+        "BaseEncoding"sv, "BaseFont"sv, "BBox"sv, "BitsPerComponent"sv, "Border"sv,
+        "Bounds"sv, "C"sv, "CapHeight"sv, "Catalog"sv, "CIDFontType0"sv, "CIDFontType2"sv,
+        "CIDSystemInfo"sv, "CIDToGIDMap"sv, "Colors"sv, "ColorSpace"sv, "Columns"sv,
+        "Contents"sv, "Count"sv, "CropBox"sv, "CS"sv, "D"sv, "DA"sv, "DCTDecode"sv,
+        "Decode"sv, "DecodeParms"sv, "DescendantFonts"sv, "Descent"sv, "Dest"sv,
+        "Dests"sv, "DeviceCMYK"sv, "DeviceGray"sv, "DeviceRGB"sv, "Differences"sv,
+        "Domain"sv, "DR"sv, "DV"sv, "Encode"sv, "Encoding"sv, "Encrypt"sv, "ExtGState"sv,
+        "Extends"sv, "F"sv, "Ff"sv, "Fields"sv, "Filter"sv, "First"sv, "FirstChar"sv,
+        "Flags"sv, "FlateDecode"sv, "Font"sv, "FontBBox"sv, "FontDescriptor"sv,
+        "FontFile"sv, "FontFile2"sv, "FontFile3"sv, "FontName"sv, "Form"sv, "FT"sv,
+        "FunctionType"sv, "Functions"sv, "Group"sv, "Height"sv, "I"sv, "ICCBased"sv,
+        "ID"sv, "Identity"sv, "Identity-H"sv, "Image"sv, "ImageB"sv, "ImageC"sv,
+        "ImageI"sv, "Index"sv, "Indexed"sv, "Info"sv, "ItalicAngle"sv, "JavaScript"sv,
+        "Kids"sv, "Lang"sv, "Last"sv, "LastChar"sv, "Length"sv, "Length1"sv, "Length2"sv,
+        "Length3"sv, "Limits"sv, "Link"sv, "MarkInfo"sv, "Mask"sv, "Matrix"sv,
+        "MediaBox"sv, "Metadata"sv, "MissingWidth"sv, "N"sv, "Names"sv, "Next"sv,
+        "Nums"sv, "ObjStm"sv, "OpenAction"sv, "Ordering"sv, "Outlines"sv, "P"sv,
+        "Page"sv, "PageLabels"sv, "PageMode"sv, "Pages"sv, "Parent"sv, "Pattern"sv,
+        "PatternType"sv, "PDF"sv, "Predictor"sv, "Prev"sv, "ProcSet"sv, "R"sv,
+        "Range"sv, "Rect"sv, "Registry"sv, "Resources"sv, "Root"sv, "Rotate"sv, "S"sv,
+        "Separation"sv, "Shading"sv, "ShadingType"sv, "Size"sv, "SMask"sv, "StemV"sv,
+        "StructParent"sv, "StructParents"sv, "StructTreeRoot"sv, "Subtype"sv,
+        "Supplement"sv, "T"sv, "Tabs"sv, "Text"sv, "ToUnicode"sv, "TrimBox"sv,
+        "TrueType"sv, "Type"sv, "Type0"sv, "Type1"sv, "URI"sv, "V"sv, "W"sv, "Widget"sv,
+        "Width"sv, "Widths"sv, "WinAnsiEncoding"sv, "XObject"sv, "XRef"sv, "XYZ"sv,
+    };
+    return names;
+}
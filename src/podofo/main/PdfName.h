@@ -211,7 +211,7 @@ struct PODOFO_API PdfNameEquality
 
     inline bool operator()(const PdfName& lhs, const PdfName& rhs) const
     {
-        return lhs.GetRawData() == rhs.GetRawData();
+        return lhs == rhs;
     }
     inline bool operator()(const PdfName& lhs, const std::string_view& rhs) const
     {
@@ -182,6 +182,8 @@ void PdfObject::DelayedLoad() const
     const_cast<PdfObject&>(*this).delayedLoad();
     m_IsDelayedLoadDone = true;
     const_cast<PdfObject&>(*this).SetVariantOwner();
+    if (m_Document != nullptr)
+        m_Document->GetObjects().trackLoadedObject(*this);
 }
 
 void PdfObject::delayedLoad()
@@ -352,6 +354,20 @@ bool PdfObject::TryUnload()
     return false;
 }
 
+bool PdfObject::TryGetRawStreamView(bufferview& view) const
+{
+    DelayedLoad();
+    if (m_IsDelayedLoadStreamDone)
+    {
+        if (m_Stream == nullptr)
+            return false;
+
+        return m_Stream->GetProvider().TryGetRawView(view);
+    }
+
+    return tryGetRawStreamView(view);
+}
+
 bool PdfObject::HasStream() const
 {
     DelayedLoad();
@@ -401,6 +417,8 @@ void PdfObject::delayedLoadStream() const
 
     const_cast<PdfObject&>(*this).delayedLoadStream();
     m_IsDelayedLoadStreamDone = true;
+    if (m_Document != nullptr)
+        m_Document->GetObjects().trackLoadedObject(*this);
 }
 
 // TODO2: SetDirty only if the value to be added is different
@@ -463,6 +481,57 @@ void PdfObject::delayedLoadStream()
     PODOFO_RAISE_ERROR(PdfErrorCode::InternalLogic);
 }
 
+bool PdfObject::tryGetRawStreamView(bufferview& view) const
+{
+    (void)view;
+    return false;
+}
+
+bool PdfObject::tryReadReferences(vector<PdfReference>& references, bool concurrent) const
+{
+    (void)references;
+    (void)concurrent;
+    return false;
+}
+
+void PdfObject::collectReferences(const PdfVariant& variant, vector<PdfReference>& references)
+{
+    // NOTE: Use an explicit stack, since deeply nested
+    // direct objects may otherwise overflow the call stack
+    vector<const PdfVariant*> stack;
+    stack.push_back(&variant);
+    while (!stack.empty())
+    {
+        auto curr = stack.back();
+        stack.pop_back();
+        switch (curr->GetDataType())
+        {
+            case PdfDataType::Reference:
+            {
+                references.push_back(curr->GetReferenceUnsafe());
+                break;
+            }
+            case PdfDataType::Array:
+            {
+                for (auto& child : curr->GetArrayUnsafe())
+                    stack.push_back(&child.m_Variant);
+                break;
+            }
+            case PdfDataType::Dictionary:
+            {
+                for (auto& pair : curr->GetDictionaryUnsafe())
+                    stack.push_back(&pair.second.m_Variant);
+                break;
+            }
+            default:
+            {
+                // Nothing to do
+                break;
+            }
+        }
+    }
+}
+
 bool PdfObject::removeStream()
 {
     // Do nothing for regular object
@@ -579,12 +648,18 @@ void PdfObject::SetDirty()
 
 void PdfObject::setDirty()
 {
+    if (!m_IsDirty && m_Document != nullptr && m_IndirectReference.IsIndirect())
+        m_Document->GetObjects().markObjectDirty(m_IndirectReference);
+
     m_IsDirty = true;
     SetRevised();
 }
 
 void PdfObject::resetDirty()
 {
+    if (m_IsDirty && m_Document != nullptr && m_IndirectReference.IsIndirect())
+        m_Document->GetObjects().unmarkObjectDirty(m_IndirectReference);
+
     m_IsDirty = false;
 }
 
@@ -340,6 +340,22 @@ public:
      */
     const PdfObjectStream& MustGetStream() const;
 
+    /** Try to get a read-only view of the raw stream data, i.e. with
+     * all filters still applied, without copying it
+     *
+     * The view is retrieved directly from the stream buffer, if it's
+     * held in memory, or from the source device for streams of parsed
+     * objects not yet loaded. The latter is possible only if the device
+     * supports buffer views (e.g. memory mapped files or buffers)
+     * and the stream is not encrypted
+     * \returns false if the object has no stream or if a view of
+     *      the data can't be obtained. Use PdfObjectStream::GetCopy(true)
+     *      in this case
+     * \remarks The view is valid until the stream is modified or the
+     *      object unloaded, and as long as the source document is alive
+     */
+    bool TryGetRawStreamView(bufferview& view) const;
+
     /** Get a handle to a const PDF stream object.
      * Throws if there's no stream
      */
@@ -478,6 +494,23 @@ protected:
 
     virtual void delayedLoadStream();
 
+    /** Try to get a view of the raw stream data that is not loaded yet.
+     * The default implementation returns false
+     */
+    virtual bool tryGetRawStreamView(bufferview& view) const;
+
+    /** Try to read the references contained in the object
+     * without loading it. The default implementation returns false
+     * \param concurrent true if the call may run concurrently with
+     *      calls on other objects of the same document
+     */
+    virtual bool tryReadReferences(std::vector<PdfReference>& references, bool concurrent) const;
+
+    /** Append the references contained in the variant, also
+     * nested in arrays and dictionaries, without recursion
+     */
+    static void collectReferences(const PdfVariant& variant, std::vector<PdfReference>& references);
+
     /**
      * \returns true if the stream was removed
      */
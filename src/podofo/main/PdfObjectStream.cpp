@@ -561,6 +561,12 @@ PdfObjectOutputStream& PdfObjectOutputStream::operator=(PdfObjectOutputStream&&
 
 PdfObjectStreamProvider::~PdfObjectStreamProvider() { }
 
+bool PdfObjectStreamProvider::TryGetRawView(bufferview& view) const
+{
+    (void)view;
+    return false;
+}
+
 // Strip media filters from regular ones
 PdfFilterList stripMediaFilters(const PdfFilterList& filters, PdfFilterList& mediaFilters)
 {
@@ -35,6 +35,12 @@ public:
     virtual void Write(OutputStream& stream, const PdfStatefulEncrypt* encrypt) = 0;
 
     virtual size_t GetLength() const = 0;
+
+    /** Try to get a view of the raw stream data without copying it
+     * \returns false if the data is not available as a contiguous buffer,
+     *      which is the default
+     */
+    virtual bool TryGetRawView(bufferview& view) const;
 };
 
 };
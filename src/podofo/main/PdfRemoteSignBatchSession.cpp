@@ -0,0 +1,127 @@
+// PdfRemoteSignBatchSession.cpp
+/**
+ * @file PdfRemoteSignBatchSession.cpp
+ * @brief Implementation of batch remote signing over many documents.
+ */
+
+#include "PdfRemoteSignBatchSession.h"
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
+
+PoDoFo::PdfRemoteSignBatchSession::PdfRemoteSignBatchSession(
+    const std::vector<DocumentConfig>& documents,
+    const std::string& hashAlgorithmOid,
+    const std::string& endCertificateBase64,
+    const std::vector<std::string>& certificateChainBase64,
+    const std::optional<std::string>& rootEntityCertificateBase64,
+    const std::optional<std::string>& label,
+    unsigned maxConcurrency
+)
+    : _prepared(documents.size(), false)
+    , _maxConcurrency(maxConcurrency)
+{
+    if (documents.empty()) {
+        throw std::runtime_error("The batch must contain at least one document");
+    }
+
+    if (_maxConcurrency == 0) {
+        _maxConcurrency = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    _sessions.reserve(documents.size());
+    for (const auto& document : documents) {
+        _sessions.push_back(std::make_unique<PdfRemoteSignDocumentSession>(
+            document.conformance_level,
+            hashAlgorithmOid,
+            document.document_input_path,
+            document.document_output_path,
+            endCertificateBase64,
+            certificateChainBase64,
+            rootEntityCertificateBase64,
+            label));
+    }
+}
+
+PoDoFo::PdfRemoteSignBatchSession::~PdfRemoteSignBatchSession() = default;
+
+void PoDoFo::PdfRemoteSignBatchSession::setOutputMode(SigningOutputMode mode) {
+    for (auto& session : _sessions) {
+        session->setOutputMode(mode);
+    }
+}
+
+std::vector<PoDoFo::BatchDocumentResult> PoDoFo::PdfRemoteSignBatchSession::beginSigning() {
+    auto results = forEachDocument([&](size_t index, BatchDocumentResult& result) {
+        result.hash = _sessions[index]->beginSigning();
+    });
+    for (size_t i = 0; i < results.size(); ++i) {
+        _prepared[i] = results[i].succeeded();
+    }
+    return results;
+}
+
+std::vector<PoDoFo::BatchDocumentResult> PoDoFo::PdfRemoteSignBatchSession::finishSigning(const std::vector<std::string>& signedHashes,
+    const std::vector<std::string>& base64Tsrs, const std::optional<ValidationData>& validationData) {
+    if (signedHashes.size() != _sessions.size()) {
+        throw std::runtime_error("The number of signed hashes doesn't match the number of documents");
+    }
+
+    if (!base64Tsrs.empty() && base64Tsrs.size() != _sessions.size()) {
+        throw std::runtime_error("The number of timestamp responses doesn't match the number of documents");
+    }
+
+    return forEachDocument([&](size_t index, BatchDocumentResult&) {
+        static const std::string noTsr;
+        if (!_prepared[index]) {
+            throw std::runtime_error("The document was not prepared for signing");
+        }
+        _sessions[index]->finishSigning(signedHashes[index],
+            base64Tsrs.empty() ? noTsr : base64Tsrs[index], validationData);
+    });
+}
+
+PoDoFo::PdfRemoteSignDocumentSession& PoDoFo::PdfRemoteSignBatchSession::getSession(size_t index) {
+    if (index >= _sessions.size()) {
+        throw std::out_of_range("Document index out of range");
+    }
+    return *_sessions[index];
+}
+
+std::vector<PoDoFo::BatchDocumentResult> PoDoFo::PdfRemoteSignBatchSession::forEachDocument(
+    const std::function<void(size_t, BatchDocumentResult&)>& task) {
+    std::vector<BatchDocumentResult> results(_sessions.size());
+    std::atomic<size_t> next(0);
+
+    // NOTE: Each worker only touches the results of the documents it picked
+    auto worker = [&]() {
+        size_t index;
+        while ((index = next++) < _sessions.size()) {
+            try {
+                task(index, results[index]);
+            }
+            catch (const std::exception& e) {
+                results[index].error = *e.what() == '\0' ? "Unknown error" : e.what();
+            }
+            catch (...) {
+                results[index].error = "Unknown error";
+            }
+        }
+    };
+
+    size_t workerCount = std::min<size_t>(_maxConcurrency, _sessions.size());
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount - 1);
+    for (size_t i = 1; i < workerCount; ++i) {
+        workers.emplace_back(worker);
+    }
+
+    // The calling thread takes part to the work as well
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    return results;
+}
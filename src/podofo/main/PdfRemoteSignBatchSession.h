@@ -0,0 +1,129 @@
+// PdfRemoteSignBatchSession.h
+/**
+ * @file PdfRemoteSignBatchSession.h
+ * @brief Batch remote signing of many PDF documents with a single remote signing round trip.
+ *
+ * This header declares the `PdfRemoteSignBatchSession` which prepares N documents in parallel,
+ * returns their N hashes so they can be signed by the remote service in one call (for example
+ * a single CSC `signatures/signHash` request with one credential authorization), and then
+ * finishes all the documents concurrently with the N signed values.
+ */
+#ifndef PDF_REMOTE_SIGN_BATCH_SESSION_H
+#define PDF_REMOTE_SIGN_BATCH_SESSION_H
+
+#include "PdfRemoteSignDocumentSession.h"
+#include <functional>
+
+namespace PoDoFo {
+
+    /**
+     * @brief Outcome of a batch signing step for a single document.
+     */
+    struct PODOFO_API BatchDocumentResult {
+        std::string hash;   /**< URL-encoded base64 hash to sign, only set by beginSigning() */
+        std::string error;  /**< Failure description, empty if the document succeeded */
+
+        /** @return true if the document succeeded */
+        bool succeeded() const { return error.empty(); }
+    };
+
+    /**
+     * @brief Represents a batch of PDF remote signing sessions sharing the same signer.
+     *
+     * The flow mirrors `PdfRemoteSignDocumentSession`:
+     * 1) beginSigning(): prepares all the documents in parallel and returns one hash per document.
+     * 2) finishSigning(): injects the signed values, in the same order, and finishes all the documents in parallel.
+     *
+     * Each document keeps its own conformance level, as specified in its `DocumentConfig`.
+     * A failure in a document doesn't affect the others: each step reports a result per
+     * document, and documents that failed beginSigning() are skipped by finishSigning().
+     */
+    class PODOFO_API PdfRemoteSignBatchSession final {
+    public:
+        /**
+         * @brief Construct a batch signing session.
+         * @param documents Documents to sign, each with its own input/output path and conformance level.
+         * @param hashAlgorithmOid Digest OID string (e.g. 2.16.840.1.101.3.4.2.1 for SHA-256).
+         * @param endCertificateBase64 End-entity certificate, base64 DER.
+         * @param certificateChainBase64 Certificate chain, each item base64 DER.
+         * @param rootEntityCertificateBase64 Optional root certificate, base64 DER.
+         * @param label Optional label for diagnostics.
+         * @param maxConcurrency Maximum number of documents processed at the same time, 0 to use the hardware concurrency.
+         */
+        PdfRemoteSignBatchSession(
+            const std::vector<DocumentConfig>& documents,
+            const std::string& hashAlgorithmOid,
+            const std::string& endCertificateBase64,
+            const std::vector<std::string>& certificateChainBase64,
+            const std::optional<std::string>& rootEntityCertificateBase64 = std::nullopt,
+            const std::optional<std::string>& label = std::nullopt,
+            unsigned maxConcurrency = 0
+        );
+
+        /**
+         * @brief Copy constructor (deleted)
+         */
+        PdfRemoteSignBatchSession(const PdfRemoteSignBatchSession&) = delete;
+        /**
+         * @brief Copy assignment operator (deleted)
+         */
+        PdfRemoteSignBatchSession& operator=(const PdfRemoteSignBatchSession&) = delete;
+        /**
+         * @brief Destructor
+         */
+        ~PdfRemoteSignBatchSession();
+
+        /**
+         * @brief Selects how the output documents are produced. Must be called before beginSigning().
+         * @param mode The output mode to use for all documents
+         */
+        void setOutputMode(SigningOutputMode mode);
+
+        /**
+         * @brief Prepare all the documents and compute their hashes to be signed remotely.
+         * @return One result per document, in the same order as the documents, holding
+         *      either the hash to sign or the error that made the document fail.
+         */
+        std::vector<BatchDocumentResult> beginSigning();
+
+        /**
+         * @brief Finish all the documents by injecting the remote signatures.
+         * @param signedHashes Base64-encoded signed values, in the same order as the hashes returned by beginSigning().
+         *      Entries of documents that failed beginSigning() are ignored and can be empty.
+         * @param base64Tsrs Base64-encoded TimeStampResp per document (entries are ignored for ADES_B_B documents).
+         *      It can be empty if no document requires a timestamp.
+         * @param validationData Optional validation artifacts to embed into the DSS of every document.
+         * @return One result per document, in the same order as the documents.
+         * @throws std::runtime_error if the number of signed values or timestamp responses doesn't match
+         *      the number of documents.
+         */
+        std::vector<BatchDocumentResult> finishSigning(const std::vector<std::string>& signedHashes,
+            const std::vector<std::string>& base64Tsrs = {},
+            const std::optional<ValidationData>& validationData = std::nullopt);
+
+        /** @return Number of documents in the batch. */
+        size_t documentCount() const { return _sessions.size(); }
+
+        /**
+         * @brief Gets the session of a single document, for example for LTA timestamping.
+         * @param index Index of the document
+         * @return The document signing session
+         */
+        PdfRemoteSignDocumentSession& getSession(size_t index);
+
+    private:
+        /**
+         * @brief Runs the given task for each document with bounded parallelism
+         * @param task The task to run, receiving the document index and its result
+         * @return The results, with the error of each document whose task threw
+         */
+        std::vector<BatchDocumentResult> forEachDocument(const std::function<void(size_t, BatchDocumentResult&)>& task);
+
+        std::vector<std::unique_ptr<PdfRemoteSignDocumentSession>> _sessions;
+        std::vector<bool>                                          _prepared;
+        unsigned                                                   _maxConcurrency;
+    };
+
+} // namespace PoDoFo
+
+#endif // PDF_REMOTE_SIGN_BATCH_SESSION_H
@@ -8,7 +8,9 @@
 #  define _CRT_SECURE_NO_WARNINGS
 #endif
 
+#include <podofo/private/PdfDeclarationsPrivate.h>
 #include "PdfRemoteSignDocumentSession.h"
+#include "PdfTokenizer.h"
 #include <podofo/private/OpenSSLInternal.h>
 #include <openssl/bio.h>
 #include <iterator>
@@ -24,6 +26,15 @@
 
 namespace fs = std::filesystem;
 
+// Version of the blob produced by exportState()
+constexpr int64_t SessionStateVersion = 1;
+// Room reserved for a DocTimeStamp token of unknown size
+constexpr size_t DefaultTimestampTokenSize = 20000;
+// Tokens of the same TSA may still grow, e.g. embedding a different
+// certificate chain: keep a wide margin over the hinted size, at least
+// half of it, as unused room in /Contents is just zero padding
+constexpr size_t TimestampTokenSizeMargin = 4096;
+
 /**
  * @brief Builds an input path under the local `input/` folder
  * @param filename Relative filename
@@ -45,6 +56,25 @@ static std::vector<unsigned char> ReadBinary(const std::string& path) {
              std::istreambuf_iterator<char>() };
 }
 
+/**
+ * @brief Decodes a base64 or base64url string into a buffer, without intermediate copies
+ * @param buffer The output buffer, resized to the decoded length
+ * @param base64 The base64 string
+ * @param error Message of the exception thrown on failure
+ * @throws std::runtime_error if the input is empty or not valid base64
+ */
+template <typename TBuffer>
+static void decodeBase64To(TBuffer& buffer, const std::string_view& base64, const char* error) {
+    buffer.resize(utls::GetBase64DecodedMaxLength(base64.size()));
+    size_t written;
+    if (!utls::TryDecodeBase64(base64, PoDoFo::bufferspan(reinterpret_cast<char*>(buffer.data()), buffer.size()), written) ||
+        written == 0) {
+        throw std::runtime_error(error);
+    }
+
+    buffer.resize(written);
+}
+
 /**
  * @brief Deleter implementation; frees a BIO chain with BIO_free_all
  * @param b Pointer to the BIO chain to free
@@ -53,6 +83,10 @@ void PoDoFo::BioFreeAll::operator()(BIO* b) const noexcept {
     if (b) BIO_free_all(b);
 }
 
+void PoDoFo::EvpMdCtxFree::operator()(EVP_MD_CTX* ctx) const noexcept {
+    EVP_MD_CTX_free(ctx);
+}
+
 /**
  * @brief Constructor for PdfRemoteSignDocumentSession
  * @param conformanceLevel The conformance level for the signing operation
@@ -76,6 +110,7 @@ PoDoFo::PdfRemoteSignDocumentSession::PdfRemoteSignDocumentSession(
 )
     : _conformanceLevel(conformanceLevel)
     , _hashAlgorithm(hashAlgorithmFromOid(hashAlgorithmOid))
+    , _outputMode(SigningOutputMode::CopyInput)
     , _documentInputPath(documentInputPath)
     , _documentOutputPath(documentOutputPath)
     , _endCertificateBase64(endCertificateBase64)
@@ -110,78 +145,38 @@ PoDoFo::PdfRemoteSignDocumentSession::~PdfRemoteSignDocumentSession() = default;
  */
 std::string PoDoFo::PdfRemoteSignDocumentSession::beginSigning() {
     try {
-        fs::copy_file(_documentInputPath, _documentOutputPath, fs::copy_options::overwrite_existing);
-        _stream = std::make_shared<PoDoFo::FileStreamDevice>(_documentOutputPath, PoDoFo::FileMode::Open);
-
-        std::string cert;
-        cert.assign(_endCertificateDer.begin(), _endCertificateDer.end());
+        openOutputStream(false);
 
-        _doc.Load(_stream);
+        _doc = std::make_unique<PoDoFo::PdfMemDocument>();
+        _doc->Load(_stream);
 
-        auto& acroForm = _doc.GetOrCreateAcroForm();
+        auto& acroForm = _doc->GetOrCreateAcroForm();
         acroForm.GetDictionary().AddKey("SigFlags"_n, (int64_t)3);
 
-        auto& page = _doc.GetPages().GetPageAt(0);
+        auto& page = _doc->GetPages().GetPageAt(0);
         auto& field = page.CreateField("Signature", PoDoFo::PdfFieldType::Signature, PoDoFo::Rect(0, 0, 0, 0));
         auto& signature = static_cast<PoDoFo::PdfSignature&>(field);
         signature.MustGetWidget().SetFlags(PoDoFo::PdfAnnotationFlags::Invisible | PoDoFo::PdfAnnotationFlags::Hidden);
         signature.SetSignatureDate(PoDoFo::PdfDate::LocalNow());
 
-        if (_conformanceLevel == "ADES_B_B") {
-            _cmsParams.SignatureType = PoDoFo::PdfSignatureType::PAdES_B;
-        }
-        else if (_conformanceLevel == "ADES_B_T") {
-            _cmsParams.SignatureType = PoDoFo::PdfSignatureType::PAdES_B_T;
-        }
-        else if (_conformanceLevel == "ADES_B_LT") {
-            _cmsParams.SignatureType = PoDoFo::PdfSignatureType::PAdES_B_LT;
-        }
-        else if (_conformanceLevel == "ADES_B_LTA") {
-            _cmsParams.SignatureType = PoDoFo::PdfSignatureType::PAdES_B_LTA;
-        }
-        else {
-            throw std::runtime_error("Invalid conformance level");
-        }
-
-        if (_hashAlgorithm == HashAlgorithm::SHA256) {
-            _cmsParams.Hashing = PoDoFo::PdfHashingAlgorithm::SHA256;
-        }
-        else if (_hashAlgorithm == HashAlgorithm::SHA384) {
-            _cmsParams.Hashing = PoDoFo::PdfHashingAlgorithm::SHA384;
-        }
-        else if (_hashAlgorithm == HashAlgorithm::SHA512) {
-            _cmsParams.Hashing = PoDoFo::PdfHashingAlgorithm::SHA512;
-        }
-        else {
-            throw std::runtime_error("Hash algorithm is not supported");
-        }
+        initCmsParams();
 
         std::vector<charbuff> chain;
         for (const auto& cert : _certificateChainDer)
             chain.emplace_back(reinterpret_cast<const char*>(cert.data()), cert.size());
 
+        PoDoFo::bufferview cert(reinterpret_cast<const char*>(_endCertificateDer.data()), _endCertificateDer.size());
         _signer = std::make_shared<PoDoFo::PdfSignerCms>(cert, chain, _cmsParams);
         _signer->ReserveAttributeSize(20000);
-        _signerId = _ctx.AddSigner(signature, _signer);
-
-        _ctx.StartSigning(_doc, _stream, _results, PoDoFo::PdfSaveOptions::NoMetadataUpdate);
+        _ctx = std::make_unique<PoDoFo::PdfSigningContext>();
+        _signerId = _ctx->AddSigner(signature, _signer);
 
-        auto& INITIAL_hash = _results.Intermediate[_signerId];
-        auto rawCmsHash = ToHexString(INITIAL_hash);
+        _ctx->StartSigning(*_doc, _stream, _results, PoDoFo::PdfSaveOptions::NoMetadataUpdate);
 
-        auto binaryHash = HexToBytes(rawCmsHash);
-        PoDoFo::charbuff binaryCharbuff;
-        binaryCharbuff.assign(reinterpret_cast<const char*>(binaryHash.data()), binaryHash.size());
-
-        auto base64Hash = ToBase64(binaryCharbuff);
-
-        auto urlEncodedHash = UrlEncode(base64Hash);
-
-        return urlEncodedHash;
+        return UrlEncode(ToBase64(_results.Intermediate[_signerId]));
     }
     catch (const std::exception& e) {
-        std::cout << "\n=== Error in Signing Process ===" << std::endl;
-        std::cout << "Error: " << e.what() << std::endl;
+        PoDoFo::LogMessage(PoDoFo::PdfLogSeverity::Error, "Error in signing process: {}", e.what());
         _stream.reset();
         throw;
     }
@@ -197,9 +192,8 @@ std::string PoDoFo::PdfRemoteSignDocumentSession::beginSigning() {
 void PoDoFo::PdfRemoteSignDocumentSession::finishSigning(const std::string& signedHash, const std::string& base64Tsr, const std::optional<ValidationData>& validationData) {
     try {
         PoDoFo::charbuff buff = ConvertDSSHashToSignedHash(signedHash);
-        _results.Intermediate[_signerId] = buff;
 
-        if (!_signer) {
+        if (!_signer || !_stream) {
             throw std::runtime_error("Signer not initialized");
         }
 
@@ -208,37 +202,216 @@ void PoDoFo::PdfRemoteSignDocumentSession::finishSigning(const std::string& sign
         if (_conformanceLevel != "ADES_B_B") {
             tsr = DecodeBase64Tsr(base64Tsr);
             _signer->SetTimestampToken({ tsr.data(), tsr.size() });
+            if (!_timestampTokenSize) {
+                // Use it as a size hint for the DocTimeStamp of the same TSA
+                _timestampTokenSize = ExtractTimestampTokenFromTSR(tsr).size();
+            }
+        }
 
+        if (_ctx) {
+            _results.Intermediate[_signerId] = buff;
+            _ctx->FinishSigning(_results);
+        }
+        else {
+            // Restored with importState(): write the signature directly on the prepared document
+            PoDoFo::PdfSigningContext::FinishSigning(*_stream, _prepared, *_signer, buff);
         }
-        _ctx.FinishSigning(_results);
 
 
-        if (_conformanceLevel == "ADES_B_LT" && validationData.has_value()) {
-            PoDoFo::PdfMemDocument dss_doc;
-            _stream->Seek(0, PoDoFo::SeekDirection::Begin);
-            dss_doc.Load(_stream);
+        if ((_conformanceLevel == "ADES_B_LT" || _conformanceLevel == "ADES_B_LTA") && validationData.has_value()) {
+            appendDSSUpdate(_doc.get(), *validationData);
+        }
 
-            createOrUpdateDSSCatalog(dss_doc, *validationData);
+    }
+    catch (const std::exception& e) {
+        PoDoFo::LogMessage(PoDoFo::PdfLogSeverity::Error, "Error in finish signing: {}", e.what());
+        _stream.reset();
+        throw;
+    }
+}
 
-            dss_doc.SaveUpdate(*_stream, PoDoFo::PdfSaveOptions::NoMetadataUpdate | PoDoFo::PdfSaveOptions::NoFlateCompress);
-        }
+std::string PoDoFo::PdfRemoteSignDocumentSession::exportState() {
+    if (!_ctx || !_signer) {
+        throw std::runtime_error("No signing in progress. Call beginSigning() first.");
+    }
 
-        if (_conformanceLevel == "ADES_B_LTA" && validationData.has_value()) {
-            PoDoFo::PdfMemDocument dss_doc;
-            _stream->Seek(0, PoDoFo::SeekDirection::Begin);
-            dss_doc.Load(_stream);
+    auto prepared = _ctx->GetPreparedSignature(_signerId);
+    PoDoFo::charbuff signerState;
+    _signer->SaveDeferredState(signerState);
+
+    PoDoFo::PdfDictionary dict;
+    dict.AddKey("Version"_n, (int64_t)SessionStateVersion);
+    dict.AddKey("Conformance"_n, PoDoFo::PdfString(_conformanceLevel));
+    dict.AddKey("Hash"_n, PoDoFo::PdfName(hashAlgorithmToString(_hashAlgorithm)));
+    dict.AddKey("Input"_n, PoDoFo::PdfString(_documentInputPath));
+    dict.AddKey("Output"_n, PoDoFo::PdfString(_documentOutputPath));
+    dict.AddKey("OutputMode"_n, (int64_t)_outputMode);
+    dict.AddKey("ByteRangeOffset"_n, (int64_t)prepared.ByteRangeOffset);
+    dict.AddKey("ContentsOffset"_n, (int64_t)prepared.ContentsOffset);
+    dict.AddKey("ContentsSize"_n, (int64_t)prepared.ContentsSize);
+    dict.AddKey("Length"_n, (int64_t)prepared.DeviceLength);
+    dict.AddKey("SignerState"_n, PoDoFo::PdfString::FromRaw(signerState));
+
+    std::string state;
+    PoDoFo::PdfObject(std::move(dict)).ToString(state);
+
+    // Release everything that was kept alive for the finish step
+    _ctx.reset();
+    _doc.reset();
+    _signer.reset();
+    _stream.reset();
+    _results.Intermediate.clear();
+    return state;
+}
 
-            createOrUpdateDSSCatalog(dss_doc, *validationData);
+void PoDoFo::PdfRemoteSignDocumentSession::importState(const std::string& state) {
+    if (_stream) {
+        throw std::runtime_error("A signing is already in progress in this session");
+    }
 
-            dss_doc.SaveUpdate(*_stream, PoDoFo::PdfSaveOptions::NoMetadataUpdate | PoDoFo::PdfSaveOptions::NoFlateCompress);
+    PoDoFo::PdfVariant variant;
+    try {
+        PoDoFo::SpanStreamDevice device(state);
+        PoDoFo::PdfTokenizer tokenizer;
+        tokenizer.ReadNextVariant(device, variant);
+    }
+    catch (const PoDoFo::PdfError& e) {
+        throw std::runtime_error(std::string("Invalid session state: ") + e.what());
+    }
+
+    const PoDoFo::PdfDictionary* dict;
+    if (!variant.TryGetDictionary(dict)) {
+        throw std::runtime_error("Invalid session state");
+    }
+
+    auto getNumber = [&](const std::string_view& key) -> size_t {
+        int64_t number;
+        auto obj = dict->GetKey(key);
+        if (obj == nullptr || !obj->TryGetNumber(number) || number < 0) {
+            throw std::runtime_error("Invalid session state: missing or invalid /" + std::string(key));
+        }
+        return (size_t)number;
+    };
+    auto getString = [&](const std::string_view& key) -> const PoDoFo::PdfString& {
+        const PoDoFo::PdfString* str;
+        auto obj = dict->GetKey(key);
+        if (obj == nullptr || !obj->TryGetString(str)) {
+            throw std::runtime_error("Invalid session state: missing or invalid /" + std::string(key));
         }
+        return *str;
+    };
 
+    if (getNumber("Version") != (size_t)SessionStateVersion) {
+        throw std::runtime_error("Unsupported session state version");
     }
-    catch (const std::exception& e) {
-        std::cout << "\n=== Error in Finish Signing ===" << std::endl;
-        std::cout << "Error: " << e.what() << std::endl;
+
+    auto hash = dict->GetKey("Hash");
+    if (getString("Conformance").GetString() != _conformanceLevel
+        || hash == nullptr || !hash->IsName() || hash->GetName() != hashAlgorithmToString(_hashAlgorithm)) {
+        throw std::runtime_error("The session state doesn't match the conformance level or hash algorithm of the session");
+    }
+
+    auto outputMode = getNumber("OutputMode");
+    if (outputMode > (size_t)SigningOutputMode::IncrementalTail) {
+        throw std::runtime_error("Invalid session state: unknown output mode");
+    }
+
+    _documentInputPath = getString("Input").GetString();
+    _documentOutputPath = getString("Output").GetString();
+    _outputMode = (SigningOutputMode)outputMode;
+    _prepared.ByteRangeOffset = getNumber("ByteRangeOffset");
+    _prepared.ContentsOffset = getNumber("ContentsOffset");
+    _prepared.ContentsSize = getNumber("ContentsSize");
+    _prepared.DeviceLength = getNumber("Length");
+
+    initCmsParams();
+
+    std::vector<charbuff> chain;
+    for (const auto& cert : _certificateChainDer)
+        chain.emplace_back(reinterpret_cast<const char*>(cert.data()), cert.size());
+
+    PoDoFo::bufferview cert(reinterpret_cast<const char*>(_endCertificateDer.data()), _endCertificateDer.size());
+    auto signer = std::make_shared<PoDoFo::PdfSignerCms>(cert, chain, _cmsParams);
+    try {
+        signer->RestoreDeferredState(getString("SignerState").GetRawData());
+    }
+    catch (const PoDoFo::PdfError& e) {
+        throw std::runtime_error(std::string("Invalid session state: ") + e.what());
+    }
+
+    openOutputStream(true);
+    try {
+        PoDoFo::PdfSigningContext::ValidatePreparedSignature(*_stream, _prepared);
+    }
+    catch (const PoDoFo::PdfError& e) {
         _stream.reset();
-        throw;
+        throw std::runtime_error(std::string("The prepared document doesn't match the session state: ") + e.what());
+    }
+
+    _signer = std::move(signer);
+}
+
+void PoDoFo::PdfRemoteSignDocumentSession::setOutputMode(SigningOutputMode mode) {
+    if (_stream) {
+        throw std::runtime_error("The output mode must be set before beginSigning()");
+    }
+    _outputMode = mode;
+}
+
+void PoDoFo::PdfRemoteSignDocumentSession::openOutputStream(bool prepared) {
+    std::error_code ec;
+    if (fs::equivalent(fs::u8path(_documentInputPath), fs::u8path(_documentOutputPath), ec)) {
+        // Signing in place: the update is just appended to the input
+        _stream = std::make_shared<PoDoFo::FileStreamDevice>(_documentOutputPath, PoDoFo::FileMode::Open);
+        return;
+    }
+
+    switch (_outputMode) {
+    case SigningOutputMode::CopyInput:
+        if (!prepared) {
+            fs::copy_file(_documentInputPath, _documentOutputPath, fs::copy_options::overwrite_existing);
+        }
+        _stream = std::make_shared<PoDoFo::FileStreamDevice>(_documentOutputPath, PoDoFo::FileMode::Open);
+        break;
+    case SigningOutputMode::IncrementalTail:
+        _stream = std::make_shared<PoDoFo::AppendStreamDevice>(
+            std::make_shared<PoDoFo::FileStreamDevice>(_documentInputPath),
+            std::make_shared<PoDoFo::FileStreamDevice>(_documentOutputPath,
+                prepared ? PoDoFo::FileMode::Open : PoDoFo::FileMode::Create));
+        break;
+    default:
+        throw std::runtime_error("Invalid output mode");
+    }
+}
+
+void PoDoFo::PdfRemoteSignDocumentSession::initCmsParams() {
+    if (_conformanceLevel == "ADES_B_B") {
+        _cmsParams.SignatureType = PoDoFo::PdfSignatureType::PAdES_B;
+    }
+    else if (_conformanceLevel == "ADES_B_T") {
+        _cmsParams.SignatureType = PoDoFo::PdfSignatureType::PAdES_B_T;
+    }
+    else if (_conformanceLevel == "ADES_B_LT") {
+        _cmsParams.SignatureType = PoDoFo::PdfSignatureType::PAdES_B_LT;
+    }
+    else if (_conformanceLevel == "ADES_B_LTA") {
+        _cmsParams.SignatureType = PoDoFo::PdfSignatureType::PAdES_B_LTA;
+    }
+    else {
+        throw std::runtime_error("Invalid conformance level");
+    }
+
+    if (_hashAlgorithm == HashAlgorithm::SHA256) {
+        _cmsParams.Hashing = PoDoFo::PdfHashingAlgorithm::SHA256;
+    }
+    else if (_hashAlgorithm == HashAlgorithm::SHA384) {
+        _cmsParams.Hashing = PoDoFo::PdfHashingAlgorithm::SHA384;
+    }
+    else if (_hashAlgorithm == HashAlgorithm::SHA512) {
+        _cmsParams.Hashing = PoDoFo::PdfHashingAlgorithm::SHA512;
+    }
+    else {
+        throw std::runtime_error("Hash algorithm is not supported");
     }
 }
 
@@ -249,133 +422,90 @@ std::vector<unsigned char> PoDoFo::PdfRemoteSignDocumentSession::ConvertBase64PE
     if (!base64PEM || base64PEM->empty())
         return {};
 
-    BIO* raw_b64 = BIO_new(BIO_f_base64());
-    if (!raw_b64) throw std::runtime_error("Failed to create BIO for Base64");
-    BIO_set_flags(raw_b64, BIO_FLAGS_BASE64_NO_NL);
-
-    BIO* raw_mem = BIO_new_mem_buf(base64PEM->data(), static_cast<int>(base64PEM->size()));
-    if (!raw_mem) {
-        BIO_free_all(raw_b64);
-        throw std::runtime_error("Failed to create memory BIO");
-    }
-
-    BIO* raw_chain = BIO_push(raw_b64, raw_mem);
-    PoDoFo::BioPtr bio(raw_chain);
-
-    std::vector<unsigned char> der((base64PEM->size() * 3) / 4);
-    int len = BIO_read(bio.get(), der.data(), static_cast<int>(der.size()));
-    if (len <= 0) throw std::runtime_error("Base64 decode failed");
-    der.resize(len);
-
+    std::vector<unsigned char> der;
+    decodeBase64To(der, *base64PEM, "Base64 decode failed");
     return der;
 }
 
 std::string PoDoFo::PdfRemoteSignDocumentSession::ToBase64(const PoDoFo::charbuff& data) {
-    BIO* raw_b64 = BIO_new(BIO_f_base64()); BIO_set_flags(raw_b64, BIO_FLAGS_BASE64_NO_NL);
-    BIO* raw_mem = BIO_new(BIO_s_mem());
-    BIO* raw_chain = BIO_push(raw_b64, raw_mem);
-    PoDoFo::BioPtr bio(raw_chain);
-
-    if (BIO_write(bio.get(), data.data(), static_cast<int>(data.size())) <= 0 ||
-        BIO_flush(bio.get()) <= 0)
-        throw std::runtime_error("BIO_write/flush failed");
-
-    BUF_MEM* ptr;
-    BIO_get_mem_ptr(bio.get(), &ptr);
-    return std::string(ptr->data, ptr->length);
+    std::string ret;
+    utls::WriteBase64To(ret, data);
+    return ret;
 }
 
 PoDoFo::charbuff PoDoFo::PdfRemoteSignDocumentSession::ConvertDSSHashToSignedHash(const std::string& DSSHash) {
-    BIO* raw_b64 = BIO_new(BIO_f_base64()); BIO_set_flags(raw_b64, BIO_FLAGS_BASE64_NO_NL);
-    BIO* raw_mem = BIO_new_mem_buf(DSSHash.data(), static_cast<int>(DSSHash.size()));
-    BIO* raw_chain = BIO_push(raw_b64, raw_mem);
-    PoDoFo::BioPtr bio(raw_chain);
-
-    std::vector<unsigned char> decoded(128);
-    int len = BIO_read(bio.get(), decoded.data(), static_cast<int>(decoded.size()));
-    if (len <= 0) throw std::runtime_error("Base64 decode failed");
-    decoded.resize(len);
-
+    // NOTE: The signed value is as long as the key modulus
+    // (256 bytes for RSA-2048), so size the buffer on the input
     PoDoFo::charbuff result;
-    result.assign(decoded.begin(), decoded.end());
+    decodeBase64To(result, DSSHash, "Base64 decode failed");
     return result;
 }
 
 std::vector<unsigned char> PoDoFo::PdfRemoteSignDocumentSession::HexToBytes(const std::string& hex) {
-    std::vector<unsigned char> bytes;
-    for (size_t i = 0; i < hex.length(); i += 2) {
-        std::string byteString = hex.substr(i, 2);
-        unsigned char byte = static_cast<unsigned char>(strtol(byteString.c_str(), nullptr, 16));
-        bytes.push_back(byte);
-    }
+    std::vector<unsigned char> bytes(hex.length() / 2);
+    size_t written;
+    if (!utls::TryDecodeHex(hex, PoDoFo::bufferspan(reinterpret_cast<char*>(bytes.data()), bytes.size()), written))
+        throw std::runtime_error("Invalid hexadecimal string");
+
     return bytes;
 }
 
 std::string PoDoFo::PdfRemoteSignDocumentSession::ToHexString(const PoDoFo::charbuff& data) {
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0');
-    for (unsigned char c : data) {
-        ss << std::setw(2) << static_cast<int>(c);
-    }
-    return ss.str();
+    return utls::GetCharHexString(data, true);
 }
 
 std::string PoDoFo::PdfRemoteSignDocumentSession::UrlEncode(const std::string& value) {
-    std::ostringstream escaped; escaped.fill('0'); escaped << std::hex;
+    static constexpr char hexDigits[] = "0123456789ABCDEF";
+    std::string escaped;
+    escaped.reserve(value.size() + value.size() / 8 * 3);
     for (unsigned char c : value) {
         if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-            escaped << c;
+            escaped.push_back(static_cast<char>(c));
         }
         else {
-            escaped << '%' << std::setw(2) << std::uppercase << static_cast<int>(c);
+            escaped.push_back('%');
+            escaped.push_back(hexDigits[c >> 4]);
+            escaped.push_back(hexDigits[c & 0x0F]);
         }
     }
-    return escaped.str();
+    return escaped;
+}
+
+void PoDoFo::PdfRemoteSignDocumentSession::setTimestampTokenSizeHint(size_t tokenSize) {
+    _timestampTokenSize = tokenSize;
 }
 
 void PoDoFo::PdfRemoteSignDocumentSession::printState() const {
-    std::cout << "PdfSigningSession state:\n";
-    std::cout << "  ConformanceLevel: " << _conformanceLevel << "\n";
-    std::cout << "  HashAlgorithm:    " << hashAlgorithmToString(_hashAlgorithm) << "\n";
-    std::cout << "  DocumentInput:    " << _documentInputPath << "\n";
-    std::cout << "  DocumentOutput:   " << _documentOutputPath << "\n";
-    std::cout << "  EndCert (bytes):  " << _endCertificateBase64.size() << "\n";
-    std::cout << "  ChainCount:       " << _certificateChainBase64.size() << "\n";
+    std::string state = "PdfSigningSession state:\n";
+    state.append("  ConformanceLevel: ").append(_conformanceLevel).append("\n");
+    state.append("  HashAlgorithm:    ").append(hashAlgorithmToString(_hashAlgorithm)).append("\n");
+    state.append("  DocumentInput:    ").append(_documentInputPath).append("\n");
+    state.append("  DocumentOutput:   ").append(_documentOutputPath).append("\n");
+    state.append("  EndCert (bytes):  ").append(std::to_string(_endCertificateBase64.size())).append("\n");
+    state.append("  ChainCount:       ").append(std::to_string(_certificateChainBase64.size())).append("\n");
     if (_rootCertificateBase64)
-        std::cout << "  RootCert (bytes): " << _rootCertificateBase64->size() << "\n";
+        state.append("  RootCert (bytes): ").append(std::to_string(_rootCertificateBase64->size())).append("\n");
     if (_label)
-        std::cout << "  Label:            " << *_label << "\n";
+        state.append("  Label:            ").append(*_label).append("\n");
     if (!_responseTsr.empty())
-        std::cout << "  TimestampToken:   " << _responseTsr.size() << " bytes\n";
+        state.append("  TimestampToken:   ").append(std::to_string(_responseTsr.size())).append(" bytes\n");
+
+    PoDoFo::LogMessage(PoDoFo::PdfLogSeverity::Information, state);
 }
 
 std::string PoDoFo::PdfRemoteSignDocumentSession::getCrlFromCertificate(const std::string& base64Cert) {
-    auto base64_decode = [](const std::string& base64_string) -> std::vector<unsigned char> {
-        std::unique_ptr<BIO, decltype(&BIO_free)> b64(BIO_new(BIO_f_base64()), BIO_free);
-        if (!b64) throw std::runtime_error("Failed to create BIO for base64 decoding.");
-        BIO_set_flags(b64.get(), BIO_FLAGS_BASE64_NO_NL);
-        std::unique_ptr<BIO, decltype(&BIO_free)> bmem(BIO_new_mem_buf(base64_string.data(), static_cast<int>(base64_string.length())), BIO_free);
-        if (!bmem) throw std::runtime_error("Failed to create BIO_mem_buf for base64 decoding.");
-        BIO* bio = BIO_push(b64.get(), bmem.get());
-
-        std::vector<unsigned char> decoded_data(base64_string.length());
-        int decoded_length = BIO_read(bio, decoded_data.data(), static_cast<int>(decoded_data.size()));
-        if (decoded_length <= 0) throw std::runtime_error("Failed to decode base64 input.");
-        decoded_data.resize(decoded_length);
-        return decoded_data;
-        };
-
-    std::vector<unsigned char> decoded = base64_decode(base64Cert);
+    std::vector<unsigned char> decoded;
+    decodeBase64To(decoded, base64Cert, "Failed to decode base64 input.");
     if (decoded.size() < 50) {
         throw std::runtime_error("Decoded data too small to be valid X.509 or timestamp.");
     }
 
-    const unsigned char* p = decoded.data();
-    std::unique_ptr<X509, decltype(&X509_free)> cert(
-        d2i_X509(nullptr, &p, decoded.size()), X509_free);
+    auto& cache = PoDoFo::PdfValidationMaterialCache::instance();
+    auto material = cache.tryGet(PoDoFo::ValidationMaterialType::Certificate,
+        PoDoFo::bufferview(reinterpret_cast<const char*>(decoded.data()), decoded.size()));
 
-    if (!cert) {
-        p = decoded.data();
+    if (!material) {
+        const unsigned char* p = decoded.data();
         std::unique_ptr<TS_RESP, decltype(&TS_RESP_free)> ts_resp(
             d2i_TS_RESP(nullptr, &p, decoded.size()), TS_RESP_free);
         if (!ts_resp) {
@@ -396,78 +526,29 @@ std::string PoDoFo::PdfRemoteSignDocumentSession::getCrlFromCertificate(const st
             throw std::runtime_error("No certificates found in timeStampToken.");
         }
 
-        cert.reset(X509_dup(sk_X509_value(certs, 0)));
-        if (!cert) {
-            throw std::runtime_error("Failed to duplicate signer certificate from timeStampToken.");
-        }
+        material = cache.get(PoDoFo::ValidationMaterialType::Certificate, ssl::GetEncoded(sk_X509_value(certs, 0)));
     }
 
-    if (!X509_get_subject_name(cert.get()) || !X509_get_issuer_name(cert.get())) {
+    X509* cert = material->certificate.get();
+    if (!X509_get_subject_name(cert) || !X509_get_issuer_name(cert)) {
         throw std::runtime_error("Parsed certificate structure is invalid.");
     }
 
-    std::unique_ptr<CRL_DIST_POINTS, decltype(&CRL_DIST_POINTS_free)> dist_points(
-        static_cast<CRL_DIST_POINTS*>(X509_get_ext_d2i(cert.get(), NID_crl_distribution_points, nullptr, nullptr)),
-        CRL_DIST_POINTS_free
-    );
-
-    if (dist_points) {
-        for (int i = 0; i < sk_DIST_POINT_num(dist_points.get()); ++i) {
-            DIST_POINT* dp = sk_DIST_POINT_value(dist_points.get(), i);
-            if (dp && dp->distpoint && dp->distpoint->type == 0) {
-                GENERAL_NAMES* names = dp->distpoint->name.fullname;
-                for (int j = 0; j < sk_GENERAL_NAME_num(names); ++j) {
-                    GENERAL_NAME* gen_name = sk_GENERAL_NAME_value(names, j);
-                    if (gen_name && gen_name->type == GEN_URI) {
-                        ASN1_IA5STRING* uri = gen_name->d.uniformResourceIdentifier;
-                        if (uri && ASN1_STRING_length(uri) > 0) {
-                            std::string crl_url(reinterpret_cast<const char*>(ASN1_STRING_get0_data(uri)), ASN1_STRING_length(uri));
-                            if (!crl_url.empty()) {
-                                return crl_url;
-                            }
-                        }
-                    }
-                }
-            }
-        }
+    if (!material->crlUrls.empty()) {
+        return material->crlUrls.front();
     }
 
     throw std::runtime_error("No CRL distribution point URL found in certificate.");
 }
 
 std::string PoDoFo::PdfRemoteSignDocumentSession::DecodeBase64Tsr(const std::string& base64Tsr) {
-    BIO* b64 = BIO_new(BIO_f_base64());
-    if (!b64) {
-        throw std::runtime_error("Failed to create BIO for base64 decoding");
-    }
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-
-    BIO* mem = BIO_new_mem_buf(base64Tsr.data(), static_cast<int>(base64Tsr.size()));
-    if (!mem) {
-        BIO_free_all(b64);
-        throw std::runtime_error("Failed to create memory BIO");
-    }
-
-    BIO* bio = BIO_push(b64, mem);
-
-    size_t maxDecodedSize = (base64Tsr.size() * 3) / 4;
-    std::vector<unsigned char> decoded(maxDecodedSize);
-
-    int decodedSize = BIO_read(bio, decoded.data(), static_cast<int>(maxDecodedSize));
-    BIO_free_all(bio);
-
-    if (decodedSize <= 0) {
-        throw std::runtime_error("Failed to decode base64 TSR data");
-    }
-
-    decoded.resize(decodedSize);
-
-    std::string tsrData(decoded.begin(), decoded.end());
+    std::string tsrData;
+    decodeBase64To(tsrData, base64Tsr, "Failed to decode base64 TSR data");
 
     const unsigned char* p = reinterpret_cast<const unsigned char*>(tsrData.data());
     TS_RESP* response = d2i_TS_RESP(nullptr, &p, static_cast<long>(tsrData.size()));
     if (!response) {
-        std::cerr << "[ERROR] Failed to parse decoded TSR into TS_RESP (OpenSSL error)" << std::endl;
+        PoDoFo::LogMessage(PoDoFo::PdfLogSeverity::Error, "Failed to parse decoded TSR into TS_RESP (OpenSSL error)");
         throw std::runtime_error("Invalid TSR data after decoding");
     }
     TS_RESP_free(response);
@@ -555,42 +636,53 @@ void PoDoFo::PdfRemoteSignDocumentSession::createOrUpdateDSSCatalog(PoDoFo::PdfM
     }
 }
 
-PoDoFo::PdfObject& PoDoFo::PdfRemoteSignDocumentSession::createCertificateStream(PoDoFo::PdfMemDocument& doc, const std::string& certBase64) {
-    std::vector<unsigned char> certDer = ConvertBase64PEMtoDER(certBase64, std::nullopt);
-
-    auto& streamObj = doc.GetObjects().CreateDictionaryObject();
-    auto& stream = streamObj.GetOrCreateStream();
+void PoDoFo::PdfRemoteSignDocumentSession::appendDSSUpdate(PoDoFo::PdfMemDocument* doc, const PoDoFo::ValidationData& validationData) {
+    // The document that was just signed is reused when available: its
+    // objects were already written with the signing revision, so the
+    // DSS revision only contains the new streams and the updated catalog
+    std::unique_ptr<PoDoFo::PdfMemDocument> loaded;
+    if (doc == nullptr) {
+        // Restored session: only the xref and the catalog are parsed,
+        // the other objects are loaded on demand
+        loaded = std::make_unique<PoDoFo::PdfMemDocument>();
+        _stream->Seek(0, PoDoFo::SeekDirection::Begin);
+        loaded->Load(_stream);
+        doc = loaded.get();
+    }
 
-    PoDoFo::charbuff certData;
-    certData.assign(reinterpret_cast<const char*>(certDer.data()), certDer.size());
-    stream.SetData(certData, {}, true);
+    createOrUpdateDSSCatalog(*doc, validationData);
+    doc->SaveUpdate(*_stream, PoDoFo::PdfSaveOptions::NoMetadataUpdate | PoDoFo::PdfSaveOptions::NoFlateCompress);
+}
 
-    return streamObj;
+PoDoFo::PdfObject& PoDoFo::PdfRemoteSignDocumentSession::createCertificateStream(PoDoFo::PdfMemDocument& doc, const std::string& certBase64) {
+    return createValidationStream(doc, PoDoFo::ValidationMaterialType::Certificate, certBase64);
 }
 
 PoDoFo::PdfObject& PoDoFo::PdfRemoteSignDocumentSession::createCRLStream(PoDoFo::PdfMemDocument& doc, const std::string& crlBase64) {
-    std::vector<unsigned char> crlDer = ConvertBase64PEMtoDER(crlBase64, std::nullopt);
-
-    auto& streamObj = doc.GetObjects().CreateDictionaryObject();
-    auto& stream = streamObj.GetOrCreateStream();
-
-    PoDoFo::charbuff crlData;
-    crlData.assign(reinterpret_cast<const char*>(crlDer.data()), crlDer.size());
-    stream.SetData(crlData, {}, true);
-
-    return streamObj;
+    return createValidationStream(doc, PoDoFo::ValidationMaterialType::Crl, crlBase64);
 }
 
 PoDoFo::PdfObject& PoDoFo::PdfRemoteSignDocumentSession::createOCSPStream(PoDoFo::PdfMemDocument& doc, const std::string& ocspBase64) {
-    std::vector<unsigned char> ocspDer = ConvertBase64PEMtoDER(ocspBase64, std::nullopt);
+    return createValidationStream(doc, PoDoFo::ValidationMaterialType::Ocsp, ocspBase64);
+}
 
-    auto& streamObj = doc.GetObjects().CreateDictionaryObject();
-    auto& stream = streamObj.GetOrCreateStream();
+PoDoFo::PdfObject& PoDoFo::PdfRemoteSignDocumentSession::createValidationStream(PoDoFo::PdfMemDocument& doc,
+    PoDoFo::ValidationMaterialType type, const std::string& base64) {
+    std::vector<unsigned char> der = ConvertBase64PEMtoDER(base64, std::nullopt);
+    PoDoFo::bufferview derView(reinterpret_cast<const char*>(der.data()), der.size());
+    auto material = PoDoFo::PdfValidationMaterialCache::instance().tryGet(type, derView);
 
-    PoDoFo::charbuff ocspData;
-    ocspData.assign(reinterpret_cast<const char*>(ocspDer.data()), ocspDer.size());
-    stream.SetData(ocspData, {}, true);
+    auto& streamObj = doc.GetObjects().CreateDictionaryObject();
+    if (material == nullptr) {
+        // The signature is already written at this point: embed the
+        // material as given, as the DSS did before being cached
+        streamObj.GetOrCreateStream().SetData(derView, { }, true);
+        return streamObj;
+    }
 
+    // The same CA chain and CRLs are embedded in many documents:
+    // reuse the payload compressed once by the cache
+    streamObj.GetOrCreateStream().SetData(material->flateDer, { PoDoFo::PdfFilterType::FlateDecode }, true);
     return streamObj;
 }
 
@@ -614,28 +706,21 @@ std::string PoDoFo::PdfRemoteSignDocumentSession::beginSigningLTA() {
 
         _ltaCtx = std::make_unique<PoDoFo::PdfSigningContext>();
 
-        _ltaSigner = std::make_shared<PoDoFo::PdfDocTimeStampSigner>();
+        initCmsParams();
+        auto ltaSigner = std::make_shared<PoDoFo::PdfDocTimeStampSigner>(_cmsParams.Hashing);
+        if (_timestampTokenSize) {
+            ltaSigner->ReserveTokenSize(*_timestampTokenSize);
+        }
+        _ltaSigner = ltaSigner;
         _ltaSignerId = _ltaCtx->AddSigner(signature, _ltaSigner);
 
         _ltaCtx->StartSigning(*_ltaDoc, _stream, _ltaResults, PoDoFo::PdfSaveOptions::NoMetadataUpdate);
 
-        auto& INITIAL_hash = _ltaResults.Intermediate[_ltaSignerId];
-        auto rawCmsHash = ToHexString(INITIAL_hash);
-
-        auto binaryHash = HexToBytes(rawCmsHash);
-        PoDoFo::charbuff binaryCharbuff;
-        binaryCharbuff.assign(reinterpret_cast<const char*>(binaryHash.data()), binaryHash.size());
-
-        auto base64Hash = ToBase64(binaryCharbuff);
-
-        auto urlEncodedHash = UrlEncode(base64Hash);
-
-        return base64Hash;
+        return ToBase64(_ltaResults.Intermediate[_ltaSignerId]);
     }
     catch (const std::exception& e)
     {
-        std::cout << "\n=== Error in beginSigningLTA ===" << std::endl;
-        std::cout << "Error: " << e.what() << std::endl;
+        PoDoFo::LogMessage(PoDoFo::PdfLogSeverity::Error, "Error in beginSigningLTA: {}", e.what());
         _ltaDoc.reset();
         _ltaCtx.reset();
         _ltaSigner.reset();
@@ -654,6 +739,13 @@ void PoDoFo::PdfRemoteSignDocumentSession::finishSigningLTA(const std::string& b
         std::string tsr = DecodeBase64Tsr(base64Tsr);
         std::string timestampToken = ExtractTimestampTokenFromTSR(tsr);
 
+        auto reservedSize = static_cast<PoDoFo::PdfDocTimeStampSigner&>(*_ltaSigner).GetReservedTokenSize();
+        if (timestampToken.size() > reservedSize) {
+            throw std::runtime_error("The timestamp token (" + std::to_string(timestampToken.size())
+                + " bytes) doesn't fit the room reserved for the DocTimeStamp (" + std::to_string(reservedSize)
+                + " bytes): set a bigger size with setTimestampTokenSizeHint()");
+        }
+
         PoDoFo::charbuff tokenContent;
         tokenContent.assign(timestampToken.data(), timestampToken.size());
         _ltaResults.Intermediate[_ltaSignerId] = tokenContent;
@@ -661,13 +753,7 @@ void PoDoFo::PdfRemoteSignDocumentSession::finishSigningLTA(const std::string& b
         _ltaCtx->FinishSigning(_ltaResults);
 
         if (validationData.has_value() && !validationData->empty()) {
-            _stream->Seek(0, PoDoFo::SeekDirection::Begin);
-            PoDoFo::PdfMemDocument final_doc;
-            final_doc.Load(_stream);
-
-            createOrUpdateDSSCatalog(final_doc, *validationData);
-
-            final_doc.SaveUpdate(*_stream, PoDoFo::PdfSaveOptions::NoMetadataUpdate | PoDoFo::PdfSaveOptions::NoFlateCompress);
+            appendDSSUpdate(_ltaDoc.get(), *validationData);
         }
 
         _ltaDoc.reset();
@@ -676,8 +762,7 @@ void PoDoFo::PdfRemoteSignDocumentSession::finishSigningLTA(const std::string& b
     }
     catch (const std::exception& e)
     {
-        std::cout << "\n=== Error in finishSigningLTA ===" << std::endl;
-        std::cout << "Error: " << e.what() << std::endl;
+        PoDoFo::LogMessage(PoDoFo::PdfLogSeverity::Error, "Error in finishSigningLTA: {}", e.what());
         _ltaDoc.reset();
         _ltaCtx.reset();
         _ltaSigner.reset();
@@ -796,54 +881,23 @@ std::string PoDoFo::PdfRemoteSignDocumentSession::extractIssuerCertFromTSR(const
 }
 
 std::string PoDoFo::PdfRemoteSignDocumentSession::getOCSPFromCertificate(const std::string& base64Cert, const std::string& base64IssuerCert) {
-    std::vector<unsigned char> decoded_cert = ConvertBase64PEMtoDER(std::optional<std::string>(base64Cert), std::nullopt);
-    std::vector<unsigned char> decoded_issuer = ConvertBase64PEMtoDER(std::optional<std::string>(base64IssuerCert), std::nullopt);
-
-    const unsigned char* p = decoded_cert.data();
-    std::unique_ptr<X509, decltype(&X509_free)> cert(d2i_X509(nullptr, &p, decoded_cert.size()), X509_free);
-    if (!cert) throw std::runtime_error("Failed to parse DER certificate: " + std::string(ERR_reason_error_string(ERR_get_error())));
-
-    const unsigned char* pi = decoded_issuer.data();
-    std::unique_ptr<X509, decltype(&X509_free)> issuer(d2i_X509(nullptr, &pi, decoded_issuer.size()), X509_free);
-    if (!issuer) throw std::runtime_error("Failed to parse DER issuer certificate: " + std::string(ERR_reason_error_string(ERR_get_error())));
-
-    std::string ocsp_url;
-    AUTHORITY_INFO_ACCESS* info = (AUTHORITY_INFO_ACCESS*)X509_get_ext_d2i(cert.get(), NID_info_access, nullptr, nullptr);
-    if (info) {
-        for (int i = 0; i < sk_ACCESS_DESCRIPTION_num(info); ++i) {
-            ACCESS_DESCRIPTION* ad = sk_ACCESS_DESCRIPTION_value(info, i);
-            if (OBJ_obj2nid(ad->method) == NID_ad_OCSP) {
-                if (ad->location->type == GEN_URI) {
-                    ASN1_IA5STRING* uri = ad->location->d.uniformResourceIdentifier;
-                    ocsp_url = std::string(reinterpret_cast<const char*>(ASN1_STRING_get0_data(uri)), ASN1_STRING_length(uri));
-                    break;
-                }
-            }
-        }
-        AUTHORITY_INFO_ACCESS_free(info);
-    }
-    if (ocsp_url.empty()) throw std::runtime_error("No OCSP responder URL found in certificate.");
+    auto cert = getCachedCertificate(base64Cert);
+    (void)getCachedCertificate(base64IssuerCert);
+
+    if (cert->ocspUrls.empty()) throw std::runtime_error("No OCSP responder URL found in certificate.");
 
-    return ocsp_url;
+    return cert->ocspUrls.front();
 }
 
 std::string PoDoFo::PdfRemoteSignDocumentSession::buildOCSPRequestFromCertificates(const std::string& base64Cert, const std::string& base64IssuerCert) {
-    std::vector<unsigned char> decoded_cert = ConvertBase64PEMtoDER(std::optional<std::string>(base64Cert), std::nullopt);
-    std::vector<unsigned char> decoded_issuer = ConvertBase64PEMtoDER(std::optional<std::string>(base64IssuerCert), std::nullopt);
-
-    const unsigned char* p = decoded_cert.data();
-    std::unique_ptr<X509, decltype(&X509_free)> cert(d2i_X509(nullptr, &p, decoded_cert.size()), X509_free);
-    if (!cert) throw std::runtime_error("Failed to parse DER certificate: " + std::string(ERR_reason_error_string(ERR_get_error())));
-
-    const unsigned char* pi = decoded_issuer.data();
-    std::unique_ptr<X509, decltype(&X509_free)> issuer(d2i_X509(nullptr, &pi, decoded_issuer.size()), X509_free);
-    if (!issuer) throw std::runtime_error("Failed to parse DER issuer certificate: " + std::string(ERR_reason_error_string(ERR_get_error())));
+    auto cert = getCachedCertificate(base64Cert);
+    auto issuer = getCachedCertificate(base64IssuerCert);
 
     std::unique_ptr<OCSP_REQUEST, decltype(&OCSP_REQUEST_free)> req(OCSP_REQUEST_new(), OCSP_REQUEST_free);
     if (!req) throw std::runtime_error("Failed to allocate OCSP_REQUEST.");
 
     std::unique_ptr<OCSP_CERTID, decltype(&OCSP_CERTID_free)> id(
-        OCSP_cert_to_id(nullptr, cert.get(), issuer.get()), OCSP_CERTID_free);
+        OCSP_cert_to_id(nullptr, cert->certificate.get(), issuer->certificate.get()), OCSP_CERTID_free);
     if (!id) throw std::runtime_error("Failed to create OCSP_CERTID.");
 
     if (!OCSP_request_add0_id(req.get(), id.get())) throw std::runtime_error("Failed to add CertID to OCSP request.");
@@ -861,30 +915,16 @@ std::string PoDoFo::PdfRemoteSignDocumentSession::buildOCSPRequestFromCertificat
 }
 
 std::string PoDoFo::PdfRemoteSignDocumentSession::getCertificateIssuerUrlFromCertificate(const std::string& base64Cert) {
-    std::vector<unsigned char> decoded_cert = ConvertBase64PEMtoDER(std::optional<std::string>(base64Cert), std::nullopt);
-
-    const unsigned char* p = decoded_cert.data();
-    std::unique_ptr<X509, decltype(&X509_free)> cert(d2i_X509(nullptr, &p, decoded_cert.size()), X509_free);
-    if (!cert) throw std::runtime_error("Failed to parse DER certificate: " + std::string(ERR_reason_error_string(ERR_get_error())));
-
-    std::string ca_issuer_url;
-    AUTHORITY_INFO_ACCESS* info = (AUTHORITY_INFO_ACCESS*)X509_get_ext_d2i(cert.get(), NID_info_access, nullptr, nullptr);
-    if (info) {
-        for (int i = 0; i < sk_ACCESS_DESCRIPTION_num(info); ++i) {
-            ACCESS_DESCRIPTION* ad = sk_ACCESS_DESCRIPTION_value(info, i);
-            if (OBJ_obj2nid(ad->method) == NID_ad_ca_issuers) {
-                if (ad->location->type == GEN_URI) {
-                    ASN1_IA5STRING* uri = ad->location->d.uniformResourceIdentifier;
-                    ca_issuer_url = std::string(reinterpret_cast<const char*>(ASN1_STRING_get0_data(uri)), ASN1_STRING_length(uri));
-                    break;
-                }
-            }
-        }
-        AUTHORITY_INFO_ACCESS_free(info);
-    }
-    if (ca_issuer_url.empty()) throw std::runtime_error("No CA Issuers URL found in certificate AIA extension.");
+    auto cert = getCachedCertificate(base64Cert);
+    if (cert->caIssuerUrls.empty()) throw std::runtime_error("No CA Issuers URL found in certificate AIA extension.");
 
-    return ca_issuer_url;
+    return cert->caIssuerUrls.front();
+}
+
+std::shared_ptr<const PoDoFo::PdfValidationMaterial> PoDoFo::PdfRemoteSignDocumentSession::getCachedCertificate(const std::string& base64Cert) {
+    std::vector<unsigned char> der = ConvertBase64PEMtoDER(base64Cert, std::nullopt);
+    return PoDoFo::PdfValidationMaterialCache::instance().get(PoDoFo::ValidationMaterialType::Certificate,
+        PoDoFo::bufferview(reinterpret_cast<const char*>(der.data()), der.size()));
 }
 //TODO
 std::string PoDoFo::PdfRemoteSignDocumentSession::extractIssuerCertFromTSRWithFallback(const std::string& base64Tsr,
@@ -947,97 +987,56 @@ std::pair<std::string, std::string> PoDoFo::PdfRemoteSignDocumentSession::getOCS
     return { ocspUrl, base64_ocsp_request };
 }
 
-PoDoFo::PdfDocTimeStampSigner::PdfDocTimeStampSigner() : m_useManualByteRange(false) {}
+PoDoFo::PdfDocTimeStampSigner::PdfDocTimeStampSigner(PoDoFo::PdfHashingAlgorithm hashing)
+    : m_digestCtx(EVP_MD_CTX_new()), m_hashing(hashing), m_reservedSize(DefaultTimestampTokenSize) {
+    if (m_digestCtx == nullptr) {
+        throw std::runtime_error("Failed to allocate the digest context");
+    }
+    Reset();
+}
+
+void PoDoFo::PdfDocTimeStampSigner::ReserveTokenSize(size_t tokenSize) {
+    m_reservedSize = tokenSize + std::max(tokenSize / 2, TimestampTokenSizeMargin);
+}
 
 void PoDoFo::PdfDocTimeStampSigner::SetDevice(std::shared_ptr<PoDoFo::StreamDevice> device) {
-    m_device = device;
-    m_useManualByteRange = true;
+    (void)device;
 }
 
+PoDoFo::PdfDocTimeStampSigner::~PdfDocTimeStampSigner() = default;
+
 void PoDoFo::PdfDocTimeStampSigner::Reset() {
-    m_hashBuffer.clear();
+    if (EVP_DigestInit_ex(m_digestCtx.get(), ssl::GetEVP_MD(m_hashing), nullptr) != 1) {
+        throw std::runtime_error("Failed to initialize the ByteRange digest");
+    }
 }
 
 void PoDoFo::PdfDocTimeStampSigner::AppendData(const PoDoFo::bufferview& data) {
-    size_t oldSize = m_hashBuffer.size();
-    m_hashBuffer.append(data.data(), data.size());
-
-    static size_t lastEndPosition = 0;
-    if (oldSize > 0 && oldSize != lastEndPosition) {
-        size_t gap = oldSize - lastEndPosition;
+    // The signing context streams exactly the ByteRange, in chunks
+    if (EVP_DigestUpdate(m_digestCtx.get(), data.data(), data.size()) != 1) {
+        throw std::runtime_error("Failed to update the ByteRange digest");
     }
-    lastEndPosition = oldSize + data.size();
 }
 
 void PoDoFo::PdfDocTimeStampSigner::ComputeSignature(PoDoFo::charbuff& contents, bool dryrun) {
     if (dryrun) {
-        contents.resize(6000); //TODO
+        contents.resize(m_reservedSize);
     }
     else {}
 }
 
 void PoDoFo::PdfDocTimeStampSigner::FetchIntermediateResult(PoDoFo::charbuff& result) {
-    if (m_useManualByteRange && m_device) {
-        result = calculateCorrectHash();
-    }
-    else {
-        PoDoFo::PdfHashingAlgorithm hashAlg = PoDoFo::PdfHashingAlgorithm::SHA256;
-        PoDoFo::bufferview dataView(m_hashBuffer.data(), m_hashBuffer.size());
-        result = ssl::ComputeHash(dataView, hashAlg);
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned length;
+    if (EVP_DigestFinal_ex(m_digestCtx.get(), hash, &length) != 1) {
+        throw std::runtime_error("Failed to finalize the ByteRange digest");
     }
-}
-
-PoDoFo::charbuff PoDoFo::PdfDocTimeStampSigner::calculateCorrectHash() {
-
-    m_device->Seek(0, PoDoFo::SeekDirection::End);
-    size_t fileSize = m_device->GetPosition();
-
-    m_device->Seek(0, PoDoFo::SeekDirection::Begin);
-
-    PoDoFo::charbuff fileContent;
-    fileContent.resize(fileSize);
-    m_device->Read(fileContent.data(), fileSize);
-
-    std::string fileStr(fileContent.data(), fileContent.size());
-
-    size_t byteRangePos = fileStr.find("/ByteRange[");
-    if (byteRangePos == std::string::npos) {
-        PoDoFo::PdfHashingAlgorithm hashAlg = PoDoFo::PdfHashingAlgorithm::SHA256;
-        PoDoFo::bufferview dataView(m_hashBuffer.data(), m_hashBuffer.size());
-        return ssl::ComputeHash(dataView, hashAlg);
-    }
-
-    size_t start = fileStr.find('[', byteRangePos) + 1;
-    size_t end = fileStr.find(']', start);
-    std::string byteRangeStr = fileStr.substr(start, end - start);
-
-    std::istringstream iss(byteRangeStr);
-    int64_t range1Start, range1Length, range2Start, range2Length;
-    iss >> range1Start >> range1Length >> range2Start >> range2Length;
-
-
-    PoDoFo::charbuff correctData;
-    correctData.reserve(range1Length + range2Length);
-
-    if (range1Length > 0) {
-        correctData.resize(range1Length);
-        std::memcpy(correctData.data(), fileContent.data() + range1Start, range1Length);
-    }
-
-    if (range2Length > 0) {
-        size_t currentSize = correctData.size();
-        correctData.resize(currentSize + range2Length);
-        std::memcpy(correctData.data() + currentSize, fileContent.data() + range2Start, range2Length);
-    }
-
-    PoDoFo::PdfHashingAlgorithm hashAlg = PoDoFo::PdfHashingAlgorithm::SHA256;
-    PoDoFo::bufferview correctDataView(correctData.data(), correctData.size());
-    return ssl::ComputeHash(correctDataView, hashAlg);
+    result.assign(reinterpret_cast<const char*>(hash), length);
 }
 
 void PoDoFo::PdfDocTimeStampSigner::ComputeSignatureDeferred(const PoDoFo::bufferview& processedResult, PoDoFo::charbuff& contents, bool dryrun) {
     if (dryrun) {
-        contents.resize(20000);
+        contents.resize(m_reservedSize);
     }
     else {
         contents.assign(processedResult.data(), processedResult.size());
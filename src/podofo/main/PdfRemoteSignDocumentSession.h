@@ -31,7 +31,11 @@
 #include <iomanip>
 #include <utility>
 
-#include <podofo/podofo.h>
+#include "PdfMemDocument.h"
+#include "PdfSigningContext.h"
+#include "PdfSignerCms.h"
+#include <podofo/auxiliary/StreamDevice.h>
+#include "PdfValidationMaterialCache.h"
 #include <openssl/bio.h>
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
@@ -58,6 +62,17 @@ namespace PoDoFo {
      */
     using BioPtr = std::unique_ptr<BIO, BioFreeAll>;
 
+    /**
+     * @brief RAII deleter for OpenSSL `EVP_MD_CTX*` digest contexts.
+     */
+    struct PODOFO_API EvpMdCtxFree {
+        void operator()(EVP_MD_CTX* ctx) const noexcept;
+    };
+    /**
+     * @brief Convenience alias for a unique digest context with `EVP_MD_CTX_free` deleter.
+     */
+    using EvpMdCtxPtr = std::unique_ptr<EVP_MD_CTX, EvpMdCtxFree>;
+
     /**
      * @brief Container for validation-related artifacts to embed into the PDF DSS.
      *
@@ -165,6 +180,14 @@ namespace PoDoFo {
         Unknown  /**< Not recognized */
     };
 
+    /**
+     * @brief How the signing session produces the output document.
+     */
+    enum class SigningOutputMode {
+        CopyInput,       /**< Copy the input PDF to the output path and append the update there (default) */
+        IncrementalTail  /**< Leave the input untouched and write only the incremental update to the output path */
+    };
+
     /**
      * @brief Simple document entry used by higher-level request structures.
      */
@@ -259,6 +282,29 @@ namespace PoDoFo {
          */
         void finishSigning(const std::string& signedHash, const std::string& base64Tsr, const std::optional<ValidationData>& validationData = std::nullopt);
 
+        /**
+         * @brief Exports the state of a signing started with beginSigning() as a compact blob.
+         *
+         * The blob holds the offsets of the /ByteRange and /Contents of the prepared signature,
+         * the CMS signer state with its signed attributes and the paths of the prepared document.
+         * After the call the parsed document, the output device and the signing context are
+         * released, so nothing is kept in memory while waiting for the remote signature.
+         * @return The serialized session state.
+         * @throws std::runtime_error if no signing has been started.
+         */
+        std::string exportState();
+        /**
+         * @brief Restores a state exported with exportState(), possibly in another process.
+         *
+         * The session must be constructed with the same conformance level, hash algorithm
+         * and certificates of the one that exported the state. After the call finishSigning()
+         * can be called as usual: the signature is written directly on the prepared document,
+         * which is not parsed again.
+         * @param state The serialized session state.
+         * @throws std::runtime_error if the state is invalid or doesn't match the session.
+         */
+        void importState(const std::string& state);
+
         /**
          * @brief Start a DocTimeStamp (RFC3161) LTA update flow on the existing signed PDF.
          * @return Base64-encoded hash to be sent to the TSA.
@@ -268,11 +314,25 @@ namespace PoDoFo {
          * @brief Complete the DocTimeStamp flow by injecting the TSA token and optional DSS.
          * @param base64Tsr Base64-encoded TSR from TSA.
          * @param validationData Optional validation artifacts to embed into DSS.
+         * @throws std::runtime_error if the token doesn't fit the room reserved by beginSigningLTA(),
+         *      before anything is written. A bigger size can be set with setTimestampTokenSizeHint().
          */
         void finishSigningLTA(const std::string& base64Tsr, const std::optional<ValidationData>& validationData);
 
         /**
-         * @brief Prints current session state to stdout (for diagnostics)
+         * @brief Selects how the output document is produced. Must be called before beginSigning().
+         *
+         * With SigningOutputMode::IncrementalTail the input PDF is only read and the output path
+         * receives just the incremental update(s) (signature, widget, AcroForm, DSS, xref). The
+         * signed document is the input bytes followed by the output bytes, so disk I/O per
+         * signature is proportional to the update size. When the input and output paths refer
+         * to the same file the update is always appended in place, without copying.
+         * @param mode The output mode to use
+         */
+        void setOutputMode(SigningOutputMode mode);
+
+        /**
+         * @brief Logs the current session state with PdfLogSeverity::Information (for diagnostics)
          */
         void printState() const;
         /**
@@ -280,6 +340,19 @@ namespace PoDoFo {
          * @param responseTsrBase64 Base64-encoded timestamp response
          */
         void setTimestampToken(const std::string& responseTsrBase64);
+        /**
+         * @brief Sets the expected size of the TSA timestamp token, used to size the DocTimeStamp /Contents.
+         *
+         * When not set, the size of the token received in finishSigning() is used, or a
+         * conservative default if none was received.
+         * @param tokenSize Expected size in bytes of the DER-encoded timestamp token
+         */
+        void setTimestampTokenSizeHint(size_t tokenSize);
+        /**
+         * @brief Gets the conformance level of the session
+         * @return One of ADES_B_B, ADES_B_T, ADES_B_LT, ADES_B_LTA
+         */
+        const std::string& conformanceLevel() const { return _conformanceLevel; }
         /**
          * @brief Extract the first CRL Distribution Point URL from a certificate or TSR (base64 DER input).
          * @throws std::runtime_error if no URL is found or parsing fails.
@@ -347,10 +420,24 @@ namespace PoDoFo {
         std::string getCertificateIssuerUrlFromCertificate(const std::string& base64Cert);
 
     private:
+        /**
+         * @brief Gets a parsed certificate through the process-wide validation material cache
+         * @param base64Cert The certificate encoded in base64
+         * @return The cached certificate material
+         * @throws std::runtime_error if the certificate cannot be parsed
+         */
+        std::shared_ptr<const PdfValidationMaterial> getCachedCertificate(const std::string& base64Cert);
         /**
          * @brief Create or update the DSS dictionary in the document with provided artifacts.
          */
         void createOrUpdateDSSCatalog(PdfMemDocument& doc, const ValidationData& validationData);
+        /**
+         * @brief Appends the DSS as a new incremental update to the output device.
+         * @param doc The document that was just signed on the output device, if still loaded.
+         * When null, the document is loaded from the output device.
+         * @param validationData Validation artifacts to embed into DSS.
+         */
+        void appendDSSUpdate(PdfMemDocument* doc, const ValidationData& validationData);
         /**
          * @brief Creates a stream object for a certificate
          * @param doc The PDF document to add the stream to
@@ -372,6 +459,15 @@ namespace PoDoFo {
          * @return Reference to the created stream object
          */
         PdfObject& createOCSPStream(PdfMemDocument& doc, const std::string& ocspBase64);
+        /**
+         * @brief Creates a compressed stream object for validation material, through the process-wide cache.
+         *      Material which cannot be parsed is embedded as given, uncompressed
+         * @param doc The PDF document to add the stream to
+         * @param type The kind of the validation material
+         * @param base64 Base64-encoded DER data
+         * @return Reference to the created stream object
+         */
+        PdfObject& createValidationStream(PdfMemDocument& doc, ValidationMaterialType type, const std::string& base64);
 
         /**
          * @brief Attempts to extract issuer certificate from TSR, with AIA fallback.
@@ -384,7 +480,7 @@ namespace PoDoFo {
             std::function<std::string(const std::string&)> httpFetcher = nullptr);
 
         /**
-         * @brief Decodes base64 (no newlines) into DER bytes
+         * @brief Decodes base64 or base64url into DER bytes
          * @param base64PEM Optional base64-encoded PEM data
          * @param outputPath Optional path to save the decoded data
          * @return Vector containing the decoded DER bytes
@@ -441,8 +537,19 @@ namespace PoDoFo {
          */
         std::string ExtractTimestampTokenFromTSR(const std::string& tsrData);
 
+        /**
+         * @brief Opens the device the update is written to, according to the output mode
+         * @param prepared When true, open the document already prepared for signing
+         */
+        void openOutputStream(bool prepared);
+        /**
+         * @brief Fills the CMS signer parameters from the conformance level and hash algorithm
+         */
+        void initCmsParams();
+
         std::string                                 _conformanceLevel;
         HashAlgorithm                               _hashAlgorithm;
+        SigningOutputMode                           _outputMode;
         std::string                                 _documentInputPath;
         std::string                                 _documentOutputPath;
         std::string                                 _endCertificateBase64;
@@ -455,14 +562,16 @@ namespace PoDoFo {
         std::vector<std::vector<unsigned char>>     _certificateChainDer;
         std::vector<unsigned char>                  _rootCertificateDer;
         std::vector<unsigned char>                  _responseTsr;
+        std::optional<size_t>                       _timestampTokenSize;
 
-        PdfMemDocument                              _doc;
-        std::shared_ptr<FileStreamDevice>           _stream;
+        std::unique_ptr<PdfMemDocument>             _doc;
+        std::shared_ptr<StreamDevice>               _stream;
         PdfSignerCmsParams                          _cmsParams;
-        PdfSigningContext                           _ctx;
+        std::unique_ptr<PdfSigningContext>          _ctx;
         PdfSigningResults                           _results;
         PdfSignerId                                 _signerId;
         std::shared_ptr<PdfSignerCms>               _signer;
+        PdfPreparedSignature                        _prepared;
 
         // Members for LTA Signing Flow
         std::unique_ptr<PdfMemDocument>             _ltaDoc;
@@ -488,31 +597,52 @@ namespace PoDoFo {
     /**
      * @brief Custom signer implementing RFC3161 DocTimeStamp behavior.
      *
-     * Computes the correct hash over the ByteRange of the PDF and accepts an external
-     * timestamp token to be embedded as the signature contents.
+     * Digests the ByteRange of the PDF incrementally, as it's streamed by the signing
+     * context, and accepts an external timestamp token to be embedded as the signature contents.
      */
     class PODOFO_API PdfDocTimeStampSigner : public PdfSigner {
     private:
-        charbuff m_hashBuffer;
-        std::shared_ptr<StreamDevice> m_device;
-        bool m_useManualByteRange;
+        EvpMdCtxPtr m_digestCtx;
+        PdfHashingAlgorithm m_hashing;
+        size_t m_reservedSize;
 
     public:
         /**
          * @brief Constructs a DocTimeStamp signer
+         * @param hashing Digest algorithm of the ByteRange, it must match the one requested to the TSA
          */
-        PdfDocTimeStampSigner();
+        PdfDocTimeStampSigner(PdfHashingAlgorithm hashing = PdfHashingAlgorithm::SHA256);
         /**
-         * @brief Provides the underlying stream device to allow manual ByteRange hashing
-         * @param device Shared pointer to the stream device
+         * @brief Sets the size of the timestamp token to reserve room for in /Contents.
+         *
+         * The size of a previous token of the same TSA is a good hint, but tokens can
+         * still grow, for example when they embed a different certificate chain. A wide
+         * safety margin is added to the given size, as unused room is just zero padding.
+         * @param tokenSize Expected size in bytes of the DER-encoded timestamp token
+         */
+        void ReserveTokenSize(size_t tokenSize);
+        /**
+         * @brief Gets the room reserved in /Contents for the timestamp token
+         * @return The reserved size in bytes
+         */
+        size_t GetReservedTokenSize() const { return m_reservedSize; }
+        /**
+         * @brief Kept for source compatibility, the device is not used anymore.
+         * @deprecated The ByteRange is digested while the signing context streams it,
+         *      so there's no need to read it again from the device.
+         * @param device Shared pointer to the stream device, ignored
          */
         void SetDevice(std::shared_ptr<StreamDevice> device);
         /**
-         * @brief Resets internal buffers
+         * @brief Destructor, releases the digest context
+         */
+        ~PdfDocTimeStampSigner();
+        /**
+         * @brief Restarts the ByteRange digest
          */
         void Reset() override;
         /**
-         * @brief Appends PDF bytes to internal buffer (used in non-manual mode)
+         * @brief Feeds a chunk of the ByteRange to the digest
          * @param data The data to append
          */
         void AppendData(const bufferview& data) override;
@@ -523,17 +653,12 @@ namespace PoDoFo {
          */
         void ComputeSignature(charbuff& contents, bool dryrun) override;
         /**
-         * @brief Computes intermediate hash result (manual ByteRange if possible)
+         * @brief Finalizes the ByteRange digest, to be sent to the TSA
          * @param result Reference to store the intermediate result
          */
         void FetchIntermediateResult(charbuff& result) override;
 
     private:
-        /**
-         * @brief Computes hash over the exact ByteRange of the current PDF in the device
-         * @return The calculated hash
-         */
-        charbuff calculateCorrectHash();
         /**
          * @brief Injects externally-computed token into signature contents
          * @param processedResult The processed result data
@@ -0,0 +1,209 @@
+// PdfRemoteSignPipeline.cpp
+/**
+ * @file PdfRemoteSignPipeline.cpp
+ * @brief Implementation of the non-blocking remote signing pipeline.
+ */
+
+#include "PdfRemoteSignPipeline.h"
+#include <algorithm>
+#include <chrono>
+
+/**
+ * @brief Checks if a future has a value or an error, without blocking
+ * @param future The future to check
+ * @return true if the future is ready
+ */
+static bool isReady(const std::future<std::string>& future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+PoDoFo::PdfRemoteSignPipeline::PdfRemoteSignPipeline(PdfRemoteSigningService signingService,
+    PdfRemoteTimestampService timestampService, unsigned maxConcurrency)
+    : _signingService(std::move(signingService))
+    , _timestampService(std::move(timestampService))
+    , _maxConcurrency(maxConcurrency)
+    , _idleWorkers(0)
+    , _stopping(false)
+{
+    if (!_signingService) {
+        throw std::runtime_error("A signing service is required");
+    }
+
+    if (_maxConcurrency == 0) {
+        _maxConcurrency = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+PoDoFo::PdfRemoteSignPipeline::~PdfRemoteSignPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _cond.notify_all();
+
+    // NOTE: The tasks reference the jobs
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+std::future<void> PoDoFo::PdfRemoteSignPipeline::submit(std::unique_ptr<PdfRemoteSignDocumentSession> session,
+    const std::optional<ValidationData>& validationData) {
+    if (!session) {
+        throw std::runtime_error("The session must be not null");
+    }
+
+    _jobs.emplace_back();
+    auto& job = _jobs.back();
+    auto done = job.Done.get_future();
+    job.Session = std::move(session);
+    job.Validation = validationData;
+
+    // beginSigning() loads and saves the whole document:
+    // run it on a worker, so the caller is never blocked
+    auto jobSession = job.Session.get();
+    job.Stage = JobStage::Preparing;
+    job.Pending = post([jobSession] { return jobSession->beginSigning(); });
+    return done;
+}
+
+size_t PoDoFo::PdfRemoteSignPipeline::poll() {
+    for (auto it = _jobs.begin(); it != _jobs.end(); ) {
+        if (advance(*it)) {
+            it = _jobs.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    return _jobs.size();
+}
+
+void PoDoFo::PdfRemoteSignPipeline::drain() {
+    while (poll() != 0) {
+        // Every document must complete anyway, so just
+        // block on the oldest one before polling again
+        _jobs.front().Pending.wait();
+    }
+}
+
+bool PoDoFo::PdfRemoteSignPipeline::advance(Job& job) {
+    try {
+        while (isReady(job.Pending)) {
+            if (startNextStage(job, job.Pending.get())) {
+                job.Done.set_value();
+                return true;
+            }
+
+            if (!job.Pending.valid()) {
+                throw std::runtime_error("The remote service returned an invalid future");
+            }
+        }
+
+        return false;
+    }
+    catch (...) {
+        job.Done.set_exception(std::current_exception());
+        return true;
+    }
+}
+
+bool PoDoFo::PdfRemoteSignPipeline::startNextStage(Job& job, const std::string& result) {
+    // NOTE: The tasks reference the job, which is not
+    // erased until the task of its last stage completes
+    auto jobPtr = &job;
+    bool lta = job.Session->conformanceLevel() == "ADES_B_LTA";
+    switch (job.Stage) {
+        case JobStage::Preparing:
+            job.Stage = JobStage::Signing;
+            job.Pending = _signingService(result);
+            return false;
+        case JobStage::Signing:
+            job.SignedHash = result;
+            if (job.Session->conformanceLevel() != "ADES_B_B") {
+                job.Stage = JobStage::Timestamping;
+                job.Pending = requestTimestamp(job, job.SignedHash, PdfRemoteTimestampTarget::Signature);
+                return false;
+            }
+
+            job.Stage = JobStage::Finishing;
+            job.Pending = post([jobPtr] {
+                jobPtr->Session->finishSigning(jobPtr->SignedHash, { }, jobPtr->Validation);
+                return std::string();
+            });
+            return false;
+        case JobStage::Timestamping:
+            // The DocTimeStamp is prepared right after the signature,
+            // while the document is still kept by the session
+            job.Stage = JobStage::Finishing;
+            job.Pending = post([jobPtr, lta, tsr = result] {
+                jobPtr->Session->finishSigning(jobPtr->SignedHash, tsr, jobPtr->Validation);
+                return lta ? jobPtr->Session->beginSigningLTA() : std::string();
+            });
+            return false;
+        case JobStage::Finishing:
+            if (!lta) {
+                return true;
+            }
+
+            job.Stage = JobStage::TimestampingLTA;
+            job.Pending = requestTimestamp(job, result, PdfRemoteTimestampTarget::Document);
+            return false;
+        case JobStage::TimestampingLTA:
+            job.Stage = JobStage::FinishingLTA;
+            job.Pending = post([jobPtr, tsr = result] {
+                jobPtr->Session->finishSigningLTA(tsr, jobPtr->Validation);
+                return std::string();
+            });
+            return false;
+        case JobStage::FinishingLTA:
+            return true;
+        default:
+            throw std::runtime_error("Unsupported pipeline stage");
+    }
+}
+
+std::future<std::string> PoDoFo::PdfRemoteSignPipeline::requestTimestamp(const Job& job, const std::string& data,
+    PdfRemoteTimestampTarget target) {
+    if (!_timestampService) {
+        throw std::runtime_error("A timestamp service is required for " + job.Session->conformanceLevel());
+    }
+
+    return _timestampService(data, target);
+}
+
+std::future<std::string> PoDoFo::PdfRemoteSignPipeline::post(std::function<std::string()> task) {
+    std::packaged_task<std::string()> packaged(std::move(task));
+    auto ret = packaged.get_future();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(packaged));
+        if (_workers.size() < _maxConcurrency && _idleWorkers < _tasks.size()) {
+            _workers.emplace_back(&PdfRemoteSignPipeline::runTasks, this);
+        }
+    }
+    _cond.notify_one();
+    return ret;
+}
+
+void PoDoFo::PdfRemoteSignPipeline::runTasks() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _idleWorkers++;
+        _cond.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+        _idleWorkers--;
+        if (_stopping) {
+            return;
+        }
+
+        auto task = std::move(_tasks.front());
+        _tasks.pop_front();
+        lock.unlock();
+
+        // NOTE: The packaged task stores the
+        // exception of a failed step in its future
+        task();
+        lock.lock();
+    }
+}
@@ -0,0 +1,189 @@
+// PdfRemoteSignPipeline.h
+/**
+ * @file PdfRemoteSignPipeline.h
+ * @brief Non-blocking remote signing of many PDF documents driven by asynchronous services.
+ *
+ * This header declares the `PdfRemoteSignPipeline` which keeps many remote signatures in flight
+ * on a single thread. The remote signer (HSM/QTSP) and the TSA are user-provided callbacks
+ * returning futures, so they can be backed by any asynchronous client or by a local stub.
+ */
+#ifndef PDF_REMOTE_SIGN_PIPELINE_H
+#define PDF_REMOTE_SIGN_PIPELINE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#include "PdfRemoteSignDocumentSession.h"
+
+namespace PoDoFo {
+
+    /**
+     * @brief Asynchronous remote signer.
+     *
+     * Receives the URL-encoded base64 hash returned by `PdfRemoteSignDocumentSession::beginSigning()`
+     * and returns a future of the base64-encoded signed value.
+     */
+    using PdfRemoteSigningService = std::function<std::future<std::string>(const std::string& hash)>;
+
+    /**
+     * @brief What a time stamp requested to the TSA client is applied to.
+     */
+    enum class PdfRemoteTimestampTarget {
+        Signature,  /**< The signature value, for ADES_B_T, ADES_B_LT and ADES_B_LTA */
+        Document    /**< The DocTimeStamp appended for ADES_B_LTA */
+    };
+
+    /**
+     * @brief Asynchronous TSA client.
+     *
+     * For PdfRemoteTimestampTarget::Signature it receives the base64-encoded signed value returned
+     * by the remote signer, that must be hashed into the message imprint. For
+     * PdfRemoteTimestampTarget::Document it receives the base64-encoded digest returned by
+     * `PdfRemoteSignDocumentSession::beginSigningLTA()`, that is the message imprint itself.
+     * Returns a future of the base64-encoded TimeStampResp.
+     */
+    using PdfRemoteTimestampService = std::function<std::future<std::string>(const std::string& data,
+        PdfRemoteTimestampTarget target)>;
+
+    /**
+     * @brief Drives many remote signing sessions concurrently from a single thread.
+     *
+     * submit() queues a document to be prepared on a worker thread and returns without waiting.
+     * poll() advances every document whose pending step is ready: it sends the hash of a prepared
+     * document to the remote signer, requests the timestamp when the conformance level needs one
+     * and queues the signature to be finished on a worker thread. For ADES_B_LTA the worker then
+     * prepares the DocTimeStamp, whose digest is sent to the TSA, and a worker appends it when
+     * the timestamp is ready. The waits on the remote services never block and the document I/O
+     * runs on the workers, so one thread can keep hundreds of signatures in flight.
+     *
+     * The pipeline is not thread safe: submit(), poll() and drain() must be called from the same
+     * thread, or be externally synchronized. The services may complete their futures from any thread.
+     */
+    class PODOFO_API PdfRemoteSignPipeline final {
+    public:
+        /**
+         * @brief Construct a signing pipeline.
+         * @param signingService The asynchronous remote signer.
+         * @param timestampService The asynchronous TSA client. Required only for documents with timestamps.
+         * @param maxConcurrency Maximum number of worker threads preparing and finishing the documents,
+         *      0 to use the hardware concurrency.
+         */
+        PdfRemoteSignPipeline(PdfRemoteSigningService signingService,
+            PdfRemoteTimestampService timestampService = nullptr,
+            unsigned maxConcurrency = 0);
+
+        /**
+         * @brief Copy constructor (deleted)
+         */
+        PdfRemoteSignPipeline(const PdfRemoteSignPipeline&) = delete;
+        /**
+         * @brief Copy assignment operator (deleted)
+         */
+        PdfRemoteSignPipeline& operator=(const PdfRemoteSignPipeline&) = delete;
+        /**
+         * @brief Destructor. Documents still in flight are abandoned, after
+         *      waiting the ones that are being processed on the worker threads.
+         */
+        ~PdfRemoteSignPipeline();
+
+        /**
+         * @brief Queues the document to be prepared on a worker thread, then signed by the remote signer.
+         * @param session The session of the document, not yet started.
+         * @param validationData Optional validation artifacts to embed into the DSS.
+         * @return A future that completes when the document is signed, or holds the error that stopped it.
+         */
+        std::future<void> submit(std::unique_ptr<PdfRemoteSignDocumentSession> session,
+            const std::optional<ValidationData>& validationData = std::nullopt);
+
+        /**
+         * @brief Advances all the documents whose remote results are ready, without blocking.
+         * @return Number of documents still in flight.
+         */
+        size_t poll();
+
+        /**
+         * @brief Blocks until all the submitted documents are finished or failed.
+         */
+        void drain();
+
+        /** @return Number of documents in flight. */
+        size_t pendingCount() const { return _jobs.size(); }
+
+    private:
+        /**
+         * @brief Step a document in flight is waiting for
+         */
+        enum class JobStage {
+            Preparing,         /**< beginSigning() on a worker, resolves to the hash */
+            Signing,           /**< The remote signer, resolves to the signed hash */
+            Timestamping,      /**< The TSA over the signature, resolves to the TSR */
+            Finishing,         /**< finishSigning() on a worker, resolves to the LTA digest for ADES_B_LTA */
+            TimestampingLTA,   /**< The TSA over the LTA digest, resolves to the TSR */
+            FinishingLTA       /**< finishSigningLTA() on a worker */
+        };
+
+        /**
+         * @brief State of a document in flight
+         */
+        struct Job {
+            std::unique_ptr<PdfRemoteSignDocumentSession> Session;
+            std::optional<ValidationData>                 Validation;
+            JobStage                                      Stage;
+            std::future<std::string>                      Pending;
+            std::string                                   SignedHash;
+            std::promise<void>                            Done;
+        };
+
+        /**
+         * @brief Advances a single document while its pending result is ready
+         * @param job The document to advance
+         * @return true if the document is finished or failed
+         */
+        bool advance(Job& job);
+        /**
+         * @brief Starts the step of a document that follows the completed one
+         * @param job The document to advance
+         * @param result The result of the completed step
+         * @return true if the document is finished
+         */
+        bool startNextStage(Job& job, const std::string& result);
+        /**
+         * @brief Requests a time stamp to the TSA client
+         * @param job The document that needs the time stamp
+         * @param data The data passed to the TSA client
+         * @param target What the time stamp is applied to
+         * @return The future of the TSR
+         */
+        std::future<std::string> requestTimestamp(const Job& job, const std::string& data,
+            PdfRemoteTimestampTarget target);
+        /**
+         * @brief Queues a task to be run on a worker thread, starting a new worker if needed
+         * @param task The task to run, returning the result of the step
+         * @return The future of the task result
+         */
+        std::future<std::string> post(std::function<std::string()> task);
+        /**
+         * @brief Runs the queued tasks, until the pipeline is destroyed
+         */
+        void runTasks();
+
+        PdfRemoteSigningService                          _signingService;
+        PdfRemoteTimestampService                        _timestampService;
+        std::list<Job>                                   _jobs;
+        unsigned                                         _maxConcurrency;
+        std::mutex                                       _mutex;
+        std::condition_variable                          _cond;
+        std::deque<std::packaged_task<std::string()>>    _tasks;
+        size_t                                           _idleWorkers;
+        bool                                             _stopping;
+        std::vector<std::thread>                         _workers;
+    };
+
+} // namespace PoDoFo
+
+#endif // PDF_REMOTE_SIGN_PIPELINE_H
@@ -184,6 +184,24 @@ void PdfSignerCms::ReserveAttributeSize(unsigned attrSize)
     m_reservedSize += (attrSize + 40);
 }
 
+void PdfSignerCms::SaveDeferredState(charbuff& state) const
+{
+    if (!m_deferredSigning.has_value() || !*m_deferredSigning || m_cmsContext == nullptr)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "A deferred signing has not been started");
+
+    m_cmsContext->SaveState(state);
+}
+
+void PdfSignerCms::RestoreDeferredState(const bufferview& state)
+{
+    ensureDeferredSigning();
+    if (m_cmsContext == nullptr)
+        m_cmsContext.reset(new CmsContext());
+
+    resetContext();
+    m_cmsContext->RestoreState(state);
+}
+
 void PdfSignerCms::ensureEventBasedSigning()
 {
     if (m_deferredSigning.has_value())
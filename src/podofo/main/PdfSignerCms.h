@@ -106,6 +106,20 @@ namespace PoDoFo
          */
         void ReserveAttributeSize(unsigned attrSize);
 
+        /** Save the state of a deferred signing after the intermediate
+         * result has been fetched. It can be restored on another signer,
+         * possibly in a different process, to finish the signature
+         * \param state the buffer that will hold the ASN.1 DER encoded state
+         */
+        void SaveDeferredState(charbuff& state) const;
+
+        /** Restore the state of a deferred signing previously saved
+         * with SaveDeferredState(). The signer must be constructed with
+         * the same certificate and parameters and after the call it's
+         * ready for ComputeSignatureDeferred()
+         */
+        void RestoreDeferredState(const bufferview& state);
+
     public:
         const PdfSignerCmsParams& GetParameters() const { return m_parameters; }
 
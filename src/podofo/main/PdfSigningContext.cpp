@@ -7,21 +7,70 @@
 #include <podofo/private/PdfDeclarationsPrivate.h>
 #include "PdfSigningContext.h"
 #include <podofo/auxiliary/StreamDevice.h>
+#include "PdfTokenizer.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 using namespace std;
 using namespace PoDoFo;
 
 constexpr const char* ByteRangeBeacon = "[ 0 1234567890 1234567890 1234567890]";
-constexpr size_t BufferSize = 65536;
+// NOTE: Chunks are big enough to make the cost of dispatching
+// them to worker threads negligible compared to hashing
+constexpr size_t BufferSize = 1048576;
+
+namespace
+{
+    struct SignerRange
+    {
+        PdfSignerId Id;
+        PdfSigner* Signer;
+        size_t ContentsOffset;
+        size_t ContentsEnd;
+    };
+
+    // Worker thread that feeds a group of signers with the chunks
+    // read from the device, while the following chunk is being read
+    class SignerWorker final
+    {
+    public:
+        SignerWorker(vector<SignerRange> ranges);
+        ~SignerWorker();
+
+    public:
+        void Post(const bufferview& chunk, size_t offset);
+        void Wait();
+
+    private:
+        SignerWorker(const SignerWorker&) = delete;
+        SignerWorker& operator=(const SignerWorker&) = delete;
+
+        void run();
+
+    private:
+        vector<SignerRange> m_ranges;
+        mutex m_mutex;
+        condition_variable m_cond;
+        bufferview m_chunk;
+        size_t m_offset;
+        bool m_pending;
+        bool m_stop;
+        exception_ptr m_error;
+        thread m_thread;
+    };
+}
 
 static PdfSignature& getSignature(PdfDocument& doc, int pageIndex, const PdfReference& signatureRef);
-static size_t readForSignature(StreamDevice& device,
-    size_t conentsBeaconOffset, size_t conentsBeaconSize,
-    char* buffer, size_t size);
+static void appendRangeData(const SignerRange& range, const bufferview& chunk, size_t offset);
+static void waitSigners(vector<unique_ptr<SignerWorker>>& workers);
 static void adjustByteRange(StreamDevice& device, size_t byteRangeOffset,
     size_t conentsBeaconOffset, size_t conentsBeaconSize, PdfArray& byteRangeArr, charbuff& buffer);
 static void setSignature(StreamDevice& device, const string_view& sigData,
     size_t conentsBeaconOffset, charbuff& buffer);
+static void writeContents(StreamDevice& device, charbuff& contents, size_t beaconSize,
+    size_t conentsBeaconOffset, charbuff& buffer);
 static void prepareBeaconsData(size_t signatureSize, string& contentsBeacon, string& byteRangeBeacon);
 
 PdfSigningContext::PdfSigningContext()
@@ -78,6 +127,89 @@ void PdfSigningContext::FinishSigning(const PdfSigningResults& processedResults)
     m_contexts.clear();
 }
 
+PdfPreparedSignature PdfSigningContext::GetPreparedSignature(const PdfSignerId& id) const
+{
+    if (m_doc == nullptr)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "A deferred signing has not been started");
+
+    auto found = m_contexts.find(id);
+    if (found == m_contexts.end())
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidKey, "Unknown signer");
+
+    auto& ctx = found->second;
+    PdfPreparedSignature ret;
+    ret.ByteRangeOffset = *ctx.Beacons.ByteRangeOffset;
+    ret.ContentsOffset = *ctx.Beacons.ContentsOffset;
+    ret.ContentsSize = ctx.BeaconSize;
+    ret.DeviceLength = m_device->GetLength();
+    return ret;
+}
+
+void PdfSigningContext::FinishSigning(StreamDevice& device, const PdfPreparedSignature& prepared,
+    PdfSigner& signer, const bufferview& processedResult)
+{
+    ValidatePreparedSignature(device, prepared);
+
+    charbuff contents;
+    charbuff tmpbuff;
+    signer.ComputeSignatureDeferred(processedResult, contents, false);
+    writeContents(device, contents, prepared.ContentsSize, prepared.ContentsOffset, tmpbuff);
+}
+
+void PdfSigningContext::ValidatePreparedSignature(StreamDevice& device, const PdfPreparedSignature& prepared)
+{
+    if (device.GetLength() != prepared.DeviceLength)
+    {
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::IOError,
+            "The device length doesn't match the one of the prepared signature");
+    }
+
+    // The /Contents are reserved as an hex string, including delimiters
+    size_t contentsEnd = prepared.ContentsOffset + prepared.ContentsSize * 2 + 2;
+    size_t byteRangeEnd = prepared.ByteRangeOffset + char_traits<char>::length(ByteRangeBeacon);
+    if (prepared.ContentsSize == 0 || contentsEnd > prepared.DeviceLength || byteRangeEnd > prepared.DeviceLength)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::ValueOutOfRange, "The prepared signature lies outside the device");
+
+    charbuff buffer(byteRangeEnd - prepared.ByteRangeOffset);
+    device.Seek(prepared.ByteRangeOffset);
+    device.Read(buffer.data(), buffer.size());
+
+    PdfVariant variant;
+    PdfTokenizer tokenizer;
+    SpanStreamDevice byteRangeDevice(buffer);
+    const PdfArray* byteRange;
+    int64_t expected[4] = { 0, (int64_t)prepared.ContentsOffset, (int64_t)contentsEnd,
+        (int64_t)(prepared.DeviceLength - contentsEnd) };
+    if (!tokenizer.TryReadNextVariant(byteRangeDevice, variant)
+        || !variant.TryGetArray(byteRange) || byteRange->size() != 4)
+    {
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidDataType, "The /ByteRange of the prepared signature is invalid");
+    }
+
+    for (unsigned i = 0; i < 4; i++)
+    {
+        int64_t num;
+        if (!(*byteRange)[i].TryGetNumber(num) || num != expected[i])
+        {
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidDataType,
+                "The /ByteRange doesn't match the location of the prepared signature");
+        }
+    }
+
+    // The reserved space must be still blank, as written by StartSigning()
+    buffer.resize(contentsEnd - prepared.ContentsOffset);
+    device.Seek(prepared.ContentsOffset);
+    device.Read(buffer.data(), buffer.size());
+    for (char ch : buffer)
+    {
+        if (ch != ' ')
+        {
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidDataType,
+                "The /Contents reserved for the prepared signature were modified");
+        }
+    }
+}
+
 void PdfSigningContext::Sign(PdfMemDocument& doc, StreamDevice& device, PdfSaveOptions saveOptions)
 {
     ensureNotStarted();
@@ -174,6 +306,9 @@ void PdfSigningContext::saveDocForSigning(PdfMemDocument& doc, StreamDevice& dev
         acroForm->GetDictionary().RemoveKey("NeedAppearances");
     }
 
+    // The signature beacons record their offsets in the device while
+    // written: don't rely on the writer to keep them in place
+    saveOptions &= ~PdfSaveOptions::ParallelWrite;
     if ((saveOptions & PdfSaveOptions::SaveOnSigning) != PdfSaveOptions::None)
         doc.Save(device, saveOptions);
     else
@@ -185,6 +320,9 @@ void PdfSigningContext::saveDocForSigning(PdfMemDocument& doc, StreamDevice& dev
 void PdfSigningContext::appendDataForSigning(unordered_map<PdfSignerId, SignatureCtx>& contexts, StreamDevice& device,
     std::unordered_map<PdfSignerId, charbuff>* intermediateResults, charbuff& tmpbuff)
 {
+    // Set the actual /ByteRange of all the signatures first, so
+    // all signers can be fed in a single sequential pass over the device
+    vector<SignerRange> ranges;
     for (auto& pair : m_signers)
     {
         auto& attrs = pair.second;
@@ -196,22 +334,66 @@ void PdfSigningContext::appendDataForSigning(unordered_map<PdfSignerId, Signatur
 
             adjustByteRange(device, *ctx.Beacons.ByteRangeOffset, *ctx.Beacons.ContentsOffset,
                 ctx.Beacons.ContentsBeacon.size(), ctx.ByteRangeArr, tmpbuff);
-            device.Flush();
 
-            // Read data from the device to prepare the signature
             signer->Reset();
-            device.Seek(0);
-            size_t readBytes;
-            tmpbuff.resize(BufferSize);
-            while ((readBytes = readForSignature(device, *ctx.Beacons.ContentsOffset, ctx.Beacons.ContentsBeacon.size(),
-                tmpbuff.data(), BufferSize)) != 0)
-            {
-                signer->AppendData({ tmpbuff.data(), readBytes });
-            }
-
-            if (intermediateResults != nullptr)
-                signer->FetchIntermediateResult((*intermediateResults)[signerId]);
+            ranges.push_back({ signerId, signer, *ctx.Beacons.ContentsOffset,
+                *ctx.Beacons.ContentsOffset + ctx.Beacons.ContentsBeacon.size() });
+        }
+    }
+    device.Flush();
+
+    // Read data from the device to prepare the signatures. The
+    // device is read once. With a single signer the chunks are
+    // hashed inline, otherwise the signers are split among at most
+    // as many worker threads as the hardware can run concurrently,
+    // which hash a chunk while the following one is read from the device
+    size_t length = device.GetLength();
+    device.Seek(0);
+    size_t offset = 0;
+    if (ranges.size() == 1)
+    {
+        tmpbuff.resize(BufferSize);
+        while (offset < length)
+        {
+            size_t readSize = std::min(BufferSize, length - offset);
+            device.Read(tmpbuff.data(), readSize);
+            appendRangeData(ranges[0], { tmpbuff.data(), readSize }, offset);
+            offset += readSize;
+        }
+    }
+    else
+    {
+        charbuff readbuff(BufferSize);
+        tmpbuff.resize(BufferSize);
+        size_t workerCount = std::min<size_t>(ranges.size(), std::max(1u, thread::hardware_concurrency()));
+        vector<vector<SignerRange>> workerRanges(workerCount);
+        for (size_t i = 0; i < ranges.size(); i++)
+            workerRanges[i % workerCount].push_back(ranges[i]);
+
+        vector<unique_ptr<SignerWorker>> workers;
+        workers.reserve(workerCount);
+        for (auto& group : workerRanges)
+            workers.push_back(std::make_unique<SignerWorker>(std::move(group)));
+
+        while (offset < length)
+        {
+            size_t readSize = std::min(BufferSize, length - offset);
+            device.Read(readbuff.data(), readSize);
+            waitSigners(workers);
+            std::swap(readbuff, tmpbuff);
+            bufferview chunk(tmpbuff.data(), readSize);
+            for (auto& worker : workers)
+                worker->Post(chunk, offset);
+
+            offset += readSize;
         }
+        waitSigners(workers);
+    }
+
+    if (intermediateResults != nullptr)
+    {
+        for (auto& range : ranges)
+            range.Signer->FetchIntermediateResult((*intermediateResults)[range.Id]);
     }
 }
 
@@ -237,15 +419,7 @@ void PdfSigningContext::computeSignatures(unordered_map<PdfSignerId, SignatureCt
             else
                 signer->ComputeSignatureDeferred(processedResults->Intermediate.at(signerId), ctx.Contents, false);
 
-            if (ctx.Contents.size() > ctx.BeaconSize)
-                PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Actual signature size bigger than beacon size");
-
-            // Ensure the signature will be as big as the
-            // beacon size previously cached to fill all
-            // available reserved space for the /Contents
-            ctx.Contents.resize(ctx.BeaconSize);
-            setSignature(device, ctx.Contents, *ctx.Beacons.ContentsOffset, tmpbuff);
-            device.Flush();
+            writeContents(device, ctx.Contents, ctx.BeaconSize, *ctx.Beacons.ContentsOffset, tmpbuff);
 
             // Finally set actual /ByteRange on the signature without dirty set
             signature.SetContentsByteRangeNoDirtySet(ctx.Contents, std::move(ctx.ByteRangeArr));
@@ -253,42 +427,44 @@ void PdfSigningContext::computeSignatures(unordered_map<PdfSignerId, SignatureCt
     }
 }
 
-size_t readForSignature(StreamDevice& device, size_t conentsBeaconOffset, size_t conentsBeaconSize,
-    char* buffer, size_t bufferSize)
+// Feed the signer with the part of the chunk at the given
+// offset that is covered by its /ByteRange
+void appendRangeData(const SignerRange& range, const bufferview& chunk, size_t offset)
 {
-    if (device.Eof())
-        return 0;
-
-    size_t pos = device.GetPosition();
-    size_t readSize = 0;
-    // Check if we are before beacon
-    if (pos < conentsBeaconOffset)
+    size_t chunkEnd = offset + chunk.size();
+    if (offset < range.ContentsOffset)
     {
-        readSize = std::min(bufferSize, conentsBeaconOffset - pos);
-        if (readSize > 0)
-        {
-            device.Read(buffer, readSize);
-            buffer += readSize;
-            bufferSize -= readSize;
-            if (bufferSize == 0)
-                return readSize;
-        }
+        size_t end = std::min(chunkEnd, range.ContentsOffset);
+        range.Signer->AppendData({ chunk.data(), end - offset });
     }
 
-    // shift at the end of beacon
-    if ((pos + readSize) >= conentsBeaconOffset
-        && pos < (conentsBeaconOffset + conentsBeaconSize))
+    if (chunkEnd > range.ContentsEnd)
     {
-        device.Seek(conentsBeaconOffset + conentsBeaconSize);
+        size_t start = std::max(offset, range.ContentsEnd);
+        range.Signer->AppendData({ chunk.data() + (start - offset), chunkEnd - start });
     }
+}
 
-    // read after beacon
-    bufferSize = std::min(bufferSize, device.GetLength() - device.GetPosition());
-    if (bufferSize == 0)
-        return readSize;
+void waitSigners(vector<unique_ptr<SignerWorker>>& workers)
+{
+    // NOTE: Wait all the workers before rethrowing an eventual
+    // exception, since they reference shared buffers
+    exception_ptr ex;
+    for (auto& worker : workers)
+    {
+        try
+        {
+            worker->Wait();
+        }
+        catch (...)
+        {
+            if (ex == nullptr)
+                ex = std::current_exception();
+        }
+    }
 
-    device.Read(buffer, bufferSize);
-    return readSize + bufferSize;
+    if (ex != nullptr)
+        std::rethrow_exception(ex);
 }
 
 void adjustByteRange(StreamDevice& device, size_t byteRangeOffset,
@@ -316,6 +492,20 @@ void setSignature(StreamDevice& device, const string_view& contentsData,
     sig.Write(device, PdfWriteFlags::None, { }, buffer);
 }
 
+void writeContents(StreamDevice& device, charbuff& contents, size_t beaconSize,
+    size_t conentsBeaconOffset, charbuff& buffer)
+{
+    if (contents.size() > beaconSize)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Actual signature size bigger than beacon size");
+
+    // Ensure the signature will be as big as the
+    // beacon size previously cached to fill all
+    // available reserved space for the /Contents
+    contents.resize(beaconSize);
+    setSignature(device, contents, conentsBeaconOffset, buffer);
+    device.Flush();
+}
+
 void prepareBeaconsData(size_t signatureSize, string& contentsBeacon, string& byteRangeBeacon)
 {
     // Just prepare strings with spaces, for easy writing later
@@ -342,3 +532,72 @@ PdfSignature& getSignature(PdfDocument& doc, int pageIndex, const PdfReference&
         return  static_cast<PdfSignature&>(doc.MustGetAcroForm().GetField(signatureRef));
     }
 }
+
+SignerWorker::SignerWorker(vector<SignerRange> ranges) :
+    m_ranges(std::move(ranges)),
+    m_offset(0),
+    m_pending(false),
+    m_stop(false)
+{
+    m_thread = thread(&SignerWorker::run, this);
+}
+
+SignerWorker::~SignerWorker()
+{
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+}
+
+void SignerWorker::Post(const bufferview& chunk, size_t offset)
+{
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_chunk = chunk;
+        m_offset = offset;
+        m_pending = true;
+    }
+    m_cond.notify_all();
+}
+
+void SignerWorker::Wait()
+{
+    unique_lock<mutex> lock(m_mutex);
+    m_cond.wait(lock, [this] { return !m_pending; });
+    if (m_error != nullptr)
+    {
+        auto error = std::move(m_error);
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void SignerWorker::run()
+{
+    unique_lock<mutex> lock(m_mutex);
+    while (true)
+    {
+        m_cond.wait(lock, [this] { return m_pending || m_stop; });
+        if (!m_pending)
+            return;
+
+        lock.unlock();
+        exception_ptr error;
+        try
+        {
+            for (auto& range : m_ranges)
+                appendRangeData(range, m_chunk, m_offset);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        m_error = std::move(error);
+        m_pending = false;
+        m_cond.notify_all();
+    }
+}
@@ -61,6 +61,19 @@ namespace PoDoFo
         std::unordered_map<PdfSignerId, charbuff> Intermediate;
     };
 
+    /**
+     * Location of a signature prepared with a deferred (aka "async") signing.
+     * It's enough to finish the signature directly on the output device,
+     * without the document and the context that started the signing
+     */
+    struct PODOFO_API PdfPreparedSignature final
+    {
+        size_t ByteRangeOffset = 0;     ///< Offset of the /ByteRange array in the device
+        size_t ContentsOffset = 0;      ///< Offset of the /Contents hex string in the device
+        size_t ContentsSize = 0;        ///< Size in bytes reserved for the signature /Contents
+        size_t DeviceLength = 0;        ///< Length of the device after the signature was prepared
+    };
+
     /**
      * A context that can be used to customize the signing process.
      * It also enables the deferred (aka "async") signing, which is a mean to separately process
@@ -72,6 +85,7 @@ namespace PoDoFo
     {
         friend PODOFO_API void SignDocument(PdfMemDocument& doc, StreamDevice& device, PdfSigner& signer,
             PdfSignature& signature, PdfSaveOptions saveOptions);
+        PODOFO_PRIVATE_FRIEND(class PdfSigningTest);
     public:
         PdfSigningContext();
 
@@ -94,6 +108,29 @@ namespace PoDoFo
          */
         void FinishSigning(const PdfSigningResults& processedResults);
 
+        /** Get the location of a signature of a started deferred (aka "async") signing procedure
+         */
+        PdfPreparedSignature GetPreparedSignature(const PdfSignerId& id) const;
+
+        /** Finish a deferred (aka "async") signing procedure directly on the device
+         * \param device the device holding the document prepared by StartSigning()
+         * \param prepared the location of the signature, as retrieved with GetPreparedSignature()
+         * \param signer a signer ready to compute the deferred signature
+         * \param processedResult the processed intermediate result, for example a signed hash
+         * \remarks the document and the context that started the signing are not needed,
+         *      so the signature can be finished in a different process
+         */
+        static void FinishSigning(StreamDevice& device, const PdfPreparedSignature& prepared,
+            PdfSigner& signer, const bufferview& processedResult);
+
+        /** Check the device still holds the signature as it was prepared by StartSigning()
+         * \param device the device holding the document prepared by StartSigning()
+         * \param prepared the location of the signature, as retrieved with GetPreparedSignature()
+         * \remarks it checks the device length, the /ByteRange and that the
+         *      reserved /Contents are still blank and of the prepared size
+         */
+        static void ValidatePreparedSignature(StreamDevice& device, const PdfPreparedSignature& prepared);
+
     private:
         struct SignatureAttrs
         {
@@ -23,6 +23,22 @@ static bool tryGetEscapedCharacter(char ch, char& escapedChar);
 static void readHexString(InputStreamDevice& device, charbuff& buffer);
 static bool isOctalChar(char ch);
 
+// Character classes used by the contiguous buffer fast path
+constexpr uint8_t CharClassWhitespace = 1;
+constexpr uint8_t CharClassDelimiter = 2;
+
+static constexpr array<uint8_t, 256> s_charClasses = []()
+{
+    array<uint8_t, 256> ret{ };
+    for (char ch : { '\0', '\t', '\n', '\f', '\r', ' ' })
+        ret[(unsigned char)ch] = CharClassWhitespace;
+
+    for (char ch : { '(', ')', '<', '>', '[', ']', '{', '}', '/', '%' })
+        ret[(unsigned char)ch] = CharClassDelimiter;
+
+    return ret;
+}();
+
 PdfTokenizer::PdfTokenizer(const PdfTokenizerOptions& options)
     : PdfTokenizer(std::in_place, std::make_shared<charbuff>(BufferSize), options)
 {
@@ -68,6 +84,10 @@ bool PdfTokenizer::TryReadNextToken(InputStreamDevice& device, string_view& toke
         return true;
     }
 
+    bufferview view;
+    if (device.TryGetBufferView(view))
+        return tryReadNextToken(device, view, token, tokenType);
+
     tokenType = PdfTokenType::Literal;
 
     char ch1;
@@ -180,6 +200,102 @@ Eof:
     goto Exit;
 }
 
+// Contiguous buffer version of TryReadNextToken(): it scans the device
+// content directly and returns a token view into it, without copying.
+// It must behave exactly as the generic character by character version
+bool PdfTokenizer::tryReadNextToken(InputStreamDevice& device, const bufferview& view,
+    string_view& token, PdfTokenType& tokenType)
+{
+    const char* buffer = view.data();
+    size_t length = view.size();
+    size_t maxSize = m_buffer->size() - 1;
+    size_t pos = device.GetPosition();
+    tokenType = PdfTokenType::Literal;
+
+    // Skip leading whitespaces and comments
+    while (true)
+    {
+        if (pos >= length)
+        {
+            device.Seek(length);
+            token = { };
+            return false;
+        }
+
+        char ch = buffer[pos];
+        if ((s_charClasses[(unsigned char)ch] & CharClassWhitespace) != 0)
+        {
+            pos++;
+        }
+        else if (ch == '%')
+        {
+            do
+            {
+                pos++;
+            } while (pos < length && buffer[pos] != '\n' && buffer[pos] != '\r');
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    size_t start = pos;
+    char ch1 = buffer[pos++];
+    bool readLiteral = false;
+    if (ch1 == '<' || ch1 == '>')
+    {
+        if (pos != length)
+        {
+            if (buffer[pos] == ch1)
+            {
+                pos++;
+                if ((int)m_options.LanguageLevel < 2)
+                    readLiteral = true;
+                else if (ch1 == '<')
+                    tokenType = PdfTokenType::DoubleAngleBracketsLeft;
+                else
+                    tokenType = PdfTokenType::DoubleAngleBracketsRight;
+            }
+            else
+            {
+                if (ch1 == '<')
+                    tokenType = PdfTokenType::AngleBracketLeft;
+                else
+                    tokenType = PdfTokenType::AngleBracketRight;
+            }
+        }
+    }
+    else if (!IsCharTokenDelimiter(ch1, tokenType))
+    {
+        tokenType = PdfTokenType::Literal;
+        readLiteral = true;
+    }
+
+    size_t end = pos;
+    if (readLiteral)
+    {
+        size_t limit = std::min(length, start + maxSize);
+        while (end < limit && s_charClasses[(unsigned char)buffer[end]] == 0)
+            end++;
+
+        pos = end;
+        if (end < limit && buffer[end] == '%')
+        {
+            // Comments are treated as token-delimiting whitespace
+            // and they are consumed together with the token
+            do
+            {
+                pos++;
+            } while (pos < length && buffer[pos] != '\n' && buffer[pos] != '\r');
+        }
+    }
+
+    device.Seek(pos);
+    token = string_view(buffer + start, end - start);
+    return true;
+}
+
 bool PdfTokenizer::TryPeekNextToken(InputStreamDevice& device, string_view& token)
 {
     PdfTokenType tokenType;
@@ -188,11 +304,20 @@ bool PdfTokenizer::TryPeekNextToken(InputStreamDevice& device, string_view& toke
 
 bool PdfTokenizer::TryPeekNextToken(InputStreamDevice& device, string_view& token, PdfTokenType& tokenType)
 {
+    // NOTE: On contiguous devices with no queued tokens
+    // the token is not consumed just by seeking back
+    bufferview view;
+    bool canRewind = m_tokenQueque.size() == 0 && device.TryGetBufferView(view);
+    size_t position = canRewind ? device.GetPosition() : 0;
     if (!this->TryReadNextToken(device, token, tokenType))
         return false;
 
     // Don't consume the token
-    this->EnqueueToken(token, tokenType);
+    if (canRewind)
+        device.Seek(position);
+    else
+        this->EnqueueToken(token, tokenType);
+
     return true;
 }
 
@@ -280,20 +405,17 @@ PdfTokenizer::PdfLiteralDataType PdfTokenizer::DetermineDataType(InputStreamDevi
             }
 
             PdfLiteralDataType dataType = PdfLiteralDataType::Number;
-            const char* start = token.data();
-            while (*start)
+            for (char ch : token)
             {
-                if (*start == '.')
+                if (ch == '.')
                 {
                     dataType = PdfLiteralDataType::Real;
                 }
-                else if (!(isdigit(*start) || *start == '-' || *start == '+'))
+                else if (!(isdigit(ch) || ch == '-' || ch == '+'))
                 {
                     dataType = PdfLiteralDataType::Unknown;
                     break;
                 }
-
-                start++;
             }
 
             if (dataType == PdfLiteralDataType::Real)
@@ -329,6 +451,12 @@ PdfTokenizer::PdfLiteralDataType PdfTokenizer::DetermineDataType(InputStreamDevi
                 // we cannot be sure that there is another token
                 // on the input device, so if we hit EOF just return
                 // EPdfDataType::Number .
+                // NOTE: On contiguous devices with no queued tokens
+                // the lookahead is undone just by seeking back
+                bufferview view;
+                bool canRewind = m_tokenQueque.size() == 0 && device.TryGetBufferView(view);
+                size_t position = canRewind ? device.GetPosition() : 0;
+
                 PdfTokenType secondTokenType;
                 string_view nextToken;
                 bool gotToken = this->TryReadNextToken(device, nextToken, secondTokenType);
@@ -339,44 +467,46 @@ PdfTokenizer::PdfLiteralDataType PdfTokenizer::DetermineDataType(InputStreamDevi
                     return PdfLiteralDataType::Number;
                 }
 
-                if (secondTokenType != PdfTokenType::Literal)
-                {
-                    this->EnqueueToken(nextToken, secondTokenType);
-                    new(&variant.m_Number)PdfVariant::PrimitiveMember(num1);
-                    return PdfLiteralDataType::Number;
-                }
-
                 int64_t num2;
-                if (!utls::TryParse(nextToken, num2))
+                if (secondTokenType != PdfTokenType::Literal || !utls::TryParse(nextToken, num2))
                 {
                     // Don't consume the token
-                    this->EnqueueToken(nextToken, secondTokenType);
+                    if (canRewind)
+                        device.Seek(position);
+                    else
+                        this->EnqueueToken(nextToken, secondTokenType);
+
                     new(&variant.m_Number)PdfVariant::PrimitiveMember(num1);
                     return PdfLiteralDataType::Number;
                 }
 
-                string tmp(nextToken);
+                string tmp;
+                if (!canRewind)
+                    tmp = nextToken;
+
                 PdfTokenType thirdTokenType;
                 gotToken = this->TryReadNextToken(device, nextToken, thirdTokenType);
-                if (!gotToken)
-                {
-                    // No third token, so it can't be a reference
-                    new(&variant.m_Number)PdfVariant::PrimitiveMember(num1);
-                    return PdfLiteralDataType::Number;
-                }
-                if (thirdTokenType == PdfTokenType::Literal &&
+                if (gotToken && thirdTokenType == PdfTokenType::Literal &&
                     nextToken.length() == 1 && nextToken[0] == 'R')
                 {
                     new(&variant.m_Reference)PdfReference(static_cast<uint32_t>(num1), static_cast<uint16_t>(num2));
                     return PdfLiteralDataType::Reference;
                 }
+
+                // Not a reference, don't consume the lookahead tokens
+                if (canRewind)
+                {
+                    device.Seek(position);
+                }
                 else
                 {
                     this->EnqueueToken(tmp, secondTokenType);
-                    this->EnqueueToken(nextToken, thirdTokenType);
-                    new(&variant.m_Number)PdfVariant::PrimitiveMember(num1);
-                    return PdfLiteralDataType::Number;
+                    if (gotToken)
+                        this->EnqueueToken(nextToken, thirdTokenType);
                 }
+
+                new(&variant.m_Number)PdfVariant::PrimitiveMember(num1);
+                return PdfLiteralDataType::Number;
             }
             else
             {
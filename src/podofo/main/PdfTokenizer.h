@@ -193,6 +193,7 @@ protected:
 private:
     PdfTokenizer(std::in_place_t, std::shared_ptr<charbuff>&& buffer, const PdfTokenizerOptions& options);
     bool tryReadDataType(InputStreamDevice& device, PdfLiteralDataType dataType, PdfVariant& variant, const PdfStatefulEncrypt* encrypt);
+    bool tryReadNextToken(InputStreamDevice& device, const bufferview& view, std::string_view& token, PdfTokenType& tokenType);
 
 private:
     using TokenizerPair = std::pair<std::string, PdfTokenType>;
@@ -0,0 +1,274 @@
+// PdfValidationMaterialCache.cpp
+/**
+ * @file PdfValidationMaterialCache.cpp
+ * @brief Implementation of the process-wide validation material cache.
+ */
+
+#include "PdfValidationMaterialCache.h"
+#include <podofo/private/OpenSSLInternal.h>
+#include <podofo/private/PdfFilterFactory.h>
+#include <openssl/ocsp.h>
+#include <openssl/x509v3.h>
+
+constexpr std::chrono::seconds DefaultTimeToLive(3600);
+constexpr size_t DefaultMaxEntries = 4096;
+
+/**
+ * @brief Moves the expiration earlier if the given ASN.1 time comes first
+ * @param time The ASN.1 time, may be null
+ * @param now Current time
+ * @param expiration The expiration to update
+ */
+static void clampExpiration(const ASN1_TIME* time, const std::chrono::system_clock::time_point& now,
+    std::chrono::system_clock::time_point& expiration) {
+    int days;
+    int seconds;
+    if (time == nullptr || ASN1_TIME_diff(&days, &seconds, nullptr, time) == 0) {
+        return;
+    }
+
+    auto limit = now + std::chrono::hours(24) * days + std::chrono::seconds(seconds);
+    if (limit < expiration) {
+        expiration = limit;
+    }
+}
+
+/**
+ * @brief Appends a general name to a list if it is an URI
+ * @param name The general name
+ * @param urls The list to append to
+ */
+static void appendUri(const GENERAL_NAME* name, std::vector<std::string>& urls) {
+    if (name == nullptr || name->type != GEN_URI) {
+        return;
+    }
+
+    const ASN1_IA5STRING* uri = name->d.uniformResourceIdentifier;
+    if (uri != nullptr && ASN1_STRING_length(uri) > 0) {
+        urls.emplace_back(reinterpret_cast<const char*>(ASN1_STRING_get0_data(uri)), ASN1_STRING_length(uri));
+    }
+}
+
+/**
+ * @brief Extracts the CRL distribution points and the AIA URLs of a certificate
+ * @param cert The certificate
+ * @param material The entry to fill
+ */
+static void extractUrls(X509* cert, PoDoFo::PdfValidationMaterial& material) {
+    std::unique_ptr<CRL_DIST_POINTS, decltype(&CRL_DIST_POINTS_free)> distPoints(
+        static_cast<CRL_DIST_POINTS*>(X509_get_ext_d2i(cert, NID_crl_distribution_points, nullptr, nullptr)),
+        CRL_DIST_POINTS_free);
+    if (distPoints) {
+        for (int i = 0; i < sk_DIST_POINT_num(distPoints.get()); ++i) {
+            DIST_POINT* dp = sk_DIST_POINT_value(distPoints.get(), i);
+            if (dp == nullptr || dp->distpoint == nullptr || dp->distpoint->type != 0) {
+                continue;
+            }
+
+            GENERAL_NAMES* names = dp->distpoint->name.fullname;
+            for (int j = 0; j < sk_GENERAL_NAME_num(names); ++j) {
+                appendUri(sk_GENERAL_NAME_value(names, j), material.crlUrls);
+            }
+        }
+    }
+
+    std::unique_ptr<AUTHORITY_INFO_ACCESS, decltype(&AUTHORITY_INFO_ACCESS_free)> info(
+        static_cast<AUTHORITY_INFO_ACCESS*>(X509_get_ext_d2i(cert, NID_info_access, nullptr, nullptr)),
+        AUTHORITY_INFO_ACCESS_free);
+    if (info) {
+        for (int i = 0; i < sk_ACCESS_DESCRIPTION_num(info.get()); ++i) {
+            ACCESS_DESCRIPTION* ad = sk_ACCESS_DESCRIPTION_value(info.get(), i);
+            switch (OBJ_obj2nid(ad->method)) {
+            case NID_ad_OCSP:
+                appendUri(ad->location, material.ocspUrls);
+                break;
+            case NID_ad_ca_issuers:
+                appendUri(ad->location, material.caIssuerUrls);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+PoDoFo::PdfValidationMaterialCache& PoDoFo::PdfValidationMaterialCache::instance() {
+    static PdfValidationMaterialCache s_instance;
+    return s_instance;
+}
+
+PoDoFo::PdfValidationMaterialCache::PdfValidationMaterialCache()
+    : _timeToLive(DefaultTimeToLive), _maxEntries(DefaultMaxEntries) {
+}
+
+std::shared_ptr<const PoDoFo::PdfValidationMaterial> PoDoFo::PdfValidationMaterialCache::get(
+    ValidationMaterialType type, const bufferview& der) {
+    auto ret = tryGet(type, der);
+    if (ret == nullptr) {
+        switch (type) {
+        case ValidationMaterialType::Certificate:
+            throw std::runtime_error("Failed to parse DER certificate");
+        case ValidationMaterialType::Crl:
+            throw std::runtime_error("Failed to parse DER CRL");
+        case ValidationMaterialType::Ocsp:
+        default:
+            throw std::runtime_error("Failed to parse DER OCSP response");
+        }
+    }
+
+    return ret;
+}
+
+std::shared_ptr<const PoDoFo::PdfValidationMaterial> PoDoFo::PdfValidationMaterialCache::tryGet(
+    ValidationMaterialType type, const bufferview& der) {
+    std::string sha256 = ssl::ComputeHash(der, PdfHashingAlgorithm::SHA256);
+    auto now = std::chrono::system_clock::now();
+    std::chrono::seconds timeToLive;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _entries.find(sha256);
+        if (found != _entries.end()) {
+            if (found->second->type == type && now < found->second->expiration) {
+                return found->second;
+            }
+
+            _entries.erase(found);
+        }
+
+        timeToLive = _timeToLive;
+    }
+
+    // Parse outside the lock: other threads keep hitting the cache
+    // meanwhile, and a duplicated parse of the same blob is harmless
+    auto material = parse(type, der, std::move(sha256), now + timeToLive);
+    if (material == nullptr) {
+        return nullptr;
+    }
+
+    if (material->expiration <= now) {
+        // Stale material: still usable by the caller, but never cached
+        return material;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_entries.size() >= _maxEntries) {
+        makeRoom(now);
+    }
+
+    auto inserted = _entries.emplace(material->sha256, material);
+    return inserted.first->second;
+}
+
+void PoDoFo::PdfValidationMaterialCache::setTimeToLive(std::chrono::seconds ttl) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _timeToLive = ttl;
+}
+
+void PoDoFo::PdfValidationMaterialCache::setMaxEntries(size_t maxEntries) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _maxEntries = maxEntries == 0 ? 1 : maxEntries;
+    while (_entries.size() > _maxEntries) {
+        makeRoom(std::chrono::system_clock::now());
+    }
+}
+
+void PoDoFo::PdfValidationMaterialCache::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.clear();
+}
+
+size_t PoDoFo::PdfValidationMaterialCache::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+void PoDoFo::PdfValidationMaterialCache::makeRoom(const std::chrono::system_clock::time_point& now) {
+    for (auto it = _entries.begin(); it != _entries.end(); ) {
+        if (it->second->expiration <= now) {
+            it = _entries.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    if (_entries.size() < _maxEntries || _entries.empty()) {
+        return;
+    }
+
+    // Evict the entry which would expire first
+    auto first = _entries.begin();
+    for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+        if (it->second->expiration < first->second->expiration) {
+            first = it;
+        }
+    }
+
+    _entries.erase(first);
+}
+
+std::shared_ptr<PoDoFo::PdfValidationMaterial> PoDoFo::PdfValidationMaterialCache::parse(
+    ValidationMaterialType type, const bufferview& der, std::string&& sha256,
+    const std::chrono::system_clock::time_point& expiration) {
+    auto now = std::chrono::system_clock::now();
+    auto material = std::make_shared<PdfValidationMaterial>();
+    material->type = type;
+    material->sha256 = std::move(sha256);
+    material->expiration = expiration;
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(der.data());
+    switch (type) {
+    case ValidationMaterialType::Certificate: {
+        std::shared_ptr<X509> cert(d2i_X509(nullptr, &p, static_cast<long>(der.size())), X509_free);
+        if (cert == nullptr) {
+            return nullptr;
+        }
+
+        // Populate the extension cache now, so that the
+        // certificate is only read when shared between threads
+        (void)X509_check_purpose(cert.get(), -1, 0);
+        extractUrls(cert.get(), *material);
+        clampExpiration(X509_get0_notAfter(cert.get()), now, material->expiration);
+        material->certificate = std::move(cert);
+        break;
+    }
+    case ValidationMaterialType::Crl: {
+        std::unique_ptr<X509_CRL, decltype(&X509_CRL_free)> crl(
+            d2i_X509_CRL(nullptr, &p, static_cast<long>(der.size())), X509_CRL_free);
+        if (crl == nullptr) {
+            return nullptr;
+        }
+
+        clampExpiration(X509_CRL_get0_nextUpdate(crl.get()), now, material->expiration);
+        break;
+    }
+    case ValidationMaterialType::Ocsp: {
+        std::unique_ptr<OCSP_RESPONSE, decltype(&OCSP_RESPONSE_free)> response(
+            d2i_OCSP_RESPONSE(nullptr, &p, static_cast<long>(der.size())), OCSP_RESPONSE_free);
+        if (response == nullptr) {
+            return nullptr;
+        }
+
+        std::unique_ptr<OCSP_BASICRESP, decltype(&OCSP_BASICRESP_free)> basic(
+            OCSP_response_get1_basic(response.get()), OCSP_BASICRESP_free);
+        if (basic) {
+            for (int i = 0; i < OCSP_resp_count(basic.get()); ++i) {
+                int reason;
+                ASN1_GENERALIZEDTIME* revocationTime;
+                ASN1_GENERALIZEDTIME* thisUpdate;
+                ASN1_GENERALIZEDTIME* nextUpdate = nullptr;
+                (void)OCSP_single_get0_status(OCSP_resp_get0(basic.get(), i), &reason,
+                    &revocationTime, &thisUpdate, &nextUpdate);
+                clampExpiration(nextUpdate, now, material->expiration);
+            }
+        }
+        break;
+    }
+    default:
+        return nullptr;
+    }
+
+    material->der.assign(der.data(), der.size());
+    PdfFilterFactory::Create(PdfFilterType::FlateDecode)->EncodeTo(material->flateDer, der);
+    return material;
+}
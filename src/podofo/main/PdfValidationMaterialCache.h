@@ -0,0 +1,134 @@
+// PdfValidationMaterialCache.h
+/**
+ * @file PdfValidationMaterialCache.h
+ * @brief Process-wide cache of parsed certificates, CRLs and OCSP responses embedded into DSS.
+ *
+ * This header declares the `PdfValidationMaterialCache` which keeps validation material shared
+ * by many signed documents (CA chains, CRLs, OCSP responses) parsed and ready to be embedded,
+ * so each artifact is decoded, parsed and compressed once instead of once per document.
+ */
+#ifndef PDF_VALIDATION_MATERIAL_CACHE_H
+#define PDF_VALIDATION_MATERIAL_CACHE_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <openssl/x509.h>
+
+#include "PdfDeclarations.h"
+
+namespace PoDoFo {
+
+    /**
+     * @brief Kind of validation material embedded into the DSS.
+     */
+    enum class ValidationMaterialType {
+        Certificate, /**< DER-encoded X.509 certificate */
+        Crl,         /**< DER-encoded X.509 CRL */
+        Ocsp         /**< DER-encoded OCSPResponse */
+    };
+
+    /**
+     * @brief A parsed validation artifact. Immutable once returned by the cache.
+     */
+    struct PdfValidationMaterial {
+        ValidationMaterialType     type;          /**< Kind of the artifact */
+        std::string                sha256;        /**< SHA-256 of the DER, the cache key */
+        charbuff                   der;           /**< The DER encoding of the artifact */
+        charbuff                   flateDer;      /**< The DER encoded with FlateDecode, ready to be used as DSS stream data */
+        std::shared_ptr<X509>      certificate;   /**< The parsed certificate, only for ValidationMaterialType::Certificate */
+        std::vector<std::string>   crlUrls;       /**< CRL distribution point URLs of a certificate */
+        std::vector<std::string>   ocspUrls;      /**< AIA OCSP responder URLs of a certificate */
+        std::vector<std::string>   caIssuerUrls;  /**< AIA CA issuers URLs of a certificate */
+        std::chrono::system_clock::time_point expiration; /**< After this time the entry is parsed again */
+    };
+
+    /**
+     * @brief Process-wide, thread-safe cache of validation material keyed by the SHA-256 of the DER.
+     *
+     * Entries expire after a default time to live, or earlier at the certificate notAfter,
+     * the CRL nextUpdate or the earliest OCSP nextUpdate. Material which is already stale
+     * is returned but not cached.
+     */
+    class PODOFO_API PdfValidationMaterialCache final {
+    public:
+        /**
+         * @brief Gets the process-wide cache instance
+         */
+        static PdfValidationMaterialCache& instance();
+
+        /**
+         * @brief Copy constructor (deleted)
+         */
+        PdfValidationMaterialCache(const PdfValidationMaterialCache&) = delete;
+        /**
+         * @brief Copy assignment operator (deleted)
+         */
+        PdfValidationMaterialCache& operator=(const PdfValidationMaterialCache&) = delete;
+
+        /**
+         * @brief Gets the parsed material for a DER blob, parsing it if not cached
+         * @param type The kind of the artifact
+         * @param der The DER encoding of the artifact
+         * @return The parsed material
+         * @throws std::runtime_error if the DER cannot be parsed as the given type
+         */
+        std::shared_ptr<const PdfValidationMaterial> get(ValidationMaterialType type, const bufferview& der);
+
+        /**
+         * @brief Gets the parsed material for a DER blob, parsing it if not cached
+         * @param type The kind of the artifact
+         * @param der The DER encoding of the artifact
+         * @return The parsed material, or nullptr if the DER cannot be parsed as the given type
+         */
+        std::shared_ptr<const PdfValidationMaterial> tryGet(ValidationMaterialType type, const bufferview& der);
+
+        /**
+         * @brief Sets the maximum time an entry is kept (default one hour)
+         * @param ttl The time to live of new entries
+         */
+        void setTimeToLive(std::chrono::seconds ttl);
+
+        /**
+         * @brief Sets the maximum number of cached entries (default 4096)
+         * @param maxEntries The maximum number of entries
+         */
+        void setMaxEntries(size_t maxEntries);
+
+        /**
+         * @brief Removes all the entries
+         */
+        void clear();
+
+        /** @return Number of cached entries, including expired ones not yet purged */
+        size_t size() const;
+
+    private:
+        PdfValidationMaterialCache();
+
+        /**
+         * @brief Parses a DER blob into a new entry
+         * @return The entry, or nullptr if the DER cannot be parsed as the given type
+         */
+        static std::shared_ptr<PdfValidationMaterial> parse(ValidationMaterialType type,
+            const bufferview& der, std::string&& sha256,
+            const std::chrono::system_clock::time_point& expiration);
+        /**
+         * @brief Makes room for a new entry. Must be called with the lock held
+         * @param now Current time
+         */
+        void makeRoom(const std::chrono::system_clock::time_point& now);
+
+        mutable std::mutex                                                             _mutex;
+        std::unordered_map<std::string, std::shared_ptr<const PdfValidationMaterial>> _entries;
+        std::chrono::seconds                                                           _timeToLive;
+        size_t                                                                         _maxEntries;
+    };
+
+} // namespace PoDoFo
+
+#endif // PDF_VALIDATION_MATERIAL_CACHE_H
@@ -112,5 +112,8 @@
 #include "main/PdfXObjectPostScript.h"
 #include "main/HelloWorld.h"
 #include "main/PdfRemoteSignDocumentSession.h"
+#include "main/PdfRemoteSignBatchSession.h"
+#include "main/PdfRemoteSignPipeline.h"
+#include "main/PdfValidationMaterialCache.h"
 
 #endif // PODOFO_H
@@ -150,6 +150,55 @@ void CmsContext::AddAttribute(const string_view& nid, const bufferview& attr, bo
 }
 
 
+void CmsContext::SaveState(charbuff& state) const
+{
+    if (m_status != CmsContextStatus::ComputedHash)
+    {
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic,
+            "The state can be saved only after the hash to sign has been computed");
+    }
+
+    // The signed attributes are final at this point, and the
+    // structure is complete but for the signature value
+    unsigned char* buf = nullptr;
+    int len = i2d_CMS_ContentInfo(m_cms, &buf);
+    if (len < 0)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::OpenSSLError, "i2d_CMS_ContentInfo");
+
+    state.assign((const char*)buf, (const char*)buf + len);
+    OPENSSL_free(buf);
+}
+
+void CmsContext::RestoreState(const bufferview& state)
+{
+    if (m_status != CmsContextStatus::Initialized)
+    {
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic,
+            "The state can be restored only on a newly initialized context");
+    }
+
+    auto in = (const unsigned char*)state.data();
+    auto cms = d2i_CMS_ContentInfo(nullptr, &in, (long)state.size());
+    if (cms == nullptr)
+    {
+        string err("CMS state loading failed. Internal OpenSSL error:\n");
+        ssl::GetOpenSSLError(err);
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::OpenSSLError, err);
+    }
+
+    auto signers = CMS_get0_SignerInfos(cms);
+    if (signers == nullptr || sk_CMS_SignerInfo_num(signers) != 1)
+    {
+        CMS_ContentInfo_free(cms);
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidDataType, "The CMS state must have exactly one signer");
+    }
+
+    CMS_ContentInfo_free(m_cms);
+    m_cms = cms;
+    m_signer = sk_CMS_SignerInfo_value(signers, 0);
+    m_status = CmsContextStatus::ComputedHash;
+}
+
 void CmsContext::loadX509Certificate(const bufferview& cert)
 {
     auto in = (const unsigned char*)cert.data();
@@ -50,6 +50,8 @@ namespace PoDoFo
         void ComputeHashToSign(charbuff& hashToSign);
         void ComputeSignature(const bufferview& signedHash, charbuff& signature);
         void AddAttribute(const std::string_view& nid, const bufferview& attr, bool signedAttr, bool octetString);
+        void SaveState(charbuff& state) const;
+        void RestoreState(const bufferview& state);
     private:
         void loadX509Certificate(const bufferview& cert);
         void loadX509Chain(const std::vector<charbuff>& chain);
@@ -0,0 +1,78 @@
+/**
+ * SPDX-FileCopyrightText: (C) 2010 Dominik Seichter <domseichter@web.de>
+ * SPDX-FileCopyrightText: (C) 2020 Francesco Pretto <ceztko@gmail.com>
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include <podofo/private/PdfDeclarationsPrivate.h>
+#include "PdfCompressedParserObject.h"
+
+#include <podofo/main/PdfDocument.h>
+
+using namespace std;
+using namespace PoDoFo;
+
+PdfCompressedParserObject::PdfCompressedParserObject(const PdfReference& reference, uint32_t streamObjNo,
+        unsigned index, const shared_ptr<PdfObjectStreamCache>& cache) :
+    PdfObject(nullptr),
+    m_cache(cache),
+    m_StreamObjectNumber(streamObjNo),
+    m_Index(index),
+    m_IsRevised(false)
+{
+    if (cache == nullptr)
+        PODOFO_RAISE_ERROR(PdfErrorCode::InvalidHandle);
+
+    SetIndirectReference(reference);
+    EnableDelayedLoading();
+}
+
+void PdfCompressedParserObject::delayedLoad()
+{
+    // NOTE: Be careful to not trigger recursive delayed
+    // loading of this object, only the containing stream
+    // is accessed here
+    auto document = GetDocument();
+    PODOFO_ASSERT(document != nullptr);
+    // The generation number of an object stream and of any
+    // compressed object is implicitly zero
+    auto streamObj = document->GetObjects().GetObject(PdfReference(m_StreamObjectNumber, 0));
+    auto& reference = GetIndirectReference();
+    if (streamObj == nullptr)
+    {
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidObject, "Object stream {} 0 R for object {} {} R is missing",
+            m_StreamObjectNumber, reference.ObjectNumber(), reference.GenerationNumber());
+    }
+
+    try
+    {
+        if (!m_cache->TryReadObject(*streamObj, reference.ObjectNumber(), m_Index, m_Variant))
+        {
+            // References to missing objects are treated as null
+            PoDoFo::LogMessage(PdfLogSeverity::Warning, "Object {} {} R not found in object stream {} 0 R",
+                reference.ObjectNumber(), reference.GenerationNumber(), m_StreamObjectNumber);
+            m_Variant = PdfVariant();
+        }
+    }
+    catch (PdfError& e)
+    {
+        PODOFO_PUSH_FRAME_INFO(e, "Unable to load object {} {} R from object stream {} 0 R",
+            reference.ObjectNumber(), reference.GenerationNumber(), m_StreamObjectNumber);
+        throw;
+    }
+}
+
+void PdfCompressedParserObject::SetRevised()
+{
+    m_IsRevised = true;
+}
+
+bool PdfCompressedParserObject::TryUnload()
+{
+    if (!IsDelayedLoadDone() || m_IsRevised)
+        return false;
+
+    m_Variant = PdfVariant();
+    EnableDelayedLoading();
+    return true;
+}
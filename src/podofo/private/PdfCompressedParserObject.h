@@ -0,0 +1,57 @@
+/**
+ * SPDX-FileCopyrightText: (C) 2010 Dominik Seichter <domseichter@web.de>
+ * SPDX-FileCopyrightText: (C) 2020 Francesco Pretto <ceztko@gmail.com>
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#ifndef PDF_COMPRESSED_PARSER_OBJECT_H
+#define PDF_COMPRESSED_PARSER_OBJECT_H
+
+#include <podofo/main/PdfObject.h>
+
+#include "PdfObjectStreamParser.h"
+
+namespace PoDoFo {
+
+/**
+ * A PdfObject stored in an object stream (PDF Reference 1.7 3.4.6 Object Streams)
+ * that is loaded on demand. The containing object stream is decoded
+ * only when the object is first accessed and it's kept in a cache
+ * shared by all the compressed objects of the document
+ */
+class PdfCompressedParserObject final : public PdfObject
+{
+    friend class PdfParser;
+
+private:
+    /**
+     * \param reference the reference of the object
+     * \param streamObjNo the object number of the containing object stream
+     * \param index the index of the object in the stream, as found in the XRef
+     * \param cache the cache of the decoded object streams
+     */
+    PdfCompressedParserObject(const PdfReference& reference, uint32_t streamObjNo,
+        unsigned index, const std::shared_ptr<PdfObjectStreamCache>& cache);
+
+public:
+    bool TryUnload() override;
+
+protected:
+    void delayedLoad() override;
+
+    void SetRevised() override;
+
+private:
+    PdfCompressedParserObject(const PdfCompressedParserObject&) = delete;
+    PdfCompressedParserObject& operator=(const PdfCompressedParserObject&) = delete;
+
+private:
+    std::shared_ptr<PdfObjectStreamCache> m_cache;
+    uint32_t m_StreamObjectNumber;
+    unsigned m_Index;
+    bool m_IsRevised;
+};
+
+};
+
+#endif // PDF_COMPRESSED_PARSER_OBJECT_H
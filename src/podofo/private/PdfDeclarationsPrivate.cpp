@@ -47,6 +47,34 @@ static double modulo(double a, double b);
 // Picked as the minimum size for small string optimizations withing GCC, MSVC, Clang
 constexpr unsigned FloatFormatDefaultSize = 15;
 
+static constexpr char s_base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static constexpr char s_base64UrlChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Values above 63 in the base64 decoding table
+constexpr unsigned char Base64Invalid = 0xFF;
+constexpr unsigned char Base64Padding = 0xFE;
+constexpr unsigned char Base64Space = 0xFD;
+
+// Decoding table accepting both the standard and the "base64url" alphabets
+static constexpr array<unsigned char, 256> s_base64Values = []() {
+    array<unsigned char, 256> ret{ };
+    for (unsigned i = 0; i < 256; i++)
+        ret[i] = Base64Invalid;
+
+    for (unsigned char i = 0; i < 64; i++)
+    {
+        ret[(unsigned char)s_base64Chars[i]] = i;
+        ret[(unsigned char)s_base64UrlChars[i]] = i;
+    }
+
+    ret[(unsigned char)'='] = Base64Padding;
+    ret[(unsigned char)' '] = Base64Space;
+    ret[(unsigned char)'\t'] = Base64Space;
+    ret[(unsigned char)'\r'] = Base64Space;
+    ret[(unsigned char)'\n'] = Base64Space;
+    return ret;
+}();
+
 struct VersionIdentity
 {
     PdfName Name;
@@ -1165,15 +1193,175 @@ void utls::WriteCharHexTo(char buf[2], char ch)
     buf[1] += (buf[1] > 9 ? 'A' - 10 : '0');
 }
 
-string utls::GetCharHexString(const bufferview& buff)
+string utls::GetCharHexString(const bufferview& buff, bool lowercase)
 {
     string ret(buff.size() * 2, '\0');
     for (unsigned i = 0; i < buff.size(); i++)
         utls::WriteCharHexTo(ret.data() + i * 2, buff[i]);
 
+    if (lowercase)
+    {
+        for (auto& ch : ret)
+        {
+            if (ch >= 'A')
+                ch += 'a' - 'A';
+        }
+    }
+
     return ret;
 }
 
+bool utls::TryDecodeHex(const string_view& str, const bufferspan& dst, size_t& written)
+{
+    written = 0;
+    if (str.size() % 2 != 0 || dst.size() < str.size() / 2)
+        return false;
+
+    unsigned char high;
+    unsigned char low;
+    for (size_t i = 0; i < str.size(); i += 2)
+    {
+        if (!TryGetHexValue(str[i], high) || !TryGetHexValue(str[i + 1], low))
+            return false;
+
+        dst[written] = (char)((high << 4) | low);
+        written++;
+    }
+
+    return true;
+}
+
+size_t utls::GetBase64EncodedLength(size_t length)
+{
+    return (length + 2) / 3 * 4;
+}
+
+size_t utls::GetBase64DecodedMaxLength(size_t length)
+{
+    return (length + 3) / 4 * 3;
+}
+
+size_t utls::WriteBase64To(const bufferspan& dst, const bufferview& buff, bool urlAlphabet)
+{
+    PODOFO_ASSERT(dst.size() >= GetBase64EncodedLength(buff.size()));
+    const char* alphabet = urlAlphabet ? s_base64UrlChars : s_base64Chars;
+    auto src = (const unsigned char*)buff.data();
+    size_t length = buff.size();
+    char* out = dst.data();
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3)
+    {
+        uint32_t value = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 | src[i + 2];
+        out[0] = alphabet[value >> 18];
+        out[1] = alphabet[(value >> 12) & 0x3F];
+        out[2] = alphabet[(value >> 6) & 0x3F];
+        out[3] = alphabet[value & 0x3F];
+        out += 4;
+    }
+
+    switch (length - i)
+    {
+        case 1:
+        {
+            uint32_t value = (uint32_t)src[i] << 16;
+            out[0] = alphabet[value >> 18];
+            out[1] = alphabet[(value >> 12) & 0x3F];
+            out[2] = '=';
+            out[3] = '=';
+            out += 4;
+            break;
+        }
+        case 2:
+        {
+            uint32_t value = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8;
+            out[0] = alphabet[value >> 18];
+            out[1] = alphabet[(value >> 12) & 0x3F];
+            out[2] = alphabet[(value >> 6) & 0x3F];
+            out[3] = '=';
+            out += 4;
+            break;
+        }
+        default:
+            break;
+    }
+
+    return (size_t)(out - dst.data());
+}
+
+void utls::WriteBase64To(string& str, const bufferview& buff, bool urlAlphabet)
+{
+    size_t offset = str.size();
+    str.resize(offset + GetBase64EncodedLength(buff.size()));
+    (void)WriteBase64To(bufferspan(str.data() + offset, str.size() - offset), buff, urlAlphabet);
+}
+
+bool utls::TryDecodeBase64(const string_view& str, const bufferspan& dst, size_t& written)
+{
+    written = 0;
+    uint32_t value = 0;
+    unsigned count = 0;
+    unsigned padding = 0;
+    for (char ch : str)
+    {
+        unsigned char code = s_base64Values[(unsigned char)ch];
+        if (code < 64)
+        {
+            // No data is allowed after the padding
+            if (padding != 0)
+                return false;
+
+            value = value << 6 | code;
+            count++;
+            if (count == 4)
+            {
+                if (dst.size() - written < 3)
+                    return false;
+
+                dst[written] = (char)(value >> 16);
+                dst[written + 1] = (char)(value >> 8);
+                dst[written + 2] = (char)value;
+                written += 3;
+                value = 0;
+                count = 0;
+            }
+        }
+        else if (code == Base64Padding)
+        {
+            padding++;
+        }
+        else if (code != Base64Space)
+        {
+            return false;
+        }
+    }
+
+    if (padding != 0 && count + padding != 4)
+        return false;
+
+    switch (count)
+    {
+        case 0:
+            return true;
+        case 2:
+            if (dst.size() - written < 1)
+                return false;
+
+            dst[written] = (char)(value >> 4);
+            written += 1;
+            return true;
+        case 3:
+            if (dst.size() - written < 2)
+                return false;
+
+            dst[written] = (char)(value >> 10);
+            dst[written + 1] = (char)(value >> 2);
+            written += 2;
+            return true;
+        default:
+            return false;
+    }
+}
+
 void utls::WriteUtf16BETo(u16string& str, char32_t codePoint)
 {
     str.clear();
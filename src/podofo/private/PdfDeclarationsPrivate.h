@@ -316,7 +316,39 @@ namespace utls
     // Write the char to the supplied buffer as hexadecimal code
     void WriteCharHexTo(char buf[2], char ch);
 
-    std::string GetCharHexString(const PoDoFo::bufferview& buff);
+    std::string GetCharHexString(const PoDoFo::bufferview& buff, bool lowercase = false);
+
+    /** Decode an hexadecimal string into the supplied buffer
+     * \param dst the output buffer, at least half the size of the input string
+     * \returns false if the string has an odd length, invalid digits or the buffer is too small
+     */
+    bool TryDecodeHex(const std::string_view& str, const PoDoFo::bufferspan& dst, size_t& written);
+
+    /** Get the length of the padded base64 encoding of a buffer with the given length
+     */
+    size_t GetBase64EncodedLength(size_t length);
+
+    /** Get the maximum length of the data decoded from a base64 string with the given length
+     */
+    size_t GetBase64DecodedMaxLength(size_t length);
+
+    /** Encode the buffer as padded base64 (RFC 4648) into the supplied buffer
+     * \param dst the output buffer, at least GetBase64EncodedLength() long
+     * \param urlAlphabet use the "base64url" alphabet, with '-' and '_' instead of '+' and '/'
+     * \returns the number of written chars
+     */
+    size_t WriteBase64To(const PoDoFo::bufferspan& dst, const PoDoFo::bufferview& buff, bool urlAlphabet = false);
+
+    /** Append the padded base64 (RFC 4648) encoding of the buffer to the string
+     */
+    void WriteBase64To(std::string& str, const PoDoFo::bufferview& buff, bool urlAlphabet = false);
+
+    /** Decode a base64 or base64url string into the supplied buffer
+     * Padding is optional and white spaces are skipped
+     * \param dst the output buffer, at least GetBase64DecodedMaxLength() long
+     * \returns false if the string is not valid base64 or the buffer is too small
+     */
+    bool TryDecodeBase64(const std::string_view& str, const PoDoFo::bufferspan& dst, size_t& written);
 
     // Append the unicode code point to a big endian encoded utf16 string
     void WriteUtf16BETo(std::u16string& str, char32_t codePoint);
@@ -25,6 +25,14 @@ PdfObjectStreamParser::PdfObjectStreamParser(PdfParserObject& parser,
 }
 
 void PdfObjectStreamParser::Parse(const cspan<int64_t>& objectList)
+{
+    vector<unique_ptr<PdfObject>> objects;
+    Parse(objectList, objects);
+    for (auto& obj : objects)
+        m_Objects->PushObject(obj.release());
+}
+
+void PdfObjectStreamParser::Parse(const cspan<int64_t>& objectList, vector<unique_ptr<PdfObject>>& objects)
 {
     int64_t num = m_Parser->GetDictionary().FindKeyAsSafe<int64_t>("N", 0);
     int64_t first = m_Parser->GetDictionary().FindKeyAsSafe<int64_t>("First", 0);
@@ -32,12 +40,12 @@ void PdfObjectStreamParser::Parse(const cspan<int64_t>& objectList)
     charbuff buffer;
     m_Parser->GetOrCreateStream().CopyTo(buffer);
 
-    this->readObjectsFromStream(buffer.data(), buffer.size(), num, first, objectList);
+    this->readObjectsFromStream(buffer.data(), buffer.size(), num, first, objectList, objects);
     m_Parser = nullptr;
 }
 
 void PdfObjectStreamParser::readObjectsFromStream(char* buffer, size_t bufferLen,
-    int64_t num, int64_t first, const cspan<int64_t>& objectList)
+    int64_t num, int64_t first, const cspan<int64_t>& objectList, vector<unique_ptr<PdfObject>>& objects)
 {
     SpanStreamDevice device(buffer, bufferLen);
     PdfTokenizer tokenizer(m_buffer);
@@ -76,7 +84,7 @@ void PdfObjectStreamParser::readObjectsFromStream(char* buffer, size_t bufferLen
             PdfReference reference(static_cast<uint32_t>(objNo), 0);
             auto obj = new PdfObject(std::move(var));
             obj->SetIndirectReference(reference);
-            m_Objects->PushObject(obj);
+            objects.push_back(unique_ptr<PdfObject>(obj));
         }
 
         // move back to the position inside of the table of contents
@@ -85,3 +93,84 @@ void PdfObjectStreamParser::readObjectsFromStream(char* buffer, size_t bufferLen
         i++;
     }
 }
+
+PdfObjectStreamCache::PdfObjectStreamCache(unsigned capacity)
+    : m_capacity(capacity == 0 ? 1 : capacity),
+    m_buffer(std::make_shared<charbuff>(PdfTokenizer::BufferSize))
+{
+}
+
+bool PdfObjectStreamCache::TryReadObject(const PdfObject& streamObj, uint32_t objNo, unsigned index, PdfVariant& variant)
+{
+    auto& entry = getEntry(streamObj);
+
+    // Use the index from the XRef as a hint, falling
+    // back to a linear search if it doesn't match
+    size_t offset;
+    if (index < entry.Objects.size() && entry.Objects[index].first == (int64_t)objNo)
+    {
+        offset = entry.Objects[index].second;
+    }
+    else
+    {
+        auto found = std::find_if(entry.Objects.begin(), entry.Objects.end(),
+            [objNo](const pair<int64_t, size_t>& obj) { return obj.first == (int64_t)objNo; });
+        if (found == entry.Objects.end())
+            return false;
+
+        offset = found->second;
+    }
+
+    SpanStreamDevice device(entry.Buffer);
+    device.Seek(offset);
+    PdfTokenizer tokenizer(m_buffer);
+    tokenizer.ReadNextVariant(device, variant); // NOTE: The stream is already decrypted
+    return true;
+}
+
+const PdfObjectStreamCache::Entry& PdfObjectStreamCache::getEntry(const PdfObject& streamObj)
+{
+    uint32_t streamObjNo = streamObj.GetIndirectReference().ObjectNumber();
+    for (auto it = m_entries.begin(); it != m_entries.end(); it++)
+    {
+        if (it->StreamObjectNumber == streamObjNo)
+        {
+            // Move the entry in front as the most recently used
+            m_entries.splice(m_entries.begin(), m_entries, it);
+            return m_entries.front();
+        }
+    }
+
+    Entry entry;
+    entry.StreamObjectNumber = streamObjNo;
+    int64_t num = streamObj.GetDictionary().FindKeyAsSafe<int64_t>("N", 0);
+    int64_t first = streamObj.GetDictionary().FindKeyAsSafe<int64_t>("First", 0);
+    auto stream = streamObj.GetStream();
+    if (stream == nullptr)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidStream, "Object stream {} 0 R has no stream", streamObjNo);
+
+    stream->CopyTo(entry.Buffer);
+
+    // Read the table of contents with the object numbers and offsets
+    SpanStreamDevice device(entry.Buffer);
+    PdfTokenizer tokenizer(m_buffer);
+    for (int64_t i = 0; i < num; i++)
+    {
+        int64_t objNo = tokenizer.ReadNextNumber(device);
+        int64_t offset = tokenizer.ReadNextNumber(device);
+        if (offset < 0 || first < 0 || first >= std::numeric_limits<int64_t>::max() - offset
+            || (uint64_t)(first + offset) > entry.Buffer.size())
+        {
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::BrokenFile,
+                "Object position out of max limit");
+        }
+
+        entry.Objects.push_back({ objNo, static_cast<size_t>(first + offset) });
+    }
+
+    if (m_entries.size() == m_capacity)
+        m_entries.pop_back();
+
+    m_entries.push_front(std::move(entry));
+    return m_entries.front();
+}
@@ -7,6 +7,8 @@
 #ifndef PDF_OBJECT_STREAM_PARSER_OBJECT_H
 #define PDF_OBJECT_STREAM_PARSER_OBJECT_H
 
+#include <list>
+
 #include "PdfParserObject.h"
 
 namespace PoDoFo {
@@ -36,8 +38,14 @@ public:
 
     void Parse(const cspan<int64_t>& objectList);
 
+    /** Read the objects without adding them to the object list
+     * \param objects the read objects
+     */
+    void Parse(const cspan<int64_t>& objectList, std::vector<std::unique_ptr<PdfObject>>& objects);
+
 private:
-    void readObjectsFromStream(char* buffer, size_t lBufferLen, int64_t lNum, int64_t lFirst, const cspan<int64_t>& list);
+    void readObjectsFromStream(char* buffer, size_t lBufferLen, int64_t lNum, int64_t lFirst, const cspan<int64_t>& list,
+        std::vector<std::unique_ptr<PdfObject>>& objects);
 
 private:
     PdfParserObject* m_Parser;
@@ -45,6 +53,45 @@ private:
     std::shared_ptr<charbuff> m_buffer;
 };
 
+/**
+ * A small cache of decoded object streams, used to load
+ * compressed objects on demand. The least recently used
+ * stream is evicted when the capacity is exceeded
+ */
+class PdfObjectStreamCache final
+{
+public:
+    static constexpr unsigned DefaultCapacity = 8;
+
+public:
+    PdfObjectStreamCache(unsigned capacity = DefaultCapacity);
+
+    /** Read a compressed object from its object stream
+     * \param streamObj the object stream containing the object
+     * \param objNo the number of the object to read
+     * \param index the index of the object in the stream, as found in the XRef
+     * \param variant the read object value
+     * \returns false if the object stream doesn't contain the object
+     */
+    bool TryReadObject(const PdfObject& streamObj, uint32_t objNo, unsigned index, PdfVariant& variant);
+
+private:
+    struct Entry
+    {
+        uint32_t StreamObjectNumber;
+        charbuff Buffer;
+        // Object numbers and offsets in the decoded buffer
+        std::vector<std::pair<int64_t, size_t>> Objects;
+    };
+
+    const Entry& getEntry(const PdfObject& streamObj);
+
+private:
+    std::list<Entry> m_entries;
+    unsigned m_capacity;
+    std::shared_ptr<charbuff> m_buffer;
+};
+
 };
 
 #endif // PDF_OBJECT_STREAM_PARSER_OBJECT_H
@@ -8,23 +8,40 @@
 #include "PdfParser.h"
 
 #include <algorithm>
+#include <atomic>
+#include <thread>
 #include <numerics/checked_math.h>
 
 #include <podofo/auxiliary/OutputDevice.h>
 #include <podofo/auxiliary/InputDevice.h>
+#include <podofo/auxiliary/StreamDevice.h>
 
 #include <podofo/main/PdfArray.h>
+#include <podofo/main/PdfCommon.h>
 #include <podofo/main/PdfDictionary.h>
 #include <podofo/main/PdfEncrypt.h>
 #include <podofo/main/PdfMemoryObjectStream.h>
 #include "PdfXRefStreamParserObject.h"
 #include "PdfObjectStreamParser.h"
+#include "PdfCompressedParserObject.h"
+#include "OpenSSLInternal.h"
 
 constexpr unsigned PDF_VERSION_LENGHT = 3;
 constexpr unsigned PDF_MAGIC_LENGHT = 8;
 constexpr unsigned PDF_XREF_ENTRY_SIZE = 20;
 constexpr unsigned PDF_XREF_BUF = 512;
 constexpr unsigned MAX_XREF_SESSION_COUNT = 512;
+// Below this count objects are always parsed serially
+constexpr unsigned ParallelLoadMinObjectCount = 256;
+// Number of consecutive objects processed by a thread at once
+constexpr size_t ParallelLoadBatchSize = 64;
+// Binary index written by PdfParser::WriteIndex(). Integers are big endian
+constexpr std::string_view IndexMagic = "PDFXRIDX";
+constexpr uint32_t IndexVersion = 1;
+constexpr size_t IndexEntrySize = 14;
+// Length of the file tail hashed by the index guard. It
+// normally includes the last xref section and trailer
+constexpr size_t IndexGuardHashLength = 65536;
 
 using namespace std;
 using namespace PoDoFo;
@@ -33,12 +50,23 @@ using namespace chromium::base;
 static bool CheckEOL(char e1, char e2);
 static bool CheckXRefEntryType(char c);
 static bool ReadMagicWord(char ch, unsigned& cursoridx);
+static void parallelFor(unsigned threadCount, const bufferview& view, size_t count,
+    const function<void(InputStreamDevice&, size_t)>& task);
+static bool tryReadObjectHeader(const string_view& contents, size_t objPos,
+    uint32_t& objectNum, uint16_t& generation, size_t& offset);
+static string_view getObjectType(string_view dict);
+static bool isKeywordAt(const string_view& contents, size_t pos, size_t length);
+static charbuff computeIndexGuardHash(InputStreamDevice& device, size_t fileSize);
+static void writeUInt64BE(OutputStream& output, uint64_t value);
+static void readUInt64BE(InputStream& input, uint64_t& value);
 
 PdfParser::PdfParser(PdfIndirectObjectList& objects) :
     m_buffer(std::make_shared<charbuff>(PdfTokenizer::BufferSize)),
     m_tokenizer(m_buffer),
     m_Objects(&objects),
-    m_StrictParsing(false)
+    m_indexModificationTime(0),
+    m_StrictParsing(false),
+    m_ParallelLoad(false)
 {
     this->reset();
 }
@@ -50,11 +78,14 @@ void PdfParser::reset()
 
     m_magicOffset = 0;
     m_HasXRefStream = false;
+    m_XRefRebuilt = false;
+    m_IndexUsed = false;
     m_XRefOffset = 0;
     m_lastEOFOffset = 0;
 
     m_Trailer = nullptr;
     m_entries.Clear();
+    m_rebuiltObjectStreams.clear();
 
     m_Encrypt = nullptr;
 
@@ -73,7 +104,42 @@ void PdfParser::Parse(InputStreamDevice& device, bool loadOnDemand)
         if (!IsPdfFile(device))
             PODOFO_RAISE_ERROR(PdfErrorCode::InvalidPDF);
 
-        ReadDocumentStructure(device);
+        try
+        {
+            if (!tryReadIndex(device))
+                ReadDocumentStructure(device);
+        }
+        catch (PdfError& e)
+        {
+            if (m_StrictParsing)
+                throw;
+
+            PoDoFo::LogMessage(PdfLogSeverity::Warning,
+                "Unable to read the document structure ({}), rebuilding the xref table",
+                PdfError::ErrorName(e.GetCode()));
+            bool rebuilt = false;
+            try
+            {
+                rebuildXRefTable(device);
+                ReadObjects(device);
+                rebuilt = true;
+            }
+            catch (PdfError& rebuildError)
+            {
+                if (rebuildError.GetCode() == PdfErrorCode::InvalidPassword)
+                    throw;
+
+                // Report the original error if the file can't be recovered
+                PoDoFo::LogMessage(PdfLogSeverity::Warning, "Unable to rebuild the xref table ({})",
+                    PdfError::ErrorName(rebuildError.GetCode()));
+            }
+
+            if (!rebuilt)
+                throw;
+
+            return;
+        }
+
         ReadObjects(device);
     }
     catch (PdfError& e)
@@ -572,6 +638,372 @@ void PdfParser::ReadXRefStreamContents(InputStreamDevice& device, size_t offset,
     }
 }
 
+void PdfParser::rebuildXRefTable(InputStreamDevice& device)
+{
+    m_entries.Clear();
+    m_rebuiltObjectStreams.clear();
+    m_visitedXRefOffsets.clear();
+    m_Trailer = nullptr;
+    m_HasXRefStream = false;
+    m_XRefOffset = 0;
+    m_IncrementalUpdateCount = 0;
+    m_XRefRebuilt = true;
+
+    // Scan the source buffer directly, if available, otherwise
+    // read the whole file in memory
+    charbuff buffer;
+    bufferview view;
+    if (!device.TryGetBufferView(view))
+    {
+        device.Seek(0, SeekDirection::End);
+        buffer.resize(device.GetPosition());
+        device.Seek(0);
+        device.Read(buffer.data(), buffer.size());
+        view = buffer;
+    }
+    m_FileSize = view.size();
+
+    // Trailer dictionaries, that are either found after a
+    // "trailer" keyword or are xref streams dictionaries
+    struct TrailerLocation
+    {
+        size_t Offset;
+        PdfReference XRefStreamReference;
+    };
+
+    string_view contents(view.data(), view.size());
+    vector<TrailerLocation> trailers;
+    PdfReference catalogRef;
+    uint32_t maxObjectCount = (uint32_t)PdfCommon::GetMaxObjectCount();
+
+    // Sweep the file once, in order, looking for both "obj" and "trailer"
+    // keywords. Later definitions of the same object override the previous
+    // ones, as it happens with incremental updates
+    size_t objPos = contents.find("obj");
+    size_t trailerPos = contents.find("trailer");
+    while (objPos != string_view::npos || trailerPos != string_view::npos)
+    {
+        if (trailerPos < objPos)
+        {
+            if (isKeywordAt(contents, trailerPos, 7))
+                trailers.push_back({ trailerPos + 7, PdfReference() });
+
+            trailerPos = contents.find("trailer", trailerPos + 7);
+            continue;
+        }
+
+        uint32_t objectNum;
+        uint16_t generation;
+        size_t offset;
+        if (isKeywordAt(contents, objPos, 3)
+            && tryReadObjectHeader(contents, objPos, objectNum, generation, offset)
+            && objectNum != 0 && objectNum < maxObjectCount)
+        {
+            m_entries.Enlarge(objectNum + 1);
+            auto& entry = m_entries[objectNum];
+            entry = PdfXRefEntry::CreateInUse(offset, generation);
+            entry.Parsed = true;
+
+            auto type = getObjectType(contents.substr(objPos + 3));
+            if (type == "ObjStm")
+            {
+                m_rebuiltObjectStreams.push_back({ objectNum, offset });
+            }
+            else if (type == "XRef")
+            {
+                trailers.push_back({ offset, PdfReference(objectNum, generation) });
+                m_HasXRefStream = true;
+            }
+            else if (type == "Catalog")
+            {
+                catalogRef = PdfReference(objectNum, generation);
+            }
+        }
+
+        objPos = contents.find("obj", objPos + 3);
+    }
+
+    if (m_entries.GetSize() == 0)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidXRef, "No objects found while rebuilding the xref table");
+
+    m_entries[0] = PdfXRefEntry::CreateFree(0, 65535);
+    m_entries[0].Parsed = true;
+
+    // The last trailer is the main one, previous ones
+    // just supply keys that are missing
+    for (auto it = trailers.rbegin(); it != trailers.rend(); it++)
+    {
+        unique_ptr<PdfParserObject> trailer;
+        try
+        {
+            if (it->XRefStreamReference.IsIndirect())
+            {
+                trailer.reset(new PdfParserObject(m_Objects->GetDocument(), it->XRefStreamReference, device, (ssize_t)it->Offset));
+            }
+            else
+            {
+                trailer.reset(new PdfParserObject(m_Objects->GetDocument(), device, (ssize_t)it->Offset));
+                trailer->SetIsTrailer(true);
+            }
+
+            trailer->Parse();
+        }
+        catch (PdfError&)
+        {
+            PoDoFo::LogMessage(PdfLogSeverity::Warning, "Skipping invalid trailer at offset {}", it->Offset);
+            continue;
+        }
+
+        if (!trailer->IsDictionary())
+            continue;
+
+        if (m_Trailer == nullptr)
+            m_Trailer = std::move(trailer);
+        else
+            mergeTrailer(*trailer);
+    }
+
+    if (m_Trailer == nullptr)
+    {
+        m_Trailer.reset(new PdfObject());
+        m_Trailer->SetDocument(&m_Objects->GetDocument());
+    }
+
+    // NOTE: The catalog may be also found later in an object stream
+    auto& trailerDict = m_Trailer->GetDictionary();
+    if (!trailerDict.HasKey("Root") && catalogRef.IsIndirect())
+        trailerDict.AddKey("Root"_n, catalogRef);
+
+    trailerDict.AddKey("Size"_n, static_cast<int64_t>(m_entries.GetSize()));
+}
+
+void PdfParser::readRebuiltObjectStreams(InputStreamDevice& device)
+{
+    uint32_t maxObjectCount = (uint32_t)PdfCommon::GetMaxObjectCount();
+    auto& trailerDict = m_Trailer->GetDictionary();
+    PdfReference catalogRef;
+
+    // Read the streams from the last one, so objects
+    // of later incremental updates take precedence
+    for (auto it = m_rebuiltObjectStreams.rbegin(); it != m_rebuiltObjectStreams.rend(); it++)
+    {
+        uint32_t streamObjNo = it->first;
+        auto& streamEntry = m_entries[streamObjNo];
+        if (streamEntry.Offset != it->second)
+            continue;   // The object stream was redefined later
+
+        try
+        {
+            PdfParserObject streamObj(m_Objects->GetDocument(),
+                PdfReference(streamObjNo, (uint16_t)streamEntry.Generation), device, (ssize_t)it->second);
+            streamObj.SetEncrypt(m_Encrypt);
+            streamObj.Parse();
+
+            // Objects are not available yet: resolve
+            // an indirect /Length from the entries
+            auto& dict = streamObj.GetDictionary();
+            auto lengthObj = dict.GetKey("Length");
+            PdfReference lengthRef;
+            if (lengthObj != nullptr && lengthObj->TryGetReference(lengthRef))
+            {
+                if (lengthRef.ObjectNumber() >= m_entries.GetSize()
+                    || m_entries[lengthRef.ObjectNumber()].Type != PdfXRefEntryType::InUse)
+                {
+                    PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidStream, "Invalid stream length reference");
+                }
+
+                PdfParserObject length(device, lengthRef, (ssize_t)m_entries[lengthRef.ObjectNumber()].Offset);
+                length.Parse();
+                dict.AddKey("Length"_n, length.GetNumber());
+            }
+
+            int64_t objectCount = dict.FindKeyAsSafe<int64_t>("N", 0);
+            int64_t first = dict.FindKeyAsSafe<int64_t>("First", 0);
+            auto data = streamObj.MustGetStream().GetCopy();
+            SpanStreamDevice dataDevice(data);
+            PdfTokenizer tokenizer;
+            vector<pair<int64_t, int64_t>> objects;
+            for (int64_t i = 0; i < objectCount; i++)
+            {
+                int64_t objectNum = tokenizer.ReadNextNumber(dataDevice);
+                int64_t offset = tokenizer.ReadNextNumber(dataDevice);
+                objects.push_back({ objectNum, offset });
+            }
+
+            string_view contents(data.data(), data.size());
+            for (unsigned i = 0; i < objects.size(); i++)
+            {
+                int64_t objectNum = objects[i].first;
+                if (objectNum <= 0 || objectNum >= maxObjectCount)
+                    continue;
+
+                m_entries.Enlarge((unsigned)objectNum + 1);
+                auto& entry = m_entries[(unsigned)objectNum];
+                if (entry.Parsed)
+                    continue;
+
+                entry = PdfXRefEntry::CreateCompressed(streamObjNo, i);
+                entry.Parsed = true;
+
+                // Look for the catalog in the object contents, that end where the next object begins
+                size_t start = (size_t)(first + objects[i].second);
+                size_t end = i + 1 < objects.size() ? (size_t)(first + objects[i + 1].second) : contents.size();
+                if (!catalogRef.IsIndirect() && start < end && end <= contents.size()
+                    && getObjectType(contents.substr(start, end - start)) == "Catalog")
+                {
+                    catalogRef = PdfReference((uint32_t)objectNum, 0);
+                }
+            }
+        }
+        catch (PdfError&)
+        {
+            PoDoFo::LogMessage(PdfLogSeverity::Warning,
+                "Unable to read object stream {} {} R while rebuilding the xref table",
+                streamObjNo, streamEntry.Generation);
+        }
+    }
+
+    if (!trailerDict.HasKey("Root"))
+    {
+        if (!catalogRef.IsIndirect())
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidTrailer, "No catalog found while rebuilding the xref table");
+
+        trailerDict.AddKey("Root"_n, catalogRef);
+    }
+
+    trailerDict.AddKey("Size"_n, static_cast<int64_t>(m_entries.GetSize()));
+}
+
+void PdfParser::SetIndex(const bufferview& index, int64_t modificationTime)
+{
+    m_index = charbuff(index);
+    m_indexModificationTime = modificationTime;
+}
+
+void PdfParser::WriteIndex(InputStreamDevice& device, OutputStream& output, int64_t modificationTime) const
+{
+    if (m_Trailer == nullptr)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "The document must be parsed and the trailer must be available");
+
+    output.Write(IndexMagic);
+    utls::WriteUInt32BE(output, IndexVersion);
+
+    // Guard
+    writeUInt64BE(output, m_FileSize);
+    writeUInt64BE(output, (uint64_t)modificationTime);
+    output.Write(computeIndexGuardHash(device, m_FileSize));
+
+    writeUInt64BE(output, m_XRefOffset);
+    writeUInt64BE(output, m_lastEOFOffset);
+    utls::WriteUInt32BE(output, (uint32_t)m_IncrementalUpdateCount);
+    output.Write((char)((m_HasXRefStream ? 1 : 0) | (m_XRefRebuilt ? 2 : 0)));
+
+    utls::WriteUInt32BE(output, m_entries.GetSize());
+    for (unsigned i = 0; i < m_entries.GetSize(); i++)
+    {
+        auto& entry = m_entries[i];
+        output.Write((char)entry.Type);
+        output.Write((char)(entry.Parsed ? 1 : 0));
+        writeUInt64BE(output, entry.Unknown1);
+        utls::WriteUInt32BE(output, entry.Unknown2);
+    }
+
+    string trailer;
+    m_Trailer->GetVariant().ToString(trailer);
+    utls::WriteUInt32BE(output, (uint32_t)trailer.size());
+    output.Write(trailer);
+}
+
+bool PdfParser::tryReadIndex(InputStreamDevice& device)
+{
+    if (m_index.size() == 0)
+        return false;
+
+    try
+    {
+        SpanStreamDevice input(m_index);
+        char magic[IndexMagic.size()];
+        input.Read(magic, IndexMagic.size());
+        uint32_t version;
+        utls::ReadUInt32BE(input, version);
+        if (string_view(magic, IndexMagic.size()) != IndexMagic || version != IndexVersion)
+            return false;
+
+        uint64_t fileSize;
+        uint64_t modificationTime;
+        readUInt64BE(input, fileSize);
+        readUInt64BE(input, modificationTime);
+        device.Seek(0, SeekDirection::End);
+        if (fileSize != device.GetPosition() || (int64_t)modificationTime != m_indexModificationTime)
+            return false;
+
+        auto hash = computeIndexGuardHash(device, (size_t)fileSize);
+        charbuff indexHash(hash.size());
+        input.Read(indexHash.data(), indexHash.size());
+        if (indexHash != hash)
+            return false;
+
+        uint64_t xrefOffset;
+        uint64_t lastEOFOffset;
+        uint32_t incrementalUpdateCount;
+        readUInt64BE(input, xrefOffset);
+        readUInt64BE(input, lastEOFOffset);
+        utls::ReadUInt32BE(input, incrementalUpdateCount);
+        char flags = input.ReadChar();
+
+        // Don't trust the counts before allocating: the index may be
+        // truncated or corrupted. Each entry is serialized in 14 bytes
+        uint32_t entryCount;
+        utls::ReadUInt32BE(input, entryCount);
+        if (entryCount > (uint32_t)PdfCommon::GetMaxObjectCount()
+            || entryCount > (input.GetLength() - input.GetPosition()) / IndexEntrySize)
+        {
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::ValueOutOfRange, "Invalid xref index entry count");
+        }
+
+        m_entries.Enlarge(entryCount);
+        for (unsigned i = 0; i < entryCount; i++)
+        {
+            auto& entry = m_entries[i];
+            entry.Type = (PdfXRefEntryType)input.ReadChar();
+            entry.Parsed = input.ReadChar() != 0;
+            readUInt64BE(input, entry.Unknown1);
+            utls::ReadUInt32BE(input, entry.Unknown2);
+        }
+
+        uint32_t trailerLength;
+        utls::ReadUInt32BE(input, trailerLength);
+        if (trailerLength > input.GetLength() - input.GetPosition())
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::ValueOutOfRange, "Invalid xref index trailer length");
+
+        string trailerStr(trailerLength, '\0');
+        input.Read(trailerStr.data(), trailerLength);
+        SpanStreamDevice trailerDevice(trailerStr);
+        PdfVariant trailer;
+        m_tokenizer.ReadNextVariant(trailerDevice, trailer);
+        if (!trailer.IsDictionary())
+            PODOFO_RAISE_ERROR(PdfErrorCode::InvalidTrailer);
+
+        m_Trailer.reset(new PdfObject(std::move(trailer)));
+        m_Trailer->SetDocument(&m_Objects->GetDocument());
+        m_FileSize = (size_t)fileSize;
+        m_XRefOffset = (size_t)xrefOffset;
+        m_lastEOFOffset = (size_t)lastEOFOffset;
+        m_IncrementalUpdateCount = (int)incrementalUpdateCount;
+        m_HasXRefStream = (flags & 1) != 0;
+        m_XRefRebuilt = (flags & 2) != 0;
+        m_IndexUsed = true;
+        return true;
+    }
+    catch (PdfError&)
+    {
+        PoDoFo::LogMessage(PdfLogSeverity::Warning, "The xref index is invalid, reading the document structure");
+        m_entries.Clear();
+        m_Trailer = nullptr;
+        return false;
+    }
+}
+
 void PdfParser::ReadObjects(InputStreamDevice& device)
 {
     if (m_Trailer == nullptr)
@@ -639,6 +1071,9 @@ void PdfParser::ReadObjects(InputStreamDevice& device)
         }
     }
 
+    if (m_XRefRebuilt)
+        readRebuiltObjectStreams(device);
+
     readObjectsInternal(device);
 }
 
@@ -759,34 +1194,118 @@ void PdfParser::readObjectsInternal(InputStreamDevice& device)
 
     // all normal objects including object streams are available now,
     // we can parse the object streams safely now.
-    //
-    // Note that even if demand loading is enabled we still currently read all
-    // objects from the stream into memory then free the stream.
-    //
-    for (auto& pair : compressedObjects)
+    if (m_LoadOnDemand)
     {
-#ifndef VERBOSE_DEBUG_DISABLED
-        if (m_LoadOnDemand)
-            cerr << "Demand loading on, but can't demand-load from object stream." << endl;
-#endif
-        readCompressedObjectFromStream((uint32_t)pair.first, pair.second);
-        m_Objects->AddObjectStream((uint32_t)pair.first);
+        // The compressed objects are just registered, and
+        // their object stream is decoded on first access
+        shared_ptr<PdfObjectStreamCache> objectStreamCache;
+        if (compressedObjects.size() != 0)
+            objectStreamCache = std::make_shared<PdfObjectStreamCache>();
+
+        for (auto& pair : compressedObjects)
+        {
+            createCompressedObjects((uint32_t)pair.first, pair.second, objectStreamCache);
+            m_Objects->AddObjectStream((uint32_t)pair.first);
+        }
+    }
+    else
+    {
+        loadObjects(device, compressedObjects);
     }
 
-    if (!m_LoadOnDemand)
+    updateDocumentVersion();
+}
+
+void PdfParser::loadObjects(InputStreamDevice& device, const map<int64_t, vector<int64_t>>& compressedObjects)
+{
+    vector<PdfParserObject*> objects;
+    for (auto obj : *m_Objects)
+    {
+        auto parserObj = dynamic_cast<PdfParserObject*>(obj);
+        if (parserObj != nullptr)
+            objects.push_back(parserObj);
+    }
+
+    // NOTE: Parallel parsing requires each thread to read from its
+    // own device, which is cheap only on contiguous buffers. Encrypted
+    // documents are always parsed serially
+    bufferview view;
+    unsigned threadCount = 1;
+    if (m_ParallelLoad && m_Encrypt == nullptr && objects.size() >= ParallelLoadMinObjectCount
+        && device.TryGetBufferView(view))
     {
+        threadCount = std::max(1u, thread::hardware_concurrency());
+    }
+
+    if (threadCount == 1)
+    {
+        for (auto& pair : compressedObjects)
+        {
+            readCompressedObjectFromStream((uint32_t)pair.first, pair.second);
+            m_Objects->AddObjectStream((uint32_t)pair.first);
+        }
+
         // Force loading of streams. We can't do this during the initial
         // run that populates m_Objects because a stream might have a /Length
         // key that references an object we haven't yet read. So we must do it here
-        // in a second pass, or (if demand loading is enabled) defer it for later.
-        for (auto objToLoad : *m_Objects)
-        {
-            auto obj = dynamic_cast<PdfParserObject*>(objToLoad);
+        // in a second pass
+        for (auto obj : objects)
             obj->ParseStream();
+
+        return;
+    }
+
+    // Parse first all the objects, without streams
+    parallelFor(threadCount, view, objects.size(), [&objects](InputStreamDevice& device, size_t i) {
+        objects[i]->ParseFrom(device, false);
+    });
+
+    // Read the compressed objects, one object stream per task.
+    // Objects are added to the object list only after all the
+    // tasks are completed
+    vector<pair<PdfParserObject*, cspan<int64_t>>> objectStreams;
+    for (auto& pair : compressedObjects)
+    {
+        // generation number of object streams is always 0
+        auto streamObj = dynamic_cast<PdfParserObject*>(m_Objects->GetObject(PdfReference((uint32_t)pair.first, 0)));
+        if (streamObj == nullptr)
+        {
+            if (m_IgnoreBrokenObjects)
+            {
+                PoDoFo::LogMessage(PdfLogSeverity::Error, "Loading of object {} 0 R failed!", pair.first);
+                m_Objects->AddObjectStream((uint32_t)pair.first);
+                continue;
+            }
+            else
+            {
+                PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidObject, "Loading of object {} 0 R failed!", pair.first);
+            }
         }
+
+        objectStreams.push_back({ streamObj, pair.second });
+        m_Objects->AddObjectStream((uint32_t)pair.first);
     }
 
-    updateDocumentVersion();
+    vector<vector<unique_ptr<PdfObject>>> compressed(objectStreams.size());
+    parallelFor(threadCount, view, objectStreams.size(), [this, &objectStreams, &compressed](InputStreamDevice& device, size_t i) {
+        auto& objectStream = objectStreams[i];
+        objectStream.first->ParseFrom(device, true);
+        PdfObjectStreamParser parserObject(*objectStream.first, *m_Objects,
+            std::make_shared<charbuff>(PdfTokenizer::BufferSize));
+        parserObject.Parse(objectStream.second, compressed[i]);
+    });
+
+    for (auto& streamObjects : compressed)
+    {
+        for (auto& obj : streamObjects)
+            m_Objects->PushObject(obj.release());
+    }
+
+    // Finally parse the streams, that may have a /Length
+    // key referencing any other object
+    parallelFor(threadCount, view, objects.size(), [&objects](InputStreamDevice& device, size_t i) {
+        objects[i]->ParseFrom(device, true);
+    });
 }
 
 void PdfParser::readCompressedObjectFromStream(uint32_t objNo, const cspan<int64_t>& objectList)
@@ -810,6 +1329,33 @@ void PdfParser::readCompressedObjectFromStream(uint32_t objNo, const cspan<int64
     parserObject.Parse(objectList);
 }
 
+void PdfParser::createCompressedObjects(uint32_t objNo, const cspan<int64_t>& objectList,
+    const shared_ptr<PdfObjectStreamCache>& cache)
+{
+    // generation number of object streams is always 0
+    auto streamObj = dynamic_cast<PdfParserObject*>(m_Objects->GetObject(PdfReference(objNo, 0)));
+    if (streamObj == nullptr)
+    {
+        if (m_IgnoreBrokenObjects)
+        {
+            PoDoFo::LogMessage(PdfLogSeverity::Error, "Loading of object {} 0 R failed!", objNo);
+            return;
+        }
+        else
+        {
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidObject, "Loading of object {} 0 R failed!", objNo);
+        }
+    }
+
+    for (int64_t compressedObjNo : objectList)
+    {
+        // The generation number of any compressed object is implicitly zero
+        PdfReference reference(static_cast<uint32_t>(compressedObjNo), 0);
+        m_Objects->PushObject(new PdfCompressedParserObject(reference, objNo,
+            m_entries[(unsigned)compressedObjNo].Index, cache));
+    }
+}
+
 void PdfParser::findTokenBackward(InputStreamDevice& device, const char* token, size_t range, size_t searchEnd)
 {
     device.Seek((ssize_t)searchEnd, SeekDirection::Begin);
@@ -1017,3 +1563,136 @@ bool ReadMagicWord(char ch, unsigned& cursoridx)
 
     return false;
 }
+
+// Run the task for all the indices in [0, count) using the given number
+// of threads, the calling one included. Each thread reads from its own
+// device on the source buffer. The first raised error is rethrown
+void parallelFor(unsigned threadCount, const bufferview& view, size_t count,
+    const function<void(InputStreamDevice&, size_t)>& task)
+{
+    atomic<size_t> next(0);
+    atomic<bool> failed(false);
+    exception_ptr error;
+    auto worker = [&]() {
+        SpanStreamDevice device(view);
+        try
+        {
+            size_t start;
+            while (!failed && (start = next.fetch_add(ParallelLoadBatchSize)) < count)
+            {
+                size_t end = std::min(start + ParallelLoadBatchSize, count);
+                for (size_t i = start; i < end; i++)
+                    task(device, i);
+            }
+        }
+        catch (...)
+        {
+            if (!failed.exchange(true))
+                error = std::current_exception();
+        }
+    };
+
+    threadCount = (unsigned)std::min<size_t>(threadCount, (count + ParallelLoadBatchSize - 1) / ParallelLoadBatchSize);
+    vector<thread> workers;
+    for (unsigned i = 1; i < threadCount; i++)
+        workers.emplace_back(worker);
+
+    worker();
+    for (auto& thread : workers)
+        thread.join();
+
+    if (error != nullptr)
+        std::rethrow_exception(error);
+}
+
+// Read the "N G" object header preceding the "obj"
+// keyword at the given position
+bool tryReadObjectHeader(const string_view& contents, size_t objPos,
+    uint32_t& objectNum, uint16_t& generation, size_t& offset)
+{
+    auto skipWhitespaces = [&contents](size_t pos) {
+        while (pos > 0 && IsCharWhitespace(contents[pos - 1]))
+            pos--;
+        return pos;
+    };
+    auto skipDigits = [&contents](size_t pos) {
+        while (pos > 0 && contents[pos - 1] >= '0' && contents[pos - 1] <= '9')
+            pos--;
+        return pos;
+    };
+
+    size_t end = skipWhitespaces(objPos);
+    size_t start = skipDigits(end);
+    if (start == end || end == objPos || !utls::TryParse(contents.substr(start, end - start), generation))
+        return false;
+
+    end = skipWhitespaces(start);
+    offset = skipDigits(end);
+    if (offset == end || end == start || !utls::TryParse(contents.substr(offset, end - offset), objectNum))
+        return false;
+
+    return true;
+}
+
+// Get the /Type of the dictionary of the object
+// contents, looking only at its first bytes
+string_view getObjectType(string_view dict)
+{
+    constexpr size_t MaxDictionaryLength = 1024;
+    dict = dict.substr(0, MaxDictionaryLength);
+    dict = dict.substr(0, std::min(dict.find("stream"), dict.find("endobj")));
+    size_t pos = dict.find("/Type");
+    if (pos == string_view::npos)
+        return { };
+
+    pos += 5;
+    while (pos < dict.size() && IsCharWhitespace(dict[pos]))
+        pos++;
+
+    if (pos == dict.size() || dict[pos] != '/')
+        return { };
+
+    size_t start = ++pos;
+    while (pos < dict.size() && !IsCharWhitespace(dict[pos]) && !IsCharDelimiter(dict[pos]))
+        pos++;
+
+    return dict.substr(start, pos - start);
+}
+
+// Check the keyword at the given position is not part of a longer token
+bool isKeywordAt(const string_view& contents, size_t pos, size_t length)
+{
+    if (pos != 0 && !IsCharWhitespace(contents[pos - 1]) && !IsCharDelimiter(contents[pos - 1]))
+        return false;
+
+    pos += length;
+    return pos == contents.size() || IsCharWhitespace(contents[pos]) || IsCharDelimiter(contents[pos]);
+}
+
+// Hash the tail of the file, to detect changes
+// that don't alter the file size
+charbuff computeIndexGuardHash(InputStreamDevice& device, size_t fileSize)
+{
+    size_t length = std::min(fileSize, IndexGuardHashLength);
+    charbuff buffer(length);
+    device.Seek((ssize_t)(fileSize - length));
+    if (length != 0)
+        device.Read(buffer.data(), length);
+
+    return ssl::ComputeHash(buffer, PdfHashingAlgorithm::SHA256);
+}
+
+void writeUInt64BE(OutputStream& output, uint64_t value)
+{
+    utls::WriteUInt32BE(output, (uint32_t)(value >> 32));
+    utls::WriteUInt32BE(output, (uint32_t)value);
+}
+
+void readUInt64BE(InputStream& input, uint64_t& value)
+{
+    uint32_t high;
+    uint32_t low;
+    utls::ReadUInt32BE(input, high);
+    utls::ReadUInt32BE(input, low);
+    value = ((uint64_t)high << 32) | low;
+}
@@ -16,6 +16,7 @@
 namespace PoDoFo {
 
 class PdfEncrypt;
+class PdfObjectStreamCache;
 
 /**
  * PdfParser reads a PDF file into memory.
@@ -60,6 +61,21 @@ public:
 
     std::unique_ptr<PdfObject> TakeTrailer();
 
+    /** Write a compact binary index of the document structure read
+     *  by the last Parse() call: the xref entries, including the object
+     *  streams membership of compressed objects, and the trailer.
+     *  The index can be used with SetIndex() to skip reading the xref
+     *  sections on later loads of the same file
+     *
+     *  \param device the device that was parsed, used to compute the
+     *      index guard together with the file size
+     *  \param output the stream where to write the index
+     *  \param modificationTime the file modification time, if known,
+     *      that will be also checked by the guard
+     *  \remarks It must be called before TakeTrailer()
+     */
+    void WriteIndex(InputStreamDevice& device, OutputStream& output, int64_t modificationTime = 0) const;
+
     /**
      * Try retrieve the previous revision offset of the document before signing
      * \param currOffset the current offset where to start the search
@@ -155,10 +171,55 @@ public:
      */
     inline void SetIgnoreBrokenObjects(bool broken) { m_IgnoreBrokenObjects = broken; }
 
+    /**
+     * \return if objects are parsed in parallel when not loading on demand
+     */
+    inline bool GetParallelLoad() const { return m_ParallelLoad; }
+
+    /**
+     * Specify if the parser should parse objects in multiple
+     * threads when loading all objects immediately. This is
+     * effective only on devices with a contiguous buffer, eg.
+     * memory mapped files or in memory buffers, and on not
+     * encrypted documents.
+     *
+     * Default is to parse objects serially.
+     *
+     * \param parallel if true objects will be parsed in parallel
+     */
+    inline void SetParallelLoad(bool parallel) { m_ParallelLoad = parallel; }
+
     inline size_t GetXRefOffset() const { return m_XRefOffset; }
 
     inline bool HasXRefStream() const { return m_HasXRefStream; }
 
+    /** \returns true if the xref table was damaged or missing
+     *       and it was rebuilt by scanning the whole file
+     */
+    inline bool IsXRefRebuilt() const { return m_XRefRebuilt; }
+
+    /** Get the xref entries read from the file, or rebuilt
+     *  by scanning it. They can be cached to avoid reading
+     *  the xref table again on later loads of the same file
+     */
+    inline const PdfXRefEntries& GetXRefEntries() const { return m_entries; }
+
+    /** Set an index previously written by WriteIndex(), to be used
+     *  instead of reading the document structure by the next
+     *  Parse() calls. The index is ignored if it's malformed or
+     *  if its guard doesn't match the parsed file
+     *
+     *  \param index the index data. It's copied
+     *  \param modificationTime the current file modification time,
+     *      if it was supplied when writing the index
+     */
+    void SetIndex(const bufferview& index, int64_t modificationTime = 0);
+
+    /** \returns true if the document structure was read from
+     *       the index supplied with SetIndex()
+     */
+    inline bool IsIndexUsed() const { return m_IndexUsed; }
+
     const PdfEncryptSession* GetEncrypt() const { return m_Encrypt.get(); }
 
 private:
@@ -266,8 +327,42 @@ private:
      */
     void readCompressedObjectFromStream(uint32_t objNo, const cspan<int64_t>& objectList);
 
+    /** Load all objects and streams, optionally in parallel
+     *
+     *  \param compressedObjects the compressed object numbers for each object stream
+     */
+    void loadObjects(InputStreamDevice& device, const std::map<int64_t, std::vector<int64_t>>& compressedObjects);
+
+    /** Push on the objects vector the objects in the object stream
+     *  objNo, without reading them. They will be read on first access
+     *
+     *  \param objNo object number of the stream object
+     *  \param objectList the numbers of the objects to push
+     *  \param cache the cache of decoded object streams shared by the objects
+     */
+    void createCompressedObjects(uint32_t objNo, const cspan<int64_t>& objectList,
+        const std::shared_ptr<PdfObjectStreamCache>& cache);
+
     void readNextTrailer(InputStreamDevice& device, bool skipFollowPrevious);
 
+    /** Rebuild the xref entries and the trailer by scanning the
+     *  whole file once for "N G obj" headers and "trailer" keywords.
+     *  Used when the xref table can't be read
+     */
+    void rebuildXRefTable(InputStreamDevice& device);
+
+    /** Register the compressed objects of the object streams found
+     *  while rebuilding the xref table. Objects defined directly
+     *  in the file take precedence over compressed ones
+     */
+    void readRebuiltObjectStreams(InputStreamDevice& device);
+
+    /** Read the document structure from the index supplied
+     *  with SetIndex(), if it's valid for the given device
+     *  \returns true if the index was used
+     */
+    bool tryReadIndex(InputStreamDevice& device);
+
 
     /** Checks for the existence of the %%EOF marker at the end of the file.
      *  When strict mode is off it will also attempt to setup the parser to ignore
@@ -307,20 +402,27 @@ private:
 
     size_t m_magicOffset;
     bool m_HasXRefStream;
+    bool m_XRefRebuilt;
+    bool m_IndexUsed;
     size_t m_XRefOffset;
     size_t m_FileSize;
     size_t m_lastEOFOffset;
 
     PdfXRefEntries m_entries;
+    // Object numbers and offsets of object streams found by rebuildXRefTable()
+    std::vector<std::pair<uint32_t, size_t>> m_rebuiltObjectStreams;
     PdfIndirectObjectList* m_Objects;
 
-    std::unique_ptr<PdfParserObject> m_Trailer;
+    std::unique_ptr<PdfObject> m_Trailer;
     std::shared_ptr<PdfEncryptSession> m_Encrypt;
 
     std::string m_Password;
+    charbuff m_index;
+    int64_t m_indexModificationTime;
 
     bool m_StrictParsing;
     bool m_IgnoreBrokenObjects;
+    bool m_ParallelLoad;
 
     unsigned m_IncrementalUpdateCount;
 
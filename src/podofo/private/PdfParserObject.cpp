@@ -9,6 +9,7 @@
 
 #include <podofo/main/PdfArray.h>
 #include <podofo/main/PdfDictionary.h>
+#include <podofo/auxiliary/StreamDevice.h>
 
 #include "PdfFilterFactory.h"
 
@@ -67,6 +68,26 @@ void PdfParserObject::ParseStream()
     DelayedLoadStream();
 }
 
+void PdfParserObject::ParseFrom(InputStreamDevice& device, bool parseStream)
+{
+    auto sourceDevice = m_device;
+    m_device = &device;
+    try
+    {
+        if (parseStream)
+            DelayedLoadStream();
+        else
+            DelayedLoad();
+    }
+    catch (...)
+    {
+        m_device = sourceDevice;
+        throw;
+    }
+
+    m_device = sourceDevice;
+}
+
 void PdfParserObject::delayedLoad()
 {
     PdfTokenizer tokenizer;
@@ -98,6 +119,97 @@ void PdfParserObject::delayedLoadStream()
     }
 }
 
+bool PdfParserObject::tryGetRawStreamView(bufferview& view) const
+{
+    // NOTE: Be careful not to trigger loading of the stream
+    PODOFO_ASSERT(IsDelayedLoadDone());
+    bufferview deviceView;
+    if (!m_HasStream || isStreamEncrypted() || !m_device->TryGetBufferView(deviceView))
+        return false;
+
+    auto lengthObj = m_Variant.GetDictionaryUnsafe().FindKey("Length");
+    int64_t size;
+    if (lengthObj == nullptr || !lengthObj->TryGetNumber(size) || size < 0)
+        return false;
+
+    // Skip the whitespaces and the end-of-line marker after
+    // the "stream" keyword, the same way parseStream() does
+    size_t offset = m_StreamOffset;
+    while (offset < deviceView.size() && (deviceView[offset] == ' ' || deviceView[offset] == '\t'))
+        offset++;
+
+    if (offset < deviceView.size() && deviceView[offset] == '\r')
+        offset++;
+
+    if (offset < deviceView.size() && deviceView[offset] == '\n')
+        offset++;
+
+    if ((size_t)size > deviceView.size() - offset)
+        return false;
+
+    view = deviceView.subspan(offset, (size_t)size);
+    return true;
+}
+
+bool PdfParserObject::tryReadReferences(vector<PdfReference>& references, bool concurrent) const
+{
+    // NOTE: Loaded objects are read directly by the caller. Here
+    // the object is read in a temporary, so it stays unloaded
+    // and its stream is never read
+    if (IsDelayedLoadDone() || m_IsTrailer || m_device == nullptr)
+        return false;
+
+    PdfVariant variant;
+    bufferview view;
+    if (m_device->TryGetBufferView(view))
+    {
+        // Read from a private device, which can be used
+        // concurrently and doesn't move the source device
+        SpanStreamDevice device(view);
+        readVariant(device, variant);
+    }
+    else
+    {
+        if (concurrent)
+            return false;
+
+        readVariant(*m_device, variant);
+    }
+
+    collectReferences(variant, references);
+    return true;
+}
+
+void PdfParserObject::readVariant(InputStreamDevice& device, PdfVariant& variant) const
+{
+    PdfTokenizer tokenizer;
+    device.Seek(m_Offset);
+    (void)readReference(device, tokenizer);
+
+    PdfTokenType tokenType;
+    string_view token;
+    if (!tokenizer.TryReadNextToken(device, token, tokenType))
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::UnexpectedEOF, "Expected variant");
+
+    // Empty objects have no references
+    if (token == "endobj")
+        return;
+
+    // NOTE: Strings are not decrypted, as only
+    // the references are of interest
+    tokenizer.ReadNextVariant(device, token, tokenType, variant, nullptr);
+}
+
+bool PdfParserObject::isStreamEncrypted() const
+{
+    // NOTE: /Metadata objects may be unencrypted even if the
+    // whole document is encrypted
+    const PdfName* type;
+    return m_Encrypt != nullptr && (m_Encrypt->GetEncrypt().IsMetadataEncrypted()
+        || !m_Variant.GetDictionaryUnsafe().TryFindKeyAs("Type", type)
+        || *type != "Metadata");
+}
+
 bool PdfParserObject::removeStream()
 {
     bool hasStream = m_HasStream;
@@ -114,7 +226,7 @@ void PdfParserObject::SetRevised()
 PdfReference PdfParserObject::ReadReference(PdfTokenizer& tokenizer)
 {
     m_device->Seek(m_Offset);
-    return readReference(tokenizer);
+    return readReference(*m_device, tokenizer);
 }
 
 // Only called via the demand loading mechanism
@@ -238,18 +350,12 @@ ReadStream:
     m_device->Seek(streamOffset);	// reset it before reading!
 
     // Set stream raw data without marking the object dirty
-    // NOTE: /Metadata objects may be unencrypted even if the
-    // whole document is encrypted
-    const PdfName* type;
-    if (m_Encrypt != nullptr && (m_Encrypt->GetEncrypt().IsMetadataEncrypted()
-        || !this->m_Variant.GetDictionaryUnsafe().TryFindKeyAs("Type", type)
-        || *type != "Metadata"))
+    if (isStreamEncrypted())
     {
         auto input = m_Encrypt->GetEncrypt().CreateEncryptionInputStream(*m_device, static_cast<size_t>(size), m_Encrypt->GetContext(), GetIndirectReference());
         getOrCreateStream().InitData(*input, static_cast<ssize_t>(size), std::move(filters));
-        // Release the encrypt object after loading the stream.
-        // It's not needed for serialization here
-        m_Encrypt = nullptr;
+        // NOTE: Keep the encrypt object, as it's needed
+        // to load the object again after it's unloaded
     }
     else
     {
@@ -259,7 +365,7 @@ ReadStream:
 
 void PdfParserObject::checkReference(PdfTokenizer& tokenizer)
 {
-    auto reference = readReference(tokenizer);
+    auto reference = readReference(*m_device, tokenizer);
     if (GetIndirectReference() != reference)
     {
         PoDoFo::LogMessage(PdfLogSeverity::Warning,
@@ -268,13 +374,13 @@ void PdfParserObject::checkReference(PdfTokenizer& tokenizer)
     }
 }
 
-PdfReference PdfParserObject::readReference(PdfTokenizer& tokenizer)
+PdfReference PdfParserObject::readReference(InputStreamDevice& device, PdfTokenizer& tokenizer)
 {
     PdfReference reference;
     try
     {
-        int64_t obj = tokenizer.ReadNextNumber(*m_device);
-        int64_t gen = tokenizer.ReadNextNumber(*m_device);
+        int64_t obj = tokenizer.ReadNextNumber(device);
+        int64_t gen = tokenizer.ReadNextNumber(device);
         reference = PdfReference(static_cast<uint32_t>(obj), static_cast<uint16_t>(gen));
 
     }
@@ -285,7 +391,7 @@ PdfReference PdfParserObject::readReference(PdfTokenizer& tokenizer)
     }
 
     string_view token;
-    if (!tokenizer.TryReadNextToken(*m_device, token) || token != "obj")
+    if (!tokenizer.TryReadNextToken(device, token) || token != "obj")
     {
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidObject, "Error while reading object {} {} R: Next token is not 'obj'",
             reference.ObjectNumber(), reference.GenerationNumber());
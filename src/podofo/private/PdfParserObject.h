@@ -55,6 +55,14 @@ public:
 
     void ParseStream();
 
+    /** Parse the object, and optionally its stream, reading from
+     * the given device instead of the source device
+     * \param device a device with the same content of the source device
+     * \remarks Used to parse objects in parallel, each thread
+     *  reading from its own device
+     */
+    void ParseFrom(InputStreamDevice& device, bool parseStream);
+
     /** Gets an offset in which the object beginning is stored in the file.
      *  Note the offset points just after the object identificator ("0 0 obj").
      *
@@ -79,6 +87,8 @@ protected:
 
     void delayedLoad() override;
     void delayedLoadStream() override;
+    bool tryGetRawStreamView(bufferview& view) const override;
+    bool tryReadReferences(std::vector<PdfReference>& references, bool concurrent) const override;
     bool removeStream() override;
 
     void SetRevised() override;
@@ -95,7 +105,16 @@ private:
      */
     void parseStream();
 
-    PdfReference readReference(PdfTokenizer& tokenizer);
+    /** Determines if the stream data is encrypted in the source device
+     */
+    bool isStreamEncrypted() const;
+
+    /** Read the variant of the object in a temporary, without
+     * decrypting strings and without loading the object
+     */
+    void readVariant(InputStreamDevice& device, PdfVariant& variant) const;
+
+    static PdfReference readReference(InputStreamDevice& device, PdfTokenizer& tokenizer);
 
     void checkReference(PdfTokenizer& tokenizer);
 
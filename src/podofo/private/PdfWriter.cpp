@@ -7,6 +7,10 @@
 #include "PdfDeclarationsPrivate.h"
 #include "PdfWriter.h"
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 #include <podofo/auxiliary/StreamDevice.h>
 #include <podofo/main/PdfDate.h>
 #include <podofo/main/PdfDictionary.h>
@@ -18,10 +22,17 @@
 // 10 spaces
 #define LINEARIZATION_PADDING "          "
 
+// Below this count objects are always written serially
+constexpr unsigned ParallelWriteMinObjectCount = 256;
+// Number of serialized objects each thread may keep waiting to be
+// appended to the device, before the pending ones get written
+constexpr size_t ParallelWritePendingObjectsPerThread = 16;
+
 using namespace std;
 using namespace PoDoFo;
 
 static PdfWriteFlags toWriteFlags(PdfSaveOptions opts, PdfALevel pdfaLevel);
+static bool containsRawData(const PdfObject& obj);
 
 PdfWriter::PdfWriter(PdfIndirectObjectList* objects, const PdfObject& trailer) :
     m_Objects(objects),
@@ -34,8 +45,11 @@ PdfWriter::PdfWriter(PdfIndirectObjectList* objects, const PdfObject& trailer) :
     m_SaveOptions(PdfSaveOptions::None),
     m_WriteFlags(PdfWriteFlags::None),
     m_PrevXRefOffset(0),
+    m_XRefOffset(-1),
     m_IncrementalUpdate(false),
-    m_rewriteXRefTable(false)
+    m_rewriteXRefTable(false),
+    m_ObjectStreamSize(DefaultObjectStreamSize),
+    m_useObjectStreams(false)
 {
 }
 
@@ -79,6 +93,15 @@ void PdfWriter::Write(OutputStreamDevice& device)
         m_Encrypt->GetEncrypt().CreateEncryptionDictionary(m_EncryptObj->GetDictionary());
     }
 
+    // Object streams require a XRef stream, which is switched on only
+    // on full saves: incremental updates must keep the XRef format
+    // of the original document. PDF/A-1 doesn't allow object streams
+    m_useObjectStreams = (m_SaveOptions & PdfSaveOptions::ObjectStreams) != PdfSaveOptions::None
+        && (!m_IncrementalUpdate || (m_UseXRefStream && !m_rewriteXRefTable))
+        && m_PdfALevel != PdfALevel::L1B && m_PdfALevel != PdfALevel::L1A;
+    if (m_useObjectStreams && !m_UseXRefStream)
+        SetUseXRefStream(true);
+
     unique_ptr<PdfXRef> xRef;
     if (m_UseXRefStream)
         xRef.reset(new PdfXRefStream(*this));
@@ -96,6 +119,7 @@ void PdfWriter::Write(OutputStreamDevice& device)
             xRef->SetFirstEmptyBlock();
 
         xRef->Write(device, m_buffer);
+        m_XRefOffset = (int64_t)xRef->GetOffset();
     }
     catch (PdfError& e)
     {
@@ -106,6 +130,7 @@ void PdfWriter::Write(OutputStreamDevice& device)
             m_EncryptObj = nullptr;
         }
 
+        removeObjectStreams();
         PODOFO_PUSH_FRAME(e);
         throw;
     }
@@ -117,6 +142,8 @@ void PdfWriter::Write(OutputStreamDevice& device)
         m_EncryptObj = nullptr;
     }
 
+    removeObjectStreams();
+
     device.Flush();
 }
 
@@ -128,14 +155,16 @@ void PdfWriter::WritePdfHeader(OutputStreamDevice& device)
 
 void PdfWriter::WritePdfObjects(OutputStreamDevice& device, const PdfIndirectObjectList& objects, PdfXRef& xref)
 {
-    unique_ptr<PdfStatefulEncrypt> encrypt;
-    for (PdfObject* obj : objects)
+    if (m_IncrementalUpdate && !m_rewriteXRefTable)
     {
-        if (m_Encrypt != nullptr && obj != m_EncryptObj)
-            encrypt.reset(new PdfStatefulEncrypt(m_Encrypt->GetEncrypt(), m_Encrypt->GetContext(), obj->GetIndirectReference()));
-        else
-            encrypt.reset();
+        writeDirtyObjects(device, objects, xref);
+        return;
+    }
 
+    vector<PdfObject*> writtenObjects;
+    vector<PdfObject*> compressedObjects;
+    for (PdfObject* obj : objects)
+    {
         if (m_IncrementalUpdate && !obj->IsDirty())
         {
             if (m_rewriteXRefTable)
@@ -166,26 +195,353 @@ void PdfWriter::WritePdfObjects(OutputStreamDevice& device, const PdfIndirectObj
             }
         }
 
-        if (xref.ShouldSkipWrite(obj->GetIndirectReference()))
+        if (m_useObjectStreams)
         {
-            // If we skip write of this object, we supply a dummy
-            // offset of the object and not retrieve it from the device
-            xref.AddInUseObject(obj->GetIndirectReference(), 0xFFFFFFFF);
+            if (objects.IsObjectStream(obj->GetIndirectReference().ObjectNumber()))
+            {
+                // Parsed object streams are superseded by the
+                // newly written ones, just drop them
+                xref.AddInUseObject(obj->GetIndirectReference(), nullptr);
+                continue;
+            }
+
+            if (isObjectStreamEligible(*obj, xref))
+            {
+                compressedObjects.push_back(obj);
+                continue;
+            }
         }
-        else
+
+        writtenObjects.push_back(obj);
+    }
+
+    writeObjects(device, writtenObjects, xref);
+    writeObjectStreams(device, compressedObjects, xref);
+
+    for (auto& freeObjectRef : objects.GetFreeObjects())
+    {
+        xref.AddFreeObject(freeObjectRef);
+    }
+}
+
+void PdfWriter::writeDirtyObjects(OutputStreamDevice& device, const PdfIndirectObjectList& objects, PdfXRef& xref)
+{
+    // Untouched objects will not be output in the XRef entries but
+    // they are counted in trailer's /Size: just account the highest
+    // object number ever used, which includes also objects that
+    // are not in the list anymore, e.g. written object streams
+    if (objects.m_ObjectCount != 0)
+        xref.AddInUseObject(PdfReference(objects.m_ObjectCount, 0), nullptr);
+
+    // Only objects modified since they were loaded or last written
+    // are visited, so unchanged objects are neither iterated nor loaded.
+    // NOTE: Copy the references first, since writing an
+    // object resets its dirty flag and updates the set
+    vector<PdfReference> dirtyObjects(objects.m_dirtyObjects.begin(), objects.m_dirtyObjects.end());
+    vector<PdfObject*> writtenObjects;
+    vector<PdfObject*> compressedObjects;
+    for (auto& ref : dirtyObjects)
+    {
+        auto obj = objects.getObject(ref);
+        if (obj == nullptr || !obj->IsDirty())
+            continue;
+
+        if (m_useObjectStreams && isObjectStreamEligible(*obj, xref))
         {
-            xref.AddInUseObject(obj->GetIndirectReference(), device.GetPosition());
-            // Also make sure that we do not encrypt the encryption dictionary!
-            obj->WriteFinal(device, m_WriteFlags, encrypt.get(), m_buffer);
+            compressedObjects.push_back(obj);
+            continue;
         }
+
+        writtenObjects.push_back(obj);
     }
 
+    writeObjects(device, writtenObjects, xref);
+    writeObjectStreams(device, compressedObjects, xref);
+
     for (auto& freeObjectRef : objects.GetFreeObjects())
     {
         xref.AddFreeObject(freeObjectRef);
     }
 }
 
+void PdfWriter::writeObject(OutputStreamDevice& device, PdfObject& obj, PdfXRef& xref)
+{
+    if (xref.ShouldSkipWrite(obj.GetIndirectReference()))
+    {
+        // If we skip write of this object, we supply a dummy
+        // offset of the object and not retrieve it from the device
+        xref.AddInUseObject(obj.GetIndirectReference(), 0xFFFFFFFF);
+        return;
+    }
+
+    // Also make sure that we do not encrypt the encryption dictionary!
+    unique_ptr<PdfStatefulEncrypt> encrypt;
+    if (m_Encrypt != nullptr && &obj != m_EncryptObj)
+        encrypt.reset(new PdfStatefulEncrypt(m_Encrypt->GetEncrypt(), m_Encrypt->GetContext(), obj.GetIndirectReference()));
+
+    xref.AddInUseObject(obj.GetIndirectReference(), device.GetPosition());
+    obj.WriteFinal(device, m_WriteFlags, encrypt.get(), m_buffer);
+}
+
+void PdfWriter::writeObjects(OutputStreamDevice& device, const vector<PdfObject*>& objects, PdfXRef& xref)
+{
+    // NOTE: When a memory budget is set, accessing the objects
+    // updates the list of the loaded ones, which may also evict
+    // them: in that case always write serially
+    unsigned threadCount = 1;
+    if ((m_SaveOptions & PdfSaveOptions::ParallelWrite) != PdfSaveOptions::None
+        && objects.size() >= ParallelWriteMinObjectCount
+        && m_Objects->GetMemoryBudget() == 0)
+    {
+        threadCount = std::max(1u, thread::hardware_concurrency());
+    }
+
+    if (threadCount == 1)
+    {
+        for (auto obj : objects)
+            writeObject(device, *obj, xref);
+
+        return;
+    }
+
+    // Workers serialize, compress and encrypt the objects in private
+    // buffers, while the calling thread appends them in order to the
+    // device, recording their offsets. Workers don't get ahead of the
+    // last committed object by more than a fixed window, which bounds
+    // the memory of the pending buffers
+    size_t count = objects.size();
+    size_t window = (size_t)threadCount * ParallelWritePendingObjectsPerThread;
+    vector<charbuff> buffers(count);
+    vector<char> skipped(count);
+    // Objects with raw data, as the /Contents of a signature being
+    // prepared, record their offset in the device while written,
+    // so they are left to the calling thread to write them in place
+    vector<char> serial(count);
+    vector<char> done(count);
+    for (size_t i = 0; i < count; i++)
+        skipped[i] = xref.ShouldSkipWrite(objects[i]->GetIndirectReference());
+
+    size_t next = 0;
+    size_t committed = 0;
+    bool failed = false;
+    exception_ptr error;
+    mutex stateMutex;
+    // Serializes the loading of the objects from the parser device
+    // and the updates of the set of dirty objects
+    mutex loadMutex;
+    condition_variable cond;
+    auto setFailed = [&]() {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            if (!failed)
+            {
+                failed = true;
+                error = std::current_exception();
+            }
+        }
+        cond.notify_all();
+    };
+
+    auto worker = [&](PdfEncryptContext* context) {
+        try
+        {
+            charbuff buffer;
+            while (true)
+            {
+                size_t i;
+                {
+                    unique_lock<mutex> lock(stateMutex);
+                    cond.wait(lock, [&]() { return failed || next == count || next < committed + window; });
+                    if (failed || next == count)
+                        return;
+
+                    i = next++;
+                }
+
+                if (!skipped[i])
+                {
+                    auto& obj = *objects[i];
+                    {
+                        lock_guard<mutex> lock(loadMutex);
+                        obj.DelayedLoadStream();
+                    }
+
+                    serial[i] = containsRawData(obj);
+                    if (!serial[i])
+                    {
+                        // Also make sure that we do not encrypt the encryption dictionary!
+                        unique_ptr<PdfStatefulEncrypt> encrypt;
+                        if (context != nullptr && &obj != m_EncryptObj)
+                            encrypt.reset(new PdfStatefulEncrypt(m_Encrypt->GetEncrypt(), *context, obj.GetIndirectReference()));
+
+                        BufferStreamDevice output(buffers[i]);
+                        obj.write(output, false, m_WriteFlags, encrypt.get(), buffer);
+                    }
+                }
+
+                {
+                    lock_guard<mutex> lock(stateMutex);
+                    done[i] = 1;
+                }
+                cond.notify_all();
+            }
+        }
+        catch (...)
+        {
+            setFailed();
+        }
+    };
+
+    // The encryption contexts hold per thread cipher state. Create
+    // them before starting the workers, as the calling thread may
+    // use the shared context meanwhile to write objects in place
+    threadCount = (unsigned)std::min<size_t>(threadCount, count);
+    vector<unique_ptr<PdfEncryptContext>> contexts(threadCount);
+    if (m_Encrypt != nullptr)
+    {
+        for (auto& context : contexts)
+            context.reset(new PdfEncryptContext(m_Encrypt->GetContext()));
+    }
+
+    vector<thread> workers;
+    for (unsigned i = 0; i < threadCount; i++)
+        workers.emplace_back(worker, contexts[i].get());
+
+    try
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            {
+                unique_lock<mutex> lock(stateMutex);
+                cond.wait(lock, [&]() { return failed || done[i] != 0; });
+                if (failed)
+                    break;
+            }
+
+            auto& obj = *objects[i];
+            if (skipped[i])
+            {
+                // If we skip write of this object, we supply a dummy
+                // offset of the object and not retrieve it from the device
+                xref.AddInUseObject(obj.GetIndirectReference(), 0xFFFFFFFF);
+            }
+            else if (serial[i])
+            {
+                lock_guard<mutex> lock(loadMutex);
+                writeObject(device, obj, xref);
+            }
+            else
+            {
+                xref.AddInUseObject(obj.GetIndirectReference(), device.GetPosition());
+                device.Write(buffers[i]);
+                charbuff().swap(buffers[i]);
+
+                // After writing we can reset the dirty flag
+                lock_guard<mutex> lock(loadMutex);
+                obj.ResetDirty();
+            }
+
+            {
+                lock_guard<mutex> lock(stateMutex);
+                committed = i + 1;
+            }
+            cond.notify_all();
+        }
+    }
+    catch (...)
+    {
+        setFailed();
+    }
+
+    for (auto& thread : workers)
+        thread.join();
+
+    if (error != nullptr)
+        std::rethrow_exception(error);
+}
+
+bool PdfWriter::isObjectStreamEligible(const PdfObject& obj, PdfXRef& xref) const
+{
+    // ISO 32000-1:2008 7.5.7 "Object Streams": stream objects, objects
+    // with a generation number other than zero and the encryption
+    // dictionary shall not be stored in an object stream
+    auto& ref = obj.GetIndirectReference();
+    return ref.GenerationNumber() == 0
+        && &obj != m_EncryptObj
+        && !xref.ShouldSkipWrite(ref)
+        && !obj.HasStream()
+        // Raw data, as the /Contents of a signature being prepared, records
+        // its offset in the output device, which is meaningless in an
+        // object stream, and must be written uncompressed
+        && !containsRawData(obj);
+}
+
+void PdfWriter::writeObjectStreams(OutputStreamDevice& device, const vector<PdfObject*>& objects, PdfXRef& xref)
+{
+    charbuff header;
+    charbuff data;
+    vector<PdfObject*> objStms;
+    for (size_t i = 0; i < objects.size(); i += m_ObjectStreamSize)
+    {
+        // NOTE: Object streams are implicitly referenced with generation
+        // number 0 by the XRef entries, so free object numbers with
+        // an incremented generation can't be reused
+        auto objStm = new PdfObject();
+        objStm->SetIndirectReference(PdfReference(m_Objects->m_ObjectCount + 1, 0));
+        m_Objects->PushObject(objStm);
+        m_objectStreams.push_back(objStm->GetIndirectReference());
+
+        size_t count = std::min((size_t)m_ObjectStreamSize, objects.size() - i);
+        uint32_t objStmNum = objStm->GetIndirectReference().ObjectNumber();
+        header.clear();
+        data.clear();
+        BufferStreamDevice dataDevice(data);
+        for (size_t j = 0; j < count; j++)
+        {
+            // Objects in object streams are not individually
+            // encrypted: the object stream is encrypted instead
+            auto& obj = *objects[i + j];
+            utls::FormatTo(m_buffer, "{} {} ", obj.GetIndirectReference().ObjectNumber(), data.size());
+            header.append(m_buffer);
+            obj.GetVariant().Write(dataDevice, m_WriteFlags, nullptr, m_buffer);
+            dataDevice.Write('\n');
+            obj.ResetDirty();
+            xref.AddCompressedObject(obj.GetIndirectReference(), objStmNum, (unsigned)j);
+        }
+
+        auto& dict = objStm->GetDictionary();
+        dict.AddKey("Type"_n, "ObjStm"_n);
+        dict.AddKey("N"_n, static_cast<int64_t>(count));
+        dict.AddKey("First"_n, static_cast<int64_t>(header.size()));
+        header.append(data);
+        objStm->GetOrCreateStream().SetData(header);
+        objStms.push_back(objStm);
+    }
+
+    writeObjects(device, objStms, xref);
+}
+
+void PdfWriter::removeObjectStreams()
+{
+    // Written object streams are not part of the document. Don't mark
+    // their numbers as free: entries of compressed objects in the
+    // written XRef sections still refer to them
+    for (auto& ref : m_objectStreams)
+        (void)m_Objects->RemoveObject(ref, false);
+
+    m_objectStreams.clear();
+}
+
+void PdfWriter::SetObjectStreamSize(unsigned size)
+{
+    // The index in the object stream is stored in a
+    // 16 bit field of the XRef stream entries
+    if (size == 0 || size > numeric_limits<uint16_t>::max())
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::ValueOutOfRange, "Invalid object stream size");
+
+    m_ObjectStreamSize = size;
+}
+
 void PdfWriter::FillTrailerObject(PdfObject& trailer, size_t size, bool onlySizeKey) const
 {
     trailer.GetDictionary().AddKey("Size"_n, static_cast<int64_t>(size));
@@ -354,3 +710,33 @@ PdfWriteFlags toWriteFlags(PdfSaveOptions opts, PdfALevel pdfaLevel)
 
     return ret;
 }
+
+bool containsRawData(const PdfObject& obj)
+{
+    // NOTE: Don't recurse, to not overflow the
+    // stack with deeply nested direct objects
+    vector<const PdfObject*> stack;
+    stack.push_back(&obj);
+    while (stack.size() != 0)
+    {
+        auto curr = stack.back();
+        stack.pop_back();
+        switch (curr->GetDataType())
+        {
+            case PdfDataType::RawData:
+                return true;
+            case PdfDataType::Dictionary:
+                for (auto& pair : curr->GetDictionary())
+                    stack.push_back(&pair.second);
+                break;
+            case PdfDataType::Array:
+                for (auto& child : curr->GetArray())
+                    stack.push_back(&child);
+                break;
+            default:
+                break;
+        }
+    }
+
+    return false;
+}
@@ -16,6 +16,10 @@ namespace PoDoFo {
 
 class PdfXRef;
 
+/** Default maximum count of objects packed in an object stream
+ */
+constexpr unsigned DefaultObjectStreamSize = 100;
+
 /** The PdfWriter class writes a list of PdfObjects as PDF file.
  *  The XRef section (which is the required table of contents for any
  *  PDF file) is created automatically.
@@ -95,6 +99,14 @@ public:
      */
     inline bool GetUseXRefStream() const { return m_UseXRefStream; }
 
+    /** Set the maximum count of objects packed in each object
+     * stream, when saving with PdfSaveOptions::ObjectStreams
+     * Default is DefaultObjectStreamSize
+     */
+    void SetObjectStreamSize(unsigned size);
+
+    inline unsigned GetObjectStreamSize() const { return m_ObjectStreamSize; }
+
     /** Sets an offset to the previous XRef table. Set it to lower than
      *  or equal to 0, to not write a reference to the previous XRef table.
      *  The default is 0.
@@ -110,6 +122,12 @@ public:
      */
     inline int64_t GetPrevXRefOffset() const { return m_PrevXRefOffset; }
 
+    /**
+     *  \returns offset of the XRef table written by the last call
+     *     to Write(), or -1 if nothing was written yet
+     */
+    inline int64_t GetXRefOffset() const { return m_XRefOffset; }
+
     /** Set whether writing an incremental update.
      *  Default is false.
      *  \param incrementalUpdate if true an incremental update will be written
@@ -168,6 +186,26 @@ protected:
 private:
     void initWriteFlags();
 
+    /** Write only the objects that are dirty, used
+     * for incremental updates not rewriting the XRef table
+     */
+    void writeDirtyObjects(OutputStreamDevice& device, const PdfIndirectObjectList& objects, PdfXRef& xref);
+
+    /** Write the given objects in order, serializing them in
+     * multiple threads when saving with PdfSaveOptions::ParallelWrite
+     */
+    void writeObjects(OutputStreamDevice& device, const std::vector<PdfObject*>& objects, PdfXRef& xref);
+
+    void writeObject(OutputStreamDevice& device, PdfObject& obj, PdfXRef& xref);
+
+    bool isObjectStreamEligible(const PdfObject& obj, PdfXRef& xref) const;
+
+    /** Pack the given objects in object streams and write them
+     */
+    void writeObjectStreams(OutputStreamDevice& device, const std::vector<PdfObject*>& objects, PdfXRef& xref);
+
+    void removeObjectStreams();
+
 protected:
     charbuff m_buffer;
 
@@ -189,8 +227,12 @@ private:
     PdfString m_identifier;
     PdfString m_originalIdentifier; // used for incremental update
     int64_t m_PrevXRefOffset;
+    int64_t m_XRefOffset;
     bool m_IncrementalUpdate;
     bool m_rewriteXRefTable; // Only used if incremental update
+    unsigned m_ObjectStreamSize;
+    bool m_useObjectStreams;
+    std::vector<PdfReference> m_objectStreams; // Object streams created by the last write
 };
 
 };
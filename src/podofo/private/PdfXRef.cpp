@@ -27,31 +27,42 @@ PdfXRef::~PdfXRef() { }
 
 void PdfXRef::AddInUseObject(const PdfReference& ref, nullable<uint64_t> offset)
 {
-    addObject(ref, offset, true);
+    if (offset == nullptr)
+    {
+        // Objects with no offset provided will not be written
+        // in the entry list
+        if (ref.ObjectNumber() > m_maxObjCount)
+            m_maxObjCount = ref.ObjectNumber();
+
+        return;
+    }
+
+    XRefItem item(ref, *offset);
+    addObject(ref, &item);
 }
 
 void PdfXRef::AddFreeObject(const PdfReference& ref)
 {
-    addObject(ref, nullptr, false);
+    addObject(ref, nullptr);
+}
+
+void PdfXRef::AddCompressedObject(const PdfReference& ref, uint32_t streamObjectNum, unsigned index)
+{
+    XRefItem item(ref, streamObjectNum, index);
+    addObject(ref, &item);
 }
 
-void PdfXRef::addObject(const PdfReference& ref, nullable<uint64_t> offset, bool inUse)
+// NOTE: A null item means a free object
+void PdfXRef::addObject(const PdfReference& ref, const XRefItem* item)
 {
     if (ref.ObjectNumber() > m_maxObjCount)
         m_maxObjCount = ref.ObjectNumber();
 
-    if (inUse && offset == nullptr)
-    {
-        // Objects with no offset provided will not be written
-        // in the entry list
-        return;
-    }
-
     bool insertDone = false;
 
     for (auto& block : m_blocks)
     {
-        if (block.InsertItem(ref, offset, inUse))
+        if (block.InsertItem(ref, item))
         {
             insertDone = true;
             break;
@@ -63,8 +74,8 @@ void PdfXRef::addObject(const PdfReference& ref, nullable<uint64_t> offset, bool
         PdfXRefBlock block;
         block.First = ref.ObjectNumber();
         block.Count = 1;
-        if (inUse)
-            block.Items.push_back(XRefItem(ref, offset.value()));
+        if (item != nullptr)
+            block.Items.push_back(*item);
         else
             block.FreeItems.push_back(ref);
 
@@ -129,8 +140,16 @@ void PdfXRef::Write(OutputStreamDevice& device, charbuff& buffer)
                 itFree++;
             }
 
-            this->WriteXRefEntry(device, itItems->Reference,
-                PdfXRefEntry::CreateInUse(itItems->Offset, itItems->Reference.GenerationNumber()), buffer);
+            if (itItems->Compressed)
+            {
+                this->WriteXRefEntry(device, itItems->Reference,
+                    PdfXRefEntry::CreateCompressed((uint32_t)itItems->Offset, itItems->Index), buffer);
+            }
+            else
+            {
+                this->WriteXRefEntry(device, itItems->Reference,
+                    PdfXRefEntry::CreateInUse(itItems->Offset, itItems->Reference.GenerationNumber()), buffer);
+            }
             itItems++;
         }
 
@@ -318,16 +337,15 @@ bool PdfXRef::ShouldSkipWrite(const PdfReference& ref)
     return false;
 }
 
-bool PdfXRef::PdfXRefBlock::InsertItem(const PdfReference& ref, nullable<uint64_t> offset, bool inUse)
+bool PdfXRef::PdfXRefBlock::InsertItem(const PdfReference& ref, const XRefItem* item)
 {
-    PODOFO_ASSERT(!inUse || offset.has_value());
     if (ref.ObjectNumber() == First + Count)
     {
         // Insert at back
         Count++;
 
-        if (inUse)
-            Items.push_back(XRefItem(ref, offset.value()));
+        if (item != nullptr)
+            Items.push_back(*item);
         else
             FreeItems.push_back(ref);
 
@@ -340,8 +358,8 @@ bool PdfXRef::PdfXRefBlock::InsertItem(const PdfReference& ref, nullable<uint64_
         Count++;
 
         // This is known to be slow, but should not occur actually
-        if (inUse)
-            Items.insert(Items.begin(), XRefItem(ref, offset.value()));
+        if (item != nullptr)
+            Items.insert(Items.begin(), *item);
         else
             FreeItems.insert(FreeItems.begin(), ref);
 
@@ -353,9 +371,9 @@ bool PdfXRef::PdfXRefBlock::InsertItem(const PdfReference& ref, nullable<uint64_
         // Insert at back
         Count++;
 
-        if (inUse)
+        if (item != nullptr)
         {
-            Items.push_back(XRefItem(ref, offset.value()));
+            Items.push_back(*item);
             std::sort(Items.begin(), Items.end());
         }
         else
@@ -71,6 +71,12 @@ void PdfXRefStream::WriteXRefEntry(OutputStreamDevice& device, const PdfReferenc
         case PdfXRefEntryType::InUse:
             stmEntry.Variant = AS_BIG_ENDIAN(static_cast<uint32_t>(entry.Offset));
             break;
+        case PdfXRefEntryType::Compressed:
+            // The third field is the index of the object in the object stream
+            stmEntry.Variant = AS_BIG_ENDIAN(static_cast<uint32_t>(entry.ObjectNumber));
+            stmEntry.Generation = AS_BIG_ENDIAN(static_cast<uint16_t>(entry.Index));
+            m_rawEntries.push_back(stmEntry);
+            return;
         default:
             PODOFO_RAISE_ERROR(PdfErrorCode::InvalidEnumValue);
     }
@@ -135,6 +135,24 @@ bool TestUtils::AreFilesEqual(const string_view& filename1, const string_view& f
     return tmp1 == tmp2;
 }
 
+PdfPage& TestUtils::CreateTestObjects(PdfMemDocument& doc, unsigned count,
+    const function<void(PdfObject&, unsigned)>& initObject, vector<PdfReference>* refs)
+{
+    auto& page = doc.GetPages().CreatePage(PdfPageSize::A4);
+    PdfArray arr;
+    for (unsigned i = 0; i < count; i++)
+    {
+        auto& obj = doc.GetObjects().CreateDictionaryObject();
+        initObject(obj, i);
+        if (refs != nullptr)
+            refs->push_back(obj.GetIndirectReference());
+
+        arr.Add(obj.GetIndirectReference());
+    }
+    doc.GetCatalog().GetDictionary().AddKey("Test"_n, arr);
+    return page;
+}
+
 void readTestInputFile(const string_view& filepath, string& str)
 {
 #ifdef _WIN32
@@ -18,6 +18,7 @@
 
 #include <sstream>
 #include <filesystem>
+#include <functional>
 
 /** Check if a suitable error message is returned
  * Asserts that the given expression throws an exception of the specified type
@@ -118,6 +119,16 @@ namespace PoDoFo
         static bool IsBufferEqual(const bufferview& buffer, const std::string_view& filename);
 
         static bool AreFilesEqual(const std::string_view& filename1, const std::string_view& filename2);
+
+        /** Create an A4 page and count indirect objects referenced
+         * by the /Test array of the catalog
+         * \param initObject called on each object with its index
+         * \param refs if not null, receives the references of the objects
+         * \returns the created page
+         */
+        static PdfPage& CreateTestObjects(PdfMemDocument& doc, unsigned count,
+            const std::function<void(PdfObject&, unsigned)>& initObject,
+            std::vector<PdfReference>* refs = nullptr);
     };
 
     template<typename ...Ts>
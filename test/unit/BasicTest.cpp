@@ -70,6 +70,48 @@ TEST_CASE("TestIterations")
     }
 }
 
+TEST_CASE("TestObjectListIterations")
+{
+    PdfMemDocument doc;
+    auto& objects = doc.GetObjects();
+    vector<PdfReference> refs;
+    for (unsigned i = 0; i < 10; i++)
+    {
+        auto& obj = objects.CreateDictionaryObject();
+        if (i % 2 == 0)
+            doc.GetCatalog().GetDictionary().AddKeyIndirect(PdfName(utls::Format("Obj{}", i)), obj);
+
+        refs.push_back(obj.GetIndirectReference());
+    }
+
+    // Unreferenced objects leave holes in the list
+    doc.CollectGarbage();
+    for (unsigned i = 0; i < refs.size(); i++)
+        REQUIRE((objects.GetObject(refs[i]) != nullptr) == (i % 2 == 0));
+
+    // Freed object numbers are reused with the next generation
+    auto freeRef = objects.GetFreeObjects().front();
+    REQUIRE(freeRef.GenerationNumber() == 1);
+    auto& reused = objects.CreateDictionaryObject();
+    REQUIRE(reused.GetIndirectReference() == freeRef);
+    REQUIRE(objects.GetObject(PdfReference(freeRef.ObjectNumber(), 0)) == nullptr);
+    REQUIRE(objects.GetObject(reused.GetIndirectReference()) == &reused);
+
+    vector<PdfReference> iterated;
+    for (auto obj : objects)
+        iterated.push_back(obj->GetIndirectReference());
+
+    REQUIRE(iterated.size() == objects.GetSize());
+    REQUIRE(std::is_sorted(iterated.begin(), iterated.end()));
+
+    vector<PdfReference> reverseIterated;
+    for (auto it = objects.rbegin(); it != objects.rend(); it++)
+        reverseIterated.push_back((*it)->GetIndirectReference());
+
+    std::reverse(reverseIterated.begin(), reverseIterated.end());
+    REQUIRE(reverseIterated == iterated);
+}
+
 TEST_CASE("TestIterations2")
 {
     PdfMemDocument doc;
@@ -166,6 +208,43 @@ TEST_CASE("TestNormalizeRangeRotations")
     ASSERT_EQUAL(utls::NormalizePageRotation(180.5), 270);
 }
 
+TEST_CASE("TestBase64HexCodec")
+{
+    string encoded;
+    utls::WriteBase64To(encoded, "f"sv);
+    REQUIRE(encoded == "Zg==");
+    encoded.clear();
+    utls::WriteBase64To(encoded, "fo"sv);
+    REQUIRE(encoded == "Zm8=");
+    encoded.clear();
+    utls::WriteBase64To(encoded, "foobar"sv);
+    REQUIRE(encoded == "Zm9vYmFy");
+    encoded.clear();
+    utls::WriteBase64To(encoded, "\xfb\xff"sv, true);
+    REQUIRE(encoded == "-_8=");
+
+    char buffer[16];
+    size_t written;
+    REQUIRE(utls::TryDecodeBase64("Zm9vYmFy", buffer, written));
+    REQUIRE(string_view(buffer, written) == "foobar");
+    REQUIRE(utls::TryDecodeBase64("Zm9v\r\nYmE=", buffer, written));
+    REQUIRE(string_view(buffer, written) == "fooba");
+    REQUIRE(utls::TryDecodeBase64("+/8", buffer, written));
+    REQUIRE(string_view(buffer, written) == "\xfb\xff"sv);
+    REQUIRE(utls::TryDecodeBase64("-_8=", buffer, written));
+    REQUIRE(string_view(buffer, written) == "\xfb\xff"sv);
+    REQUIRE(!utls::TryDecodeBase64("Zm9v!", buffer, written));
+    REQUIRE(!utls::TryDecodeBase64("Zg==Zg==", buffer, written));
+    REQUIRE(!utls::TryDecodeBase64("Z", buffer, written));
+    REQUIRE(!utls::TryDecodeBase64("Zm9vYmFy", bufferspan(buffer, 5), written));
+
+    REQUIRE(utls::TryDecodeHex("00fFa1", buffer, written));
+    REQUIRE(string_view(buffer, written) == "\x00\xff\xa1"sv);
+    REQUIRE(!utls::TryDecodeHex("0", buffer, written));
+    REQUIRE(!utls::TryDecodeHex("0g", buffer, written));
+    REQUIRE(utls::GetCharHexString("\x00\xff\xa1"sv, true) == "00ffa1");
+}
+
 TEST_CASE("TestFileSpecAttachment")
 {
     PdfMemDocument doc;
@@ -11,6 +11,9 @@
 using namespace std;
 using namespace PoDoFo;
 
+static int64_t getLastXRefOffset(const bufferview& buffer);
+static int64_t getLastPrevXRefOffset(const bufferview& buffer);
+
 TEST_CASE("TestDevices")
 {
     string_view testString = "Hello World Buffer!";
@@ -49,3 +52,175 @@ TEST_CASE("TestStreamedDocument")
     painter.DrawText("Hello World!", 56.69, page.GetRect().Height - 56.69);
     painter.FinishDrawing();
 }
+
+TEST_CASE("TestAppendStreamDevice")
+{
+    string base = "Hello ";
+    charbuff tail;
+    AppendStreamDevice device(std::make_shared<SpanStreamDevice>(base),
+        std::make_shared<BufferStreamDevice>(tail));
+    REQUIRE(device.GetBaseLength() == 6);
+    REQUIRE(device.GetPosition() == 6);
+    device.Write("World!"sv);
+    REQUIRE(device.GetLength() == 12);
+    REQUIRE(tail == "World!");
+    REQUIRE(base == "Hello ");
+
+    // Reads span across the base and the tail
+    charbuff read(12);
+    device.Seek(0);
+    device.Read(read.data(), read.size());
+    REQUIRE(read == "Hello World!");
+
+    // Overwriting the tail is allowed, overwriting the base is not
+    device.Seek(6);
+    device.Write("w"sv);
+    REQUIRE(tail == "world!");
+    device.Seek(0);
+    ASSERT_THROW_WITH_ERROR_CODE(device.Write("h"sv), PdfErrorCode::IOError);
+}
+
+TEST_CASE("TestSaveUpdateAppendStreamDevice")
+{
+    charbuff base;
+    {
+        PdfMemDocument doc;
+        doc.GetPages().CreatePage(PdfPageSize::A4);
+        BufferStreamDevice device(base);
+        doc.Save(device);
+    }
+
+    charbuff tail;
+    auto device = std::make_shared<AppendStreamDevice>(std::make_shared<SpanStreamDevice>(base),
+        std::make_shared<BufferStreamDevice>(tail));
+    PdfMemDocument doc;
+    doc.Load(device);
+    doc.GetPages().CreatePage(PdfPageSize::A4);
+    doc.SaveUpdate(*device);
+
+    // The signed/updated document is the base followed by the tail
+    REQUIRE(tail.size() != 0);
+    charbuff full = base;
+    full.append(tail);
+    PdfMemDocument updated;
+    updated.LoadFromBuffer(full);
+    REQUIRE(updated.GetPages().GetCount() == 2);
+}
+
+TEST_CASE("TestSaveUpdateChaining")
+{
+    charbuff base;
+    {
+        PdfMemDocument doc;
+        doc.GetPages().CreatePage(PdfPageSize::A4);
+        BufferStreamDevice device(base);
+        doc.Save(device);
+    }
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(base);
+
+    // Updates on different copies of the document all chain
+    // to the revision the document was loaded from
+    charbuff copyA = base;
+    BufferStreamDevice deviceA(copyA);
+    doc.SaveUpdate(deviceA);
+    charbuff copyB = base;
+    BufferStreamDevice deviceB(copyB);
+    doc.SaveUpdate(deviceB);
+    REQUIRE(getLastPrevXRefOffset(copyA) == getLastXRefOffset(base));
+    REQUIRE(getLastPrevXRefOffset(copyB) == getLastXRefOffset(base));
+
+    // A further update on the same device chains to the previous update
+    auto updateOffset = getLastXRefOffset(copyB);
+    doc.SaveUpdate(deviceB);
+    REQUIRE(getLastPrevXRefOffset(copyB) == updateOffset);
+
+    PdfMemDocument updated;
+    updated.LoadFromBuffer(copyB);
+    REQUIRE(updated.GetPages().GetCount() == 1);
+}
+
+TEST_CASE("TestMmapStreamDevice")
+{
+    auto testPath = TestUtils::GetTestOutputFilePath("TestMmapStreamDevice.txt");
+    {
+        FileStreamDevice output(testPath, FileMode::Create);
+        output.Write("Hello World!"sv);
+    }
+
+    {
+        MmapStreamDevice device(testPath);
+        REQUIRE(device.GetLength() == 12);
+        char ch;
+        REQUIRE(device.Peek(ch));
+        REQUIRE(ch == 'H');
+
+        bufferview view;
+        REQUIRE(device.TryGetBufferView(view));
+        REQUIRE(string_view(view.data(), view.size()) == "Hello World!");
+
+        charbuff read(5);
+        device.Seek(6);
+        device.Read(read.data(), read.size());
+        REQUIRE(read == "World");
+        REQUIRE(device.ReadChar() == '!');
+        REQUIRE(device.Eof());
+        ASSERT_THROW_WITH_ERROR_CODE(device.Write("h"sv), PdfErrorCode::InternalLogic);
+    }
+
+    // Empty files can be mapped as well
+    {
+        FileStreamDevice output(testPath, FileMode::Create);
+    }
+    MmapStreamDevice empty(testPath);
+    REQUIRE(empty.GetLength() == 0);
+    REQUIRE(empty.Eof());
+}
+
+TEST_CASE("TestLoadMemoryMap")
+{
+    auto testPath = TestUtils::GetTestOutputFilePath("TestLoadMemoryMap.pdf");
+    {
+        PdfMemDocument doc;
+        doc.GetPages().CreatePage(PdfPageSize::A4);
+        doc.Save(testPath);
+    }
+
+    // Files are read normally by default, so they can be saved over
+    {
+        PdfMemDocument doc;
+        doc.Load(testPath);
+        doc.GetPages().CreatePage(PdfPageSize::A4);
+        doc.Save(testPath);
+    }
+
+    PdfMemDocument doc;
+    doc.Load(testPath, { }, PdfLoadOptions::MemoryMap);
+    REQUIRE(doc.GetPages().GetCount() == 2);
+
+    // A mapped file can't be saved over, but it can be saved elsewhere
+    ASSERT_THROW_WITH_ERROR_CODE(doc.Save(testPath), PdfErrorCode::InvalidHandle);
+    auto copyPath = TestUtils::GetTestOutputFilePath("TestLoadMemoryMapCopy.pdf");
+    doc.Save(copyPath);
+
+    PdfMemDocument copy;
+    copy.Load(copyPath);
+    REQUIRE(copy.GetPages().GetCount() == 2);
+}
+
+int64_t getLastXRefOffset(const bufferview& buffer)
+{
+    string_view view(buffer.data(), buffer.size());
+    auto pos = view.rfind("startxref");
+    REQUIRE(pos != string_view::npos);
+    return std::stoll(string(view.substr(pos + 9)));
+}
+
+int64_t getLastPrevXRefOffset(const bufferview& buffer)
+{
+    string_view view(buffer.data(), buffer.size());
+    auto pos = view.rfind("/Prev ");
+    REQUIRE(pos != string_view::npos);
+    return std::stoll(string(view.substr(pos + 6, 20)));
+}
@@ -101,6 +101,22 @@ TEST_CASE("TestFromEscaped")
     TestFromEscape("Length#20With#20Spaces", "Length With Spaces");
 }
 
+TEST_CASE("TestWellKnownNames")
+{
+    // Well known names share the same data
+    auto name1 = PdfName::FromEscaped("MediaBox");
+    auto name2 = PdfName::FromEscaped("MediaBox");
+    REQUIRE(name1.GetRawData().data() == name2.GetRawData().data());
+    REQUIRE(name1 == name2);
+    REQUIRE(name1 == "MediaBox"_n);
+    REQUIRE(name1.GetString() == "MediaBox");
+    REQUIRE(name1 != "MediaBox2"_n);
+
+    auto name3 = PdfName::FromEscaped("MediaBox2");
+    REQUIRE(name3.GetRawData().data() != name1.GetRawData().data());
+    REQUIRE(name3 == "MediaBox2"_n);
+}
+
 //
 // Test encoding of names.
 // pszString : internal representation, ie unencoded name
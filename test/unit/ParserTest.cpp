@@ -2804,6 +2804,593 @@ TEST_CASE("TestReclaimObjectMemory")
     REQUIRE(!imageObj->TryUnload());
 }
 
+TEST_CASE("TestMemoryBudget")
+{
+    charbuff buffer;
+    vector<PdfReference> refs;
+    {
+        PdfMemDocument doc;
+        TestUtils::CreateTestObjects(doc, 32, [](PdfObject& obj, unsigned i) {
+            obj.GetOrCreateStream().SetData(string(1024, (char)('A' + i % 26)), true);
+        }, &refs);
+
+        BufferStreamDevice device(buffer);
+        doc.Save(device, PdfSaveOptions::NoMetadataUpdate | PdfSaveOptions::NoFlateCompress);
+    }
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    auto& objects = doc.GetObjects();
+    objects.SetMemoryBudget(4096);
+    REQUIRE(objects.GetMemoryBudget() == 4096);
+
+    // Modified objects are never unloaded
+    auto& revised = objects.MustGetObject(refs[0]);
+    revised.GetDictionary().AddKey("Revised"_n, true);
+
+    for (unsigned i = 1; i < refs.size(); i++)
+    {
+        auto& obj = objects.MustGetObject(refs[i]);
+        REQUIRE(obj.MustGetStream().GetCopy() == string(1024, (char)('A' + i % 26)));
+        REQUIRE(objects.GetLoadedObjectsMemory() > 1024);
+        objects.ReclaimMemory();
+        REQUIRE(objects.GetLoadedObjectsMemory() <= 4096);
+    }
+
+    // The least recently used objects have been unloaded
+    REQUIRE(!objects.MustGetObject(refs[1]).IsDelayedLoadDone());
+    REQUIRE(objects.MustGetObject(refs[refs.size() - 1]).IsDelayedLoadDone());
+    REQUIRE(revised.IsDelayedLoadDone());
+    REQUIRE(revised.GetDictionary().HasKey("Revised"));
+
+    // Unloaded objects are transparently loaded again
+    REQUIRE(objects.MustGetObject(refs[1]).MustGetStream().GetCopy() == string(1024, 'B'));
+    REQUIRE(doc.GetPages().GetCount() == 1);
+
+    objects.SetMemoryBudget(0);
+    REQUIRE(objects.GetLoadedObjectsMemory() == 0);
+}
+
+TEST_CASE("TestSaveUpdateDirtyObjects")
+{
+    charbuff base;
+    vector<PdfReference> refs;
+    {
+        PdfMemDocument doc;
+        TestUtils::CreateTestObjects(doc, 16, [](PdfObject& obj, unsigned i) {
+            obj.GetDictionary().AddKey("Index"_n, static_cast<int64_t>(i));
+        }, &refs);
+
+        BufferStreamDevice device(base);
+        doc.Save(device);
+    }
+
+    charbuff tail;
+    auto device = std::make_shared<AppendStreamDevice>(std::make_shared<SpanStreamDevice>(base),
+        std::make_shared<BufferStreamDevice>(tail));
+    PdfMemDocument doc;
+    doc.Load(device);
+    auto& objects = doc.GetObjects();
+    objects.MustGetObject(refs[3]).GetDictionary().AddKey("Revised"_n, true);
+    auto& unreferenced = objects.CreateDictionaryObject();
+    doc.SaveUpdate(*device, PdfSaveOptions::NoMetadataUpdate);
+
+    // Untouched objects are neither loaded nor written, and
+    // unreferenced objects are not collected
+    for (unsigned i = 0; i < refs.size(); i++)
+        REQUIRE(objects.MustGetObject(refs[i]).IsDelayedLoadDone() == (i == 3));
+    REQUIRE(objects.GetObject(unreferenced.GetIndirectReference()) != nullptr);
+    REQUIRE(!objects.MustGetObject(refs[3]).IsDirty());
+
+    string_view update(tail.data(), tail.size());
+    REQUIRE(update.find(utls::Format("{} 0 obj", refs[3].ObjectNumber())) != string_view::npos);
+    REQUIRE(update.find(utls::Format("{} 0 obj", refs[4].ObjectNumber())) == string_view::npos);
+
+    charbuff full = base;
+    full.append(tail);
+    PdfMemDocument updated;
+    updated.LoadFromBuffer(full);
+    REQUIRE(updated.GetObjects().MustGetObject(refs[3]).GetDictionary().HasKey("Revised"));
+    REQUIRE(updated.GetObjects().MustGetObject(refs[4]).GetDictionary().MustFindKey("Index").GetNumber() == 4);
+}
+
+TEST_CASE("TestSaveObjectStreams")
+{
+    auto createDocument = [](PdfMemDocument& doc, vector<PdfReference>& refs) {
+        TestUtils::CreateTestObjects(doc, 250, [](PdfObject& obj, unsigned i) {
+            obj.GetDictionary().AddKey("Index"_n, static_cast<int64_t>(i));
+            obj.GetDictionary().AddKey("Text"_n, PdfString("Object stream test"));
+        }, &refs);
+    };
+
+    auto checkDocument = [](PdfMemDocument& doc, const vector<PdfReference>& refs) {
+        REQUIRE(doc.GetPages().GetCount() == 1);
+        for (unsigned i = 0; i < refs.size(); i++)
+        {
+            auto& dict = doc.GetObjects().MustGetObject(refs[i]).GetDictionary();
+            REQUIRE(dict.MustFindKey("Index").GetNumber() == i);
+            REQUIRE(dict.MustFindKey("Text").GetString() == "Object stream test");
+        }
+    };
+
+    charbuff plain;
+    charbuff packed;
+    vector<PdfReference> refs;
+    {
+        PdfMemDocument doc;
+        createDocument(doc, refs);
+        BufferStreamDevice plainDevice(plain);
+        doc.Save(plainDevice, PdfSaveOptions::NoMetadataUpdate);
+        doc.SetObjectStreamSize(100);
+        BufferStreamDevice packedDevice(packed);
+        doc.Save(packedDevice, PdfSaveOptions::NoMetadataUpdate | PdfSaveOptions::ObjectStreams);
+
+        // Written object streams are not kept in the document
+        for (auto obj : doc.GetObjects())
+        {
+            const PdfDictionary* dict;
+            PdfName type;
+            REQUIRE(!(obj->TryGetDictionary(dict) && dict->TryFindKeyAs("Type", type) && type == "ObjStm"));
+        }
+    }
+
+    REQUIRE(packed.size() < plain.size() / 2);
+    REQUIRE(string_view(packed.data(), packed.size()).find("/XRef") != string_view::npos);
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(packed);
+    checkDocument(doc, refs);
+
+    // Incremental updates pack the changed objects in new object streams
+    charbuff tail;
+    {
+        auto device = std::make_shared<AppendStreamDevice>(std::make_shared<SpanStreamDevice>(packed),
+            std::make_shared<BufferStreamDevice>(tail));
+        PdfMemDocument updated;
+        updated.Load(device);
+        updated.GetObjects().MustGetObject(refs[10]).GetDictionary().AddKey("Revised"_n, true);
+        updated.SaveUpdate(*device, PdfSaveOptions::NoMetadataUpdate | PdfSaveOptions::ObjectStreams);
+    }
+
+    REQUIRE(string_view(tail.data(), tail.size()).find(utls::Format("{} 0 obj", refs[10].ObjectNumber())) == string_view::npos);
+    charbuff full = packed;
+    full.append(tail);
+    doc.LoadFromBuffer(full);
+    checkDocument(doc, refs);
+    REQUIRE(doc.GetObjects().MustGetObject(refs[10]).GetDictionary().HasKey("Revised"));
+
+    // Objects in encrypted object streams are not encrypted individually
+    charbuff encrypted;
+    {
+        PdfMemDocument encdoc;
+        refs.clear();
+        createDocument(encdoc, refs);
+        encdoc.SetEncrypted("user", "owner");
+        BufferStreamDevice device(encrypted);
+        encdoc.Save(device, PdfSaveOptions::NoMetadataUpdate | PdfSaveOptions::ObjectStreams);
+    }
+
+    doc.LoadFromBuffer(encrypted, "user");
+    checkDocument(doc, refs);
+}
+
+TEST_CASE("TestSaveParallelWrite")
+{
+    charbuff source;
+    vector<PdfReference> refs;
+    {
+        PdfMemDocument doc;
+        TestUtils::CreateTestObjects(doc, 300, [](PdfObject& obj, unsigned i) {
+            string data;
+            for (unsigned j = 0; j < 50; j++)
+                data.append(utls::Format("Parallel write test {} {}\n", i, j));
+
+            obj.GetOrCreateStream().SetData(data);
+        }, &refs);
+
+        BufferStreamDevice device(source);
+        doc.Save(device, PdfSaveOptions::NoMetadataUpdate | PdfSaveOptions::NoFlateCompress);
+    }
+
+    auto save = [&source](PdfSaveOptions opts) {
+        // Objects are loaded on demand while writing
+        charbuff buffer;
+        PdfMemDocument doc;
+        doc.LoadFromBuffer(source);
+        BufferStreamDevice device(buffer);
+        doc.Save(device, PdfSaveOptions::NoMetadataUpdate | opts);
+        return buffer;
+    };
+
+    auto checkDocument = [](PdfMemDocument& doc, const vector<PdfReference>& refs) {
+        for (unsigned i = 0; i < refs.size(); i++)
+        {
+            auto& stream = doc.GetObjects().MustGetObject(refs[i]).MustGetStream();
+            REQUIRE(stream.GetFilters().size() == 1);
+            auto data = stream.GetCopy();
+            REQUIRE(string_view(data.data(), data.size()).find(utls::Format("Parallel write test {} 49\n", i)) != string_view::npos);
+        }
+    };
+
+    // The output is identical to the serial writer one
+    auto serial = save(PdfSaveOptions::None);
+    auto parallel = save(PdfSaveOptions::ParallelWrite);
+    REQUIRE(parallel == serial);
+    REQUIRE(save(PdfSaveOptions::ParallelWrite | PdfSaveOptions::ObjectStreams)
+        == save(PdfSaveOptions::ObjectStreams));
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(parallel);
+    checkDocument(doc, refs);
+
+    // Each thread encrypts with its own context
+    charbuff encrypted;
+    {
+        PdfMemDocument encdoc;
+        encdoc.LoadFromBuffer(source);
+        encdoc.SetEncrypted("user", "owner");
+        BufferStreamDevice device(encrypted);
+        encdoc.Save(device, PdfSaveOptions::NoMetadataUpdate | PdfSaveOptions::ParallelWrite);
+    }
+
+    doc.LoadFromBuffer(encrypted, "user");
+    checkDocument(doc, refs);
+}
+
+TEST_CASE("TestRawStreamView")
+{
+    charbuff buffer;
+    PdfReference streamRef;
+    PdfReference dictRef;
+    string data = "Raw stream data";
+    {
+        PdfMemDocument doc;
+        doc.GetPages().CreatePage(PdfPageSize::A4);
+        auto& streamObj = doc.GetObjects().CreateDictionaryObject();
+        streamObj.GetOrCreateStream().SetData(data, true);
+        streamRef = streamObj.GetIndirectReference();
+        auto& dictObj = doc.GetObjects().CreateDictionaryObject();
+        dictRef = dictObj.GetIndirectReference();
+        doc.GetCatalog().GetDictionary().AddKeyIndirect("Stream"_n, streamObj);
+        doc.GetCatalog().GetDictionary().AddKeyIndirect("Dict"_n, dictObj);
+
+        BufferStreamDevice device(buffer);
+        doc.Save(device, PdfSaveOptions::NoMetadataUpdate | PdfSaveOptions::NoFlateCompress);
+    }
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    bufferview view;
+    REQUIRE(!doc.GetObjects().MustGetObject(dictRef).TryGetRawStreamView(view));
+
+    // The view points to the source buffer and the stream is not loaded
+    auto& obj = doc.GetObjects().MustGetObject(streamRef);
+    REQUIRE(obj.TryGetRawStreamView(view));
+    REQUIRE(string_view(view.data(), view.size()) == data);
+    REQUIRE(view.data() >= buffer.data());
+    REQUIRE(view.data() + view.size() <= buffer.data() + buffer.size());
+    REQUIRE(!obj.IsDelayedLoadStreamDone());
+
+    // Streams already loaded are served from memory
+    string newData = "New data";
+    obj.MustGetStream().SetData(newData, true);
+    REQUIRE(obj.TryGetRawStreamView(view));
+    REQUIRE(string_view(view.data(), view.size()) == newData);
+}
+
+TEST_CASE("TestLoadCompressedObjectsOnDemand")
+{
+    // Objects 1, 2 and 4 are stored in the unfiltered object stream 5
+    string obj1 = "<</Type/Catalog/Pages 2 0 R>>";
+    string obj2 = "<</Type/Pages/Kids[3 0 R]/Count 1>>";
+    string obj4 = "[1 2 3]";
+    string header = utls::Format("1 0 2 {} 4 {} ", obj1.size() + 1, obj1.size() + obj2.size() + 2);
+    string objStmData = header + obj1 + " " + obj2 + " " + obj4;
+
+    ostringstream oss;
+    oss << "%PDF-1.5\n";
+    size_t offset3 = (size_t)oss.tellp();
+    oss << "3 0 obj<</Type/Page/Parent 2 0 R/MediaBox[0 0 3 3]>>endobj\n";
+    size_t offset5 = (size_t)oss.tellp();
+    oss << "5 0 obj<</Type/ObjStm/N 3/First " << header.size() << "/Length " << objStmData.size() << ">>stream\n"
+        << objStmData << "\nendstream endobj\n";
+    size_t offset6 = (size_t)oss.tellp();
+    oss << "6 0 obj<</Type/XRef/Size 7/W[1 4 2]/Root 1 0 R/Length 49>>stream\n";
+    auto writeEntry = [&oss](unsigned type, uint32_t field2, uint16_t field3) {
+        oss.put((char)type);
+        for (int i = 3; i >= 0; i--)
+            oss.put((char)((field2 >> (i * 8)) & 0xFF));
+        oss.put((char)(field3 >> 8));
+        oss.put((char)(field3 & 0xFF));
+    };
+    writeEntry(0, 0, 0xFFFF);
+    writeEntry(2, 5, 0);
+    writeEntry(2, 5, 1);
+    writeEntry(1, (uint32_t)offset3, 0);
+    writeEntry(2, 5, 2);
+    writeEntry(1, (uint32_t)offset5, 0);
+    writeEntry(1, (uint32_t)offset6, 0);
+    oss << "\nendstream endobj\nstartxref\n" << offset6 << "\n%%EOF";
+
+    auto buffer = oss.str();
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    REQUIRE(doc.GetPages().GetCount() == 1);
+
+    // The compressed object is read only on first access
+    auto obj = doc.GetObjects().GetObject(PdfReference(4, 0));
+    REQUIRE(obj != nullptr);
+    REQUIRE(!obj->IsDelayedLoadDone());
+    REQUIRE(obj->GetArray().GetSize() == 3);
+    REQUIRE(obj->IsDelayedLoadDone());
+
+    // Unmodified compressed objects can be unloaded and read again
+    REQUIRE(obj->TryUnload());
+    REQUIRE(!obj->IsDelayedLoadDone());
+    REQUIRE(obj->GetArray().MustFindAt(2).GetNumber() == 3);
+    obj->GetArray().Add(PdfObject(static_cast<int64_t>(4)));
+    REQUIRE(!obj->TryUnload());
+
+    // The object stream contents are found also when the
+    // xref stream can't be located
+    string damaged = buffer.substr(0, offset6) + "%%EOF";
+    PdfMemDocument rebuiltDoc;
+    rebuiltDoc.LoadFromBuffer(damaged);
+    REQUIRE(rebuiltDoc.GetPages().GetCount() == 1);
+    REQUIRE(rebuiltDoc.GetObjects().MustGetObject(PdfReference(4, 0)).GetArray().GetSize() == 3);
+
+    // Compressed objects are read immediately on full loads
+    for (auto opts : { PdfLoadOptions::LoadAll, PdfLoadOptions::LoadAll | PdfLoadOptions::ParallelLoad })
+    {
+        PdfMemDocument fullDoc;
+        fullDoc.LoadFromBuffer(buffer, { }, opts);
+        REQUIRE(fullDoc.GetPages().GetCount() == 1);
+        REQUIRE(fullDoc.GetObjects().MustGetObject(PdfReference(4, 0)).GetArray().GetSize() == 3);
+    }
+}
+
+TEST_CASE("TestRebuildXRefTable")
+{
+    charbuff buffer;
+    {
+        PdfMemDocument doc;
+        doc.GetPages().CreatePage(PdfPageSize::A4);
+        doc.GetPages().CreatePage(PdfPageSize::A4);
+        auto& obj = doc.GetObjects().CreateDictionaryObject();
+        obj.GetDictionary().AddKey("Test"_n, PdfString("Value"));
+        doc.GetCatalog().GetDictionary().AddKeyIndirect("Test"_n, obj);
+        BufferStreamDevice device(buffer);
+        doc.Save(device, PdfSaveOptions::NoMetadataUpdate);
+    }
+
+    auto checkDocument = [](const string_view& buffer) {
+        PdfMemDocument doc;
+        doc.LoadFromBuffer(buffer);
+        REQUIRE(doc.GetPages().GetCount() == 2);
+        REQUIRE(doc.GetCatalog().GetDictionary().MustFindKey("Test").GetDictionary()
+            .MustFindKey("Test").GetString().GetString() == "Value");
+    };
+
+    string_view contents(buffer.data(), buffer.size());
+    size_t startxrefPos = contents.rfind("startxref");
+    REQUIRE(startxrefPos != string_view::npos);
+
+    // Wrong startxref offset
+    string damaged(contents.substr(0, startxrefPos));
+    damaged.append("startxref\n12\n%%EOF\n");
+    checkDocument(damaged);
+
+    // Missing xref table, trailer and startxref: the catalog is found by scanning
+    damaged = contents.substr(0, contents.rfind("xref", startxrefPos - 1));
+    checkDocument(damaged);
+
+    // Strict parsing doesn't attempt to rebuild the xref table
+    PdfMemDocument doc;
+    PdfParser parser(doc.GetObjects());
+    parser.SetStrictParsing(true);
+    SpanStreamDevice device(damaged);
+    ASSERT_THROW_WITH_ERROR_CODE(parser.Parse(device, true), PdfErrorCode::InvalidEOFToken);
+}
+
+TEST_CASE("TestXRefIndex")
+{
+    charbuff buffer;
+    {
+        PdfMemDocument doc;
+        doc.GetPages().CreatePage(PdfPageSize::A4);
+        auto& obj = doc.GetObjects().CreateDictionaryObject();
+        obj.GetDictionary().AddKey("Test"_n, PdfString("Value"));
+        doc.GetCatalog().GetDictionary().AddKeyIndirect("Test"_n, obj);
+        BufferStreamDevice device(buffer);
+        doc.Save(device, PdfSaveOptions::NoMetadataUpdate);
+    }
+
+    charbuff index;
+    SpanStreamDevice device(buffer);
+    {
+        PdfMemDocument doc;
+        PdfParser parser(doc.GetObjects());
+        parser.Parse(device, true);
+        REQUIRE(!parser.IsIndexUsed());
+        BufferStreamDevice indexDevice(index);
+        parser.WriteIndex(device, indexDevice);
+    }
+
+    {
+        PdfMemDocument doc;
+        PdfParser parser(doc.GetObjects());
+        parser.SetIndex(index);
+        parser.Parse(device, true);
+        REQUIRE(parser.IsIndexUsed());
+        REQUIRE(parser.GetObjects()->GetSize() == 5);
+        REQUIRE(parser.GetTrailer().GetDictionary().MustFindKey("Root").GetDictionary()
+            .MustFindKey("Test").GetDictionary().MustFindKey("Test").GetString().GetString() == "Value");
+    }
+
+    {
+        // The index guard doesn't match a different file
+        auto modified = buffer;
+        modified.append("\n");
+        SpanStreamDevice modifiedDevice(modified);
+        PdfMemDocument doc;
+        PdfParser parser(doc.GetObjects());
+        parser.SetIndex(index);
+        parser.Parse(modifiedDevice, true);
+        REQUIRE(!parser.IsIndexUsed());
+    }
+
+    {
+        // A corrupted index with counts exceeding its size is rejected
+        // before allocating, and the document structure is read instead
+        size_t entryCount;
+        string trailer;
+        {
+            PdfMemDocument doc;
+            PdfParser parser(doc.GetObjects());
+            parser.Parse(device, true);
+            entryCount = parser.GetXRefEntries().GetSize();
+            parser.GetTrailer().GetVariant().ToString(trailer);
+        }
+
+        size_t trailerLengthOffset = index.size() - trailer.size() - 4;
+        size_t entryCountOffset = trailerLengthOffset - entryCount * 14 - 4;
+        auto parseCorrupted = [&](size_t offset, uint32_t value) {
+            auto corrupted = index;
+            for (unsigned i = 0; i < 4; i++)
+                corrupted[offset + i] = (char)((value >> (24 - i * 8)) & 0xFF);
+
+            PdfMemDocument doc;
+            PdfParser parser(doc.GetObjects());
+            parser.SetIndex(corrupted);
+            parser.Parse(device, true);
+            REQUIRE(!parser.IsIndexUsed());
+            REQUIRE(parser.GetObjects()->GetSize() == 5);
+        };
+
+        parseCorrupted(entryCountOffset, 0xFFFFFFFF);
+        parseCorrupted(entryCountOffset, (uint32_t)entryCount + 1000);
+        parseCorrupted(trailerLengthOffset, 0xFFFFFFFF);
+        parseCorrupted(trailerLengthOffset, (uint32_t)trailer.size() + 1);
+    }
+
+    // The index file is created on first load and used by later ones
+    auto testPath = TestUtils::GetTestOutputFilePath("TestXRefIndex.pdf");
+    utls::WriteTo(testPath, buffer);
+    auto indexPath = testPath + ".xrefidx";
+    fs::remove(fs::u8path(indexPath));
+    for (unsigned i = 0; i < 2; i++)
+    {
+        PdfMemDocument doc;
+        doc.Load(testPath, { }, PdfLoadOptions::XRefIndex);
+        REQUIRE(fs::exists(fs::u8path(indexPath)));
+        REQUIRE(doc.GetPages().GetCount() == 1);
+        REQUIRE(doc.GetCatalog().GetDictionary().MustFindKey("Test").GetDictionary()
+            .MustFindKey("Test").GetString().GetString() == "Value");
+    }
+}
+
+TEST_CASE("TestParallelLoad")
+{
+    charbuff buffer;
+    {
+        PdfMemDocument doc;
+        doc.GetPages().CreatePage(PdfPageSize::A4);
+        for (unsigned i = 0; i < 1000; i++)
+        {
+            auto& obj = doc.GetObjects().CreateDictionaryObject();
+            obj.GetDictionary().AddKey("Index"_n, static_cast<int64_t>(i));
+            obj.GetDictionary().AddKey("Name"_n, PdfString(utls::Format("Object {}", i)));
+            if (i % 4 == 0)
+                obj.GetOrCreateStream().SetData(utls::Format("Stream data {}", i));
+        }
+
+        BufferStreamDevice device(buffer);
+        doc.Save(device, PdfSaveOptions::NoMetadataUpdate);
+    }
+
+    PdfMemDocument serialDoc;
+    serialDoc.LoadFromBuffer(buffer, { }, PdfLoadOptions::LoadAll);
+    PdfMemDocument parallelDoc;
+    parallelDoc.LoadFromBuffer(buffer, { }, PdfLoadOptions::LoadAll | PdfLoadOptions::ParallelLoad);
+
+    REQUIRE(parallelDoc.GetObjects().GetSize() == serialDoc.GetObjects().GetSize());
+    for (auto obj : serialDoc.GetObjects())
+    {
+        auto parallelObj = parallelDoc.GetObjects().GetObject(obj->GetIndirectReference());
+        REQUIRE(parallelObj != nullptr);
+        REQUIRE(parallelObj->IsDelayedLoadDone());
+        REQUIRE(parallelObj->ToString() == obj->ToString());
+        if (obj->HasStream())
+        {
+            REQUIRE(parallelObj->HasStream());
+            REQUIRE(parallelObj->MustGetStream().GetCopy() == obj->MustGetStream().GetCopy());
+        }
+    }
+}
+
+TEST_CASE("TestCollectGarbage")
+{
+    constexpr unsigned ChainLength = 20000;
+    charbuff buffer;
+    vector<PdfReference> reachable;
+    vector<PdfReference> unreachable;
+    PdfReference streamRef;
+    {
+        PdfMemDocument doc;
+
+        // A wide level of objects, which is scanned in parallel
+        TestUtils::CreateTestObjects(doc, 2000, [](PdfObject& obj, unsigned i) {
+            obj.GetDictionary().AddKey("Index"_n, static_cast<int64_t>(i));
+        }, &reachable);
+
+        // A long chain of objects, like a flat outline
+        PdfObject* prev = &doc.GetCatalog().GetObject();
+        for (unsigned i = 0; i < ChainLength; i++)
+        {
+            auto& obj = doc.GetObjects().CreateDictionaryObject();
+            if (i % 100 == 0)
+                obj.GetOrCreateStream().SetData(utls::Format("Stream data {}", i));
+
+            if (i == ChainLength - 100)
+                streamRef = obj.GetIndirectReference();
+
+            prev->GetDictionary().AddKeyIndirect("Next"_n, obj);
+            reachable.push_back(obj.GetIndirectReference());
+            prev = &obj;
+        }
+
+        for (unsigned i = 0; i < 1000; i++)
+        {
+            auto& obj = doc.GetObjects().CreateDictionaryObject();
+            obj.GetDictionary().AddKey("Next"_n, PdfReference(reachable[i].ObjectNumber(), 0));
+            unreachable.push_back(obj.GetIndirectReference());
+        }
+
+        BufferStreamDevice device(buffer);
+        doc.Save(device, PdfSaveOptions::NoMetadataUpdate | PdfSaveOptions::NoCollectGarbage);
+    }
+
+    for (bool parallel : { false, true })
+    {
+        PdfMemDocument doc;
+        doc.LoadFromBuffer(buffer);
+        auto& objects = doc.GetObjects();
+        objects.CollectGarbage(parallel);
+        for (auto& ref : unreachable)
+            REQUIRE(objects.GetObject(ref) == nullptr);
+
+        // Unloaded objects are scanned without being loaded
+        for (auto& ref : reachable)
+        {
+            auto obj = objects.GetObject(ref);
+            REQUIRE(obj != nullptr);
+            REQUIRE(!obj->IsDelayedLoadDone());
+        }
+
+        REQUIRE(objects.MustGetObject(streamRef).MustGetStream().GetCopy() == utls::Format("Stream data {}", ChainLength - 100));
+    }
+}
+
 
 string generateXRefEntries(size_t count)
 {
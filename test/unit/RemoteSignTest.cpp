@@ -0,0 +1,757 @@
+/**
+ * SPDX-License-Identifier: MIT-0
+ */
+
+#include <PdfTest.h>
+#include <podofo/private/OpenSSLInternal.h>
+#include <podofo/main/PdfRemoteSignBatchSession.h>
+#include <podofo/main/PdfRemoteSignPipeline.h>
+#include <podofo/main/PdfValidationMaterialCache.h>
+#include <openssl/ts.h>
+#include <openssl/x509v3.h>
+
+using namespace std;
+using namespace PoDoFo;
+
+constexpr const char* Sha256Oid = "2.16.840.1.101.3.4.2.1";
+
+static string createInputDocument(const string_view& name);
+static string getCertificateBase64();
+static string signHash(const string& urlEncodedHash);
+static charbuff decodeBase64(const string_view& base64);
+static string createTimestampResponse(const bufferview& digest, unsigned certificateCount = 1);
+static size_t getTimestampTokenSize(const string& base64Tsr);
+static X509* createCertificate(EVP_PKEY* key, const char* name, long validity = 3600);
+static charbuff createCertificateDer(const char* name, long validity);
+static void readSignature(const string& filepath, const string_view& fieldName,
+    charbuff& signedData, charbuff& contents);
+static void verifySignature(const string& filepath, const string_view& fieldName);
+static void verifyDocTimeStamp(const string& filepath, const string_view& fieldName);
+static vector<size_t> getRevisionXRefOffsets(const bufferview& buffer);
+
+TEST_CASE("TestRemoteSignBatch")
+{
+    vector<DocumentConfig> documents;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        auto name = "TestRemoteSignBatch" + std::to_string(i);
+        documents.push_back({ createInputDocument(name),
+            TestUtils::GetTestOutputFilePath(name + ".pdf"), "ADES_B_B" });
+    }
+
+    PdfRemoteSignBatchSession session(documents, Sha256Oid, getCertificateBase64(), { }, nullopt, nullopt, 2);
+    REQUIRE(session.documentCount() == 3);
+
+    auto begun = session.beginSigning();
+    REQUIRE(begun.size() == 3);
+    vector<string> signedHashes;
+    for (auto& result : begun)
+    {
+        REQUIRE(result.succeeded());
+        signedHashes.push_back(signHash(result.hash));
+    }
+
+    auto finished = session.finishSigning(signedHashes);
+    REQUIRE(finished.size() == 3);
+    for (unsigned i = 0; i < 3; i++)
+    {
+        REQUIRE(finished[i].succeeded());
+        verifySignature(documents[i].document_output_path, "Signature");
+    }
+}
+
+TEST_CASE("TestRemoteSignBatchPartialFailure")
+{
+    vector<DocumentConfig> documents = {
+        { createInputDocument("TestRemoteSignBatchPartial0"),
+            TestUtils::GetTestOutputFilePath("TestRemoteSignBatchPartial0.pdf"), "ADES_B_B" },
+        { TestUtils::GetTestOutputFilePath("TestRemoteSignBatchMissing-input.pdf"),
+            TestUtils::GetTestOutputFilePath("TestRemoteSignBatchMissing.pdf"), "ADES_B_B" },
+        { createInputDocument("TestRemoteSignBatchPartial2"),
+            TestUtils::GetTestOutputFilePath("TestRemoteSignBatchPartial2.pdf"), "ADES_B_B" },
+    };
+    fs::remove(fs::u8path(documents[1].document_input_path));
+
+    PdfRemoteSignBatchSession session(documents, Sha256Oid, getCertificateBase64(), { });
+
+    // The failure of a document must not affect the others
+    auto begun = session.beginSigning();
+    REQUIRE(begun.size() == 3);
+    REQUIRE(begun[0].succeeded());
+    REQUIRE(!begun[1].succeeded());
+    REQUIRE(begun[1].hash.empty());
+    REQUIRE(begun[2].succeeded());
+
+    // The entry of the failed document is ignored
+    auto finished = session.finishSigning({ signHash(begun[0].hash), string(), signHash(begun[2].hash) });
+    REQUIRE(finished.size() == 3);
+    REQUIRE(finished[0].succeeded());
+    REQUIRE(!finished[1].succeeded());
+    REQUIRE(finished[2].succeeded());
+    verifySignature(documents[0].document_output_path, "Signature");
+    verifySignature(documents[2].document_output_path, "Signature");
+}
+
+TEST_CASE("TestRemoteSignBatchCountMismatch")
+{
+    vector<DocumentConfig> documents;
+    for (unsigned i = 0; i < 2; i++)
+    {
+        auto name = "TestRemoteSignBatchMismatch" + std::to_string(i);
+        documents.push_back({ createInputDocument(name),
+            TestUtils::GetTestOutputFilePath(name + ".pdf"), "ADES_B_B" });
+    }
+
+    PdfRemoteSignBatchSession session(documents, Sha256Oid, getCertificateBase64(), { });
+    auto begun = session.beginSigning();
+    REQUIRE(begun.size() == 2);
+    vector<string> signedHashes = { signHash(begun[0].hash), signHash(begun[1].hash) };
+
+    // Less signed values than documents
+    REQUIRE_THROWS_AS(session.finishSigning({ signedHashes[0] }), runtime_error);
+
+    // Timestamp responses must be either none or one per document
+    REQUIRE_THROWS_AS(session.finishSigning(signedHashes, { string() }), runtime_error);
+
+    // A rejected call doesn't consume the prepared documents
+    auto finished = session.finishSigning(signedHashes);
+    REQUIRE(finished[0].succeeded());
+    REQUIRE(finished[1].succeeded());
+    verifySignature(documents[0].document_output_path, "Signature");
+    verifySignature(documents[1].document_output_path, "Signature");
+}
+
+TEST_CASE("TestRemoteSignExportImportState")
+{
+    auto inputPath = createInputDocument("TestRemoteSignState");
+    auto outputPath = TestUtils::GetTestOutputFilePath("TestRemoteSignState.pdf");
+    auto cert = getCertificateBase64();
+
+    auto beginSigning = [&](string& hash) -> string
+    {
+        PdfRemoteSignDocumentSession session("ADES_B_B", Sha256Oid, inputPath, outputPath, cert, { });
+        hash = session.beginSigning();
+        return session.exportState();
+    };
+
+    SECTION("Round trip")
+    {
+        // Drop the session that began the signing, as if it was in another process
+        string hash;
+        auto state = beginSigning(hash);
+
+        PdfRemoteSignDocumentSession session("ADES_B_B", Sha256Oid, inputPath, outputPath, cert, { });
+        session.importState(state);
+        session.finishSigning(signHash(hash), { });
+        verifySignature(outputPath, "Signature");
+    }
+
+    SECTION("Wrong reserved size")
+    {
+        string hash;
+        auto state = beginSigning(hash);
+        size_t pos = state.find("/ContentsSize ") + char_traits<char>::length("/ContentsSize ");
+        size_t end = state.find_first_not_of("0123456789", pos);
+        auto size = std::stoul(state.substr(pos, end - pos));
+        state.replace(pos, end - pos, std::to_string(size - 1));
+
+        PdfRemoteSignDocumentSession session("ADES_B_B", Sha256Oid, inputPath, outputPath, cert, { });
+        REQUIRE_THROWS_AS(session.importState(state), runtime_error);
+    }
+
+    SECTION("Modified /Contents")
+    {
+        string hash;
+        auto state = beginSigning(hash);
+        size_t pos = state.find("/ContentsOffset ") + char_traits<char>::length("/ContentsOffset ");
+        auto offset = std::stoul(state.substr(pos, state.find_first_not_of("0123456789", pos) - pos));
+        {
+            FileStreamDevice output(outputPath, FileMode::Open);
+            output.Seek(offset + 10);
+            output.Write("00");
+        }
+
+        PdfRemoteSignDocumentSession session("ADES_B_B", Sha256Oid, inputPath, outputPath, cert, { });
+        REQUIRE_THROWS_AS(session.importState(state), runtime_error);
+    }
+}
+
+TEST_CASE("TestRemoteSignDSSUpdate")
+{
+    auto inputPath = createInputDocument("TestRemoteSignDSSUpdate");
+    auto outputPath = TestUtils::GetTestOutputFilePath("TestRemoteSignDSSUpdate.pdf");
+    auto cert = getCertificateBase64();
+
+    PdfRemoteSignDocumentSession session("ADES_B_LT", Sha256Oid, inputPath, outputPath, cert, { });
+    auto signedHash = signHash(session.beginSigning());
+    session.finishSigning(signedHash, createTimestampResponse(
+        ssl::ComputeHash(decodeBase64(signedHash), PdfHashingAlgorithm::SHA256)), ValidationData({ cert }));
+
+    // The DSS is a further revision, chained to the signed one
+    charbuff buffer;
+    utls::ReadTo(buffer, outputPath);
+    auto xrefOffsets = getRevisionXRefOffsets(buffer);
+    REQUIRE(xrefOffsets.size() == 3);
+    for (unsigned i = 1; i < 3; i++)
+    {
+        auto prev = "/Prev " + std::to_string(xrefOffsets[i - 1]);
+        size_t trailerEnd = buffer.find("startxref", xrefOffsets[i]);
+        REQUIRE(buffer.find(prev, xrefOffsets[i]) < trailerEnd);
+    }
+
+    // The document reloads with the DSS and the signature is still valid
+    PdfMemDocument doc;
+    doc.Load(outputPath);
+    auto& dss = doc.GetCatalog().GetDictionary().MustFindKey("DSS").GetDictionary();
+    REQUIRE(dss.MustFindKey("Certs").GetArray().size() == 1);
+    verifySignature(outputPath, "Signature");
+}
+
+TEST_CASE("TestRemoteSignDocTimeStamp")
+{
+    auto inputPath = createInputDocument("TestRemoteSignDocTimeStamp");
+    auto outputPath = TestUtils::GetTestOutputFilePath("TestRemoteSignDocTimeStamp.pdf");
+    auto cert = getCertificateBase64();
+
+    PdfRemoteSignDocumentSession session("ADES_B_LTA", Sha256Oid, inputPath, outputPath, cert, { });
+    auto signedHash = signHash(session.beginSigning());
+    session.finishSigning(signedHash, createTimestampResponse(
+        ssl::ComputeHash(decodeBase64(signedHash), PdfHashingAlgorithm::SHA256)));
+
+    // The LTA step returns the digest of the ByteRange of the DocTimeStamp
+    auto digest = decodeBase64(session.beginSigningLTA());
+    REQUIRE(digest.size() == 32);
+    session.finishSigningLTA(createTimestampResponse(digest), nullopt);
+
+    verifySignature(outputPath, "Signature");
+    verifyDocTimeStamp(outputPath, "Signature2");
+}
+
+TEST_CASE("TestRemoteSignDocTimeStampTokenSize")
+{
+    auto inputPath = createInputDocument("TestRemoteSignDocTimeStampTokenSize");
+    auto outputPath = TestUtils::GetTestOutputFilePath("TestRemoteSignDocTimeStampTokenSize.pdf");
+    auto cert = getCertificateBase64();
+
+    // The token of the signature time stamp has no certificates,
+    // it's used as the size hint of the DocTimeStamp
+    PdfRemoteSignDocumentSession session("ADES_B_LTA", Sha256Oid, inputPath, outputPath, cert, { });
+    auto signedHash = signHash(session.beginSigning());
+    auto tsr = createTimestampResponse(ssl::ComputeHash(decodeBase64(signedHash), PdfHashingAlgorithm::SHA256), 0);
+    session.finishSigning(signedHash, tsr);
+    auto digest = decodeBase64(session.beginSigningLTA());
+
+    SECTION("Token bigger than the hint")
+    {
+        // The TSA embeds its certificate in the DocTimeStamp token
+        auto ltaTsr = createTimestampResponse(digest);
+        REQUIRE(getTimestampTokenSize(ltaTsr) > getTimestampTokenSize(tsr) + 512);
+        session.finishSigningLTA(ltaTsr, nullopt);
+        verifyDocTimeStamp(outputPath, "Signature2");
+    }
+
+    SECTION("Token exceeding the reserved room")
+    {
+        // The token must be rejected before touching the document
+        REQUIRE_THROWS_AS(session.finishSigningLTA(createTimestampResponse(digest, 8), nullopt), runtime_error);
+    }
+
+    verifySignature(outputPath, "Signature");
+}
+
+TEST_CASE("TestRemoteSignPipeline")
+{
+    // Stub services answering immediately: they are called by
+    // poll() on this thread, when the document has been prepared
+    unsigned signatureCount = 0;
+    unsigned timestampCount = 0;
+    auto signingService = [&](const string& hash) {
+        signatureCount++;
+        promise<string> signature;
+        signature.set_value(signHash(hash));
+        return signature.get_future();
+    };
+    auto timestampService = [&](const string& signedHash, PdfRemoteTimestampTarget target) {
+        REQUIRE(target == PdfRemoteTimestampTarget::Signature);
+        timestampCount++;
+        promise<string> tsr;
+        tsr.set_value(createTimestampResponse(
+            ssl::ComputeHash(decodeBase64(signedHash), PdfHashingAlgorithm::SHA256)));
+        return tsr.get_future();
+    };
+
+    PdfRemoteSignPipeline pipeline(signingService, timestampService, 2);
+    auto cert = getCertificateBase64();
+    vector<string> outputPaths;
+    vector<future<void>> results;
+    for (unsigned i = 0; i < 4; i++)
+    {
+        auto name = "TestRemoteSignPipeline" + std::to_string(i);
+        outputPaths.push_back(TestUtils::GetTestOutputFilePath(name + ".pdf"));
+        results.push_back(pipeline.submit(std::make_unique<PdfRemoteSignDocumentSession>(
+            i % 2 == 0 ? "ADES_B_B" : "ADES_B_T", Sha256Oid, createInputDocument(name), outputPaths.back(), cert,
+            vector<string>())));
+    }
+
+    // A document failing to be prepared is reported by its future only
+    auto failed = pipeline.submit(std::make_unique<PdfRemoteSignDocumentSession>("ADES_B_B", Sha256Oid,
+        TestUtils::GetTestOutputFilePath("TestRemoteSignPipelineMissing.pdf"),
+        TestUtils::GetTestOutputFilePath("TestRemoteSignPipelineFailed.pdf"), cert, vector<string>()));
+
+    pipeline.drain();
+    REQUIRE(pipeline.poll() == 0);
+    REQUIRE(signatureCount == 4);
+    REQUIRE(timestampCount == 2);
+    for (unsigned i = 0; i < 4; i++)
+    {
+        results[i].get();
+        verifySignature(outputPaths[i], "Signature");
+    }
+
+    REQUIRE_THROWS(failed.get());
+}
+
+TEST_CASE("TestRemoteSignPipelineLTA")
+{
+    unsigned docTimestampCount = 0;
+    auto signingService = [](const string& hash) {
+        promise<string> signature;
+        signature.set_value(signHash(hash));
+        return signature.get_future();
+    };
+    auto timestampService = [&](const string& data, PdfRemoteTimestampTarget target) {
+        // The DocTimeStamp digest is already the message imprint
+        promise<string> tsr;
+        if (target == PdfRemoteTimestampTarget::Document)
+        {
+            docTimestampCount++;
+            tsr.set_value(createTimestampResponse(decodeBase64(data)));
+        }
+        else
+        {
+            tsr.set_value(createTimestampResponse(
+                ssl::ComputeHash(decodeBase64(data), PdfHashingAlgorithm::SHA256)));
+        }
+        return tsr.get_future();
+    };
+
+    PdfRemoteSignPipeline pipeline(signingService, timestampService, 2);
+    auto cert = getCertificateBase64();
+    vector<string> outputPaths;
+    vector<future<void>> results;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        auto name = "TestRemoteSignPipelineLTA" + std::to_string(i);
+        outputPaths.push_back(TestUtils::GetTestOutputFilePath(name + ".pdf"));
+        results.push_back(pipeline.submit(std::make_unique<PdfRemoteSignDocumentSession>(
+            "ADES_B_LTA", Sha256Oid, createInputDocument(name), outputPaths.back(), cert,
+            vector<string>())));
+    }
+
+    pipeline.drain();
+    REQUIRE(docTimestampCount == 3);
+    for (unsigned i = 0; i < 3; i++)
+    {
+        results[i].get();
+        verifySignature(outputPaths[i], "Signature");
+        verifyDocTimeStamp(outputPaths[i], "Signature2");
+    }
+}
+
+TEST_CASE("TestRemoteSignPipelineSignerFailure")
+{
+    auto signingService = [](const string&) {
+        promise<string> signature;
+        signature.set_exception(make_exception_ptr(runtime_error("The remote signer is unavailable")));
+        return signature.get_future();
+    };
+
+    PdfRemoteSignPipeline pipeline(signingService);
+    auto result = pipeline.submit(std::make_unique<PdfRemoteSignDocumentSession>("ADES_B_B", Sha256Oid,
+        createInputDocument("TestRemoteSignPipelineSignerFailure"),
+        TestUtils::GetTestOutputFilePath("TestRemoteSignPipelineSignerFailure.pdf"),
+        getCertificateBase64(), vector<string>()));
+
+    // A timestamped document needs a timestamp service
+    auto missingTsa = pipeline.submit(std::make_unique<PdfRemoteSignDocumentSession>("ADES_B_T", Sha256Oid,
+        createInputDocument("TestRemoteSignPipelineMissingTsa"),
+        TestUtils::GetTestOutputFilePath("TestRemoteSignPipelineMissingTsa.pdf"),
+        getCertificateBase64(), vector<string>()));
+
+    pipeline.drain();
+    REQUIRE_THROWS_AS(result.get(), runtime_error);
+    REQUIRE_THROWS_AS(missingTsa.get(), runtime_error);
+}
+
+TEST_CASE("TestValidationMaterialCacheTimeToLive")
+{
+    auto& cache = PdfValidationMaterialCache::instance();
+    cache.clear();
+    auto der = createCertificateDer("TestValidationMaterialCacheTimeToLive", 3600);
+
+    SECTION("Entries are reused until they expire")
+    {
+        cache.setTimeToLive(chrono::seconds(1));
+        auto material = cache.get(ValidationMaterialType::Certificate, der);
+        REQUIRE(cache.size() == 1);
+        REQUIRE(cache.get(ValidationMaterialType::Certificate, der) == material);
+        this_thread::sleep_for(chrono::milliseconds(1100));
+        REQUIRE(cache.get(ValidationMaterialType::Certificate, der) != material);
+        REQUIRE(cache.size() == 1);
+    }
+
+    SECTION("Expiration is clamped to the certificate notAfter")
+    {
+        auto material = cache.get(ValidationMaterialType::Certificate, der);
+        REQUIRE(material->expiration <= chrono::system_clock::now() + chrono::seconds(3600));
+
+        // An expired certificate is still returned, but never cached
+        auto expired = createCertificateDer("TestValidationMaterialCacheExpired", -60);
+        REQUIRE(cache.get(ValidationMaterialType::Certificate, expired) != nullptr);
+        REQUIRE(cache.size() == 1);
+    }
+
+    SECTION("Material of the wrong type is not returned")
+    {
+        REQUIRE(cache.tryGet(ValidationMaterialType::Crl, der) == nullptr);
+        REQUIRE_THROWS_AS(cache.get(ValidationMaterialType::Ocsp, der), runtime_error);
+    }
+
+    cache.setTimeToLive(chrono::seconds(3600));
+    cache.clear();
+}
+
+TEST_CASE("TestValidationMaterialCacheEviction")
+{
+    auto& cache = PdfValidationMaterialCache::instance();
+    cache.clear();
+    cache.setMaxEntries(2);
+    auto first = createCertificateDer("TestValidationMaterialCacheEviction1", 600);
+    auto second = createCertificateDer("TestValidationMaterialCacheEviction2", 1200);
+    auto third = createCertificateDer("TestValidationMaterialCacheEviction3", 1800);
+
+    (void)cache.get(ValidationMaterialType::Certificate, first);
+    auto secondMaterial = cache.get(ValidationMaterialType::Certificate, second);
+    auto thirdMaterial = cache.get(ValidationMaterialType::Certificate, third);
+    REQUIRE(cache.size() == 2);
+
+    // The entry expiring first is evicted
+    REQUIRE(cache.get(ValidationMaterialType::Certificate, second) == secondMaterial);
+    REQUIRE(cache.get(ValidationMaterialType::Certificate, third) == thirdMaterial);
+
+    // Shrinking the cache evicts immediately
+    cache.setMaxEntries(1);
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.get(ValidationMaterialType::Certificate, third) == thirdMaterial);
+
+    cache.setMaxEntries(4096);
+    cache.clear();
+}
+
+TEST_CASE("TestValidationMaterialCacheConcurrency")
+{
+    auto& cache = PdfValidationMaterialCache::instance();
+    cache.clear();
+    cache.setMaxEntries(8);
+    vector<charbuff> ders;
+    for (unsigned i = 0; i < 12; i++)
+        ders.push_back(createCertificateDer(("TestValidationMaterialCacheConcurrency" + std::to_string(i)).c_str(), 600 + i));
+
+    // Hits, misses and evictions race on the same entries
+    atomic<unsigned> failures(0);
+    vector<thread> threads;
+    for (unsigned i = 0; i < 8; i++)
+    {
+        threads.emplace_back([&, i] {
+            for (unsigned j = 0; j < 200; j++)
+            {
+                auto& der = ders[(i + j) % ders.size()];
+                auto material = cache.tryGet(ValidationMaterialType::Certificate, der);
+                if (material == nullptr || material->der != der || material->certificate == nullptr)
+                    failures++;
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    REQUIRE(failures == 0);
+    REQUIRE(cache.size() <= 8);
+
+    cache.setMaxEntries(4096);
+    cache.clear();
+}
+
+TEST_CASE("TestRemoteSignDSSUnparsableMaterial")
+{
+    auto inputPath = createInputDocument("TestRemoteSignDSSUnparsableMaterial");
+    auto outputPath = TestUtils::GetTestOutputFilePath("TestRemoteSignDSSUnparsableMaterial.pdf");
+    auto cert = getCertificateBase64();
+
+    // Material which doesn't parse is embedded as given, after the signature was written
+    PdfRemoteSignDocumentSession session("ADES_B_LT", Sha256Oid, inputPath, outputPath, cert, { });
+    auto signedHash = signHash(session.beginSigning());
+    session.finishSigning(signedHash, createTimestampResponse(
+        ssl::ComputeHash(decodeBase64(signedHash), PdfHashingAlgorithm::SHA256)),
+        ValidationData({ cert }, { "bm90IGEgQ1JM" }, { "bm90IGFuIE9DU1AgcmVzcG9uc2U=" }));
+
+    PdfMemDocument doc;
+    doc.Load(outputPath);
+    auto& dss = doc.GetCatalog().GetDictionary().MustFindKey("DSS").GetDictionary();
+    auto& crl = dss.MustFindKey("CRLs").GetArray().MustFindAt(0);
+    REQUIRE(crl.MustGetStream().GetCopy() == charbuff(string_view("not a CRL")));
+    REQUIRE(dss.MustFindKey("OCSPs").GetArray().size() == 1);
+    verifySignature(outputPath, "Signature");
+}
+
+string createInputDocument(const string_view& name)
+{
+    auto path = TestUtils::GetTestOutputFilePath(string(name) + "-input.pdf");
+    PdfMemDocument doc;
+    doc.GetPages().CreatePage(PdfPageSize::A4);
+    doc.Save(path);
+    return path;
+}
+
+string getCertificateBase64()
+{
+    string cert;
+    TestUtils::ReadTestInputFile("mycert.der", cert);
+    string ret;
+    utls::WriteBase64To(ret, cert);
+    return ret;
+}
+
+// Sign the hash returned by a session, as a remote signing service would do
+string signHash(const string& urlEncodedHash)
+{
+    string base64;
+    for (size_t i = 0; i < urlEncodedHash.size(); i++)
+    {
+        if (urlEncodedHash[i] == '%' && i + 2 < urlEncodedHash.size())
+        {
+            base64.push_back((char)std::stoi(urlEncodedHash.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else
+        {
+            base64.push_back(urlEncodedHash[i]);
+        }
+    }
+
+    auto hash = decodeBase64(base64);
+    string pkey;
+    TestUtils::ReadTestInputFile("mykey-pkcs8.der", pkey);
+    charbuff signedHash;
+    ssl::DoSign(hash, pkey, PdfHashingAlgorithm::SHA256, signedHash);
+
+    string ret;
+    utls::WriteBase64To(ret, signedHash);
+    return ret;
+}
+
+// Read the data covered by the /ByteRange of the given
+// signature field and the signature /Contents
+void readSignature(const string& filepath, const string_view& fieldName,
+    charbuff& signedData, charbuff& contents)
+{
+    charbuff buffer;
+    utls::ReadTo(buffer, filepath);
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    const PdfDictionary* sigDict = nullptr;
+    for (auto field : doc.GetFieldsIterator())
+    {
+        if (field->GetType() == PdfFieldType::Signature && field->GetFullName() == fieldName)
+        {
+            sigDict = &field->GetDictionary().MustFindKey("V").GetDictionary();
+            break;
+        }
+    }
+    REQUIRE(sigDict != nullptr);
+
+    auto& byteRange = sigDict->MustFindKey("ByteRange").GetArray();
+    REQUIRE(byteRange.size() == 4);
+    size_t offset2 = (size_t)byteRange[2].GetNumber();
+    size_t length2 = (size_t)byteRange[3].GetNumber();
+    REQUIRE(byteRange[0].GetNumber() == 0);
+    REQUIRE(offset2 + length2 <= buffer.size());
+
+    signedData.clear();
+    signedData.append(buffer.data(), (size_t)byteRange[1].GetNumber());
+    signedData.append(buffer.data() + offset2, length2);
+    contents = sigDict->MustFindKey("Contents").GetString().GetRawData();
+}
+
+// Verify the CMS signature of the given field over its /ByteRange
+void verifySignature(const string& filepath, const string_view& fieldName)
+{
+    charbuff signedData;
+    charbuff contents;
+    readSignature(filepath, fieldName, signedData, contents);
+
+    auto in = (const unsigned char*)contents.data();
+    CMS_ContentInfo* cms = d2i_CMS_ContentInfo(nullptr, &in, (long)contents.size());
+    REQUIRE(cms != nullptr);
+    BIO* data = BIO_new_mem_buf(signedData.data(), (int)signedData.size());
+    X509_STORE* store = X509_STORE_new();
+    int rc = CMS_verify(cms, nullptr, store, data, nullptr,
+        CMS_DETACHED | CMS_BINARY | CMS_NO_SIGNER_CERT_VERIFY);
+    X509_STORE_free(store);
+    BIO_free(data);
+    CMS_ContentInfo_free(cms);
+    REQUIRE(rc == 1);
+}
+
+// Verify the time stamp token of the given DocTimeStamp
+// field is valid and it covers the field /ByteRange
+void verifyDocTimeStamp(const string& filepath, const string_view& fieldName)
+{
+    charbuff signedData;
+    charbuff contents;
+    readSignature(filepath, fieldName, signedData, contents);
+
+    auto in = (const unsigned char*)contents.data();
+    CMS_ContentInfo* cms = d2i_CMS_ContentInfo(nullptr, &in, (long)contents.size());
+    REQUIRE(cms != nullptr);
+    X509_STORE* store = X509_STORE_new();
+    int rc = CMS_verify(cms, nullptr, store, nullptr, nullptr, CMS_BINARY | CMS_NO_SIGNER_CERT_VERIFY);
+    X509_STORE_free(store);
+    CMS_ContentInfo_free(cms);
+    REQUIRE(rc == 1);
+
+    in = (const unsigned char*)contents.data();
+    PKCS7* token = d2i_PKCS7(nullptr, &in, (long)contents.size());
+    REQUIRE(token != nullptr);
+    TS_TST_INFO* info = PKCS7_to_TS_TST_INFO(token);
+    REQUIRE(info != nullptr);
+    auto imprint = TS_MSG_IMPRINT_get_msg(TS_TST_INFO_get_msg_imprint(info));
+    charbuff digest((const char*)ASN1_STRING_get0_data(imprint), (size_t)ASN1_STRING_length(imprint));
+    TS_TST_INFO_free(info);
+    PKCS7_free(token);
+    REQUIRE(digest == ssl::ComputeHash(signedData, PdfHashingAlgorithm::SHA256));
+}
+
+charbuff decodeBase64(const string_view& base64)
+{
+    charbuff ret(utls::GetBase64DecodedMaxLength(base64.size()));
+    size_t written;
+    REQUIRE(utls::TryDecodeBase64(base64, ret, written));
+    ret.resize(written);
+    return ret;
+}
+
+// Create a RFC 3161 time stamp response over the given SHA-256
+// digest, as a TSA would do, with a throwaway TSA certificate. The
+// token embeds the given number of certificates, starting with the TSA one
+string createTimestampResponse(const bufferview& digest, unsigned certificateCount)
+{
+    EVP_PKEY* key = EVP_RSA_gen(2048);
+    REQUIRE(key != nullptr);
+    X509* cert = createCertificate(key, "PoDoFo Test TSA");
+    X509_EXTENSION* eku = X509V3_EXT_conf_nid(nullptr, nullptr, NID_ext_key_usage, "critical,timeStamping");
+    X509_add_ext(cert, eku, -1);
+    X509_EXTENSION_free(eku);
+    X509_sign(cert, key, EVP_sha256());
+
+    STACK_OF(X509)* certs = sk_X509_new_null();
+    for (unsigned i = 1; i < certificateCount; i++)
+        sk_X509_push(certs, createCertificate(key, ("PoDoFo Test CA " + std::to_string(i)).c_str()));
+
+    TS_MSG_IMPRINT* imprint = TS_MSG_IMPRINT_new();
+    X509_ALGOR* algorithm = X509_ALGOR_new();
+    X509_ALGOR_set0(algorithm, OBJ_nid2obj(NID_sha256), V_ASN1_NULL, nullptr);
+    TS_MSG_IMPRINT_set_algo(imprint, algorithm);
+    TS_MSG_IMPRINT_set_msg(imprint, (unsigned char*)digest.data(), (int)digest.size());
+    TS_REQ* request = TS_REQ_new();
+    TS_REQ_set_version(request, 1);
+    TS_REQ_set_msg_imprint(request, imprint);
+    TS_REQ_set_cert_req(request, certificateCount == 0 ? 0 : 1);
+    BIO* requestBio = BIO_new(BIO_s_mem());
+    i2d_TS_REQ_bio(requestBio, request);
+
+    TS_RESP_CTX* ctx = TS_RESP_CTX_new();
+    REQUIRE(TS_RESP_CTX_set_signer_cert(ctx, cert) == 1);
+    TS_RESP_CTX_set_signer_key(ctx, key);
+    TS_RESP_CTX_set_certs(ctx, certs);
+    ASN1_OBJECT* policy = OBJ_txt2obj("1.2.3.4.1", 1);
+    TS_RESP_CTX_set_def_policy(ctx, policy);
+    TS_RESP_CTX_add_md(ctx, EVP_sha256());
+    TS_RESP* response = TS_RESP_create_response(ctx, requestBio);
+    REQUIRE(response != nullptr);
+
+    unsigned char* encoded = nullptr;
+    int length = i2d_TS_RESP(response, &encoded);
+    REQUIRE(length > 0);
+    string ret;
+    utls::WriteBase64To(ret, bufferview((const char*)encoded, (size_t)length));
+
+    OPENSSL_free(encoded);
+    TS_RESP_free(response);
+    TS_RESP_CTX_free(ctx);
+    ASN1_OBJECT_free(policy);
+    BIO_free(requestBio);
+    TS_REQ_free(request);
+    TS_MSG_IMPRINT_free(imprint);
+    X509_ALGOR_free(algorithm);
+    sk_X509_pop_free(certs, X509_free);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ret;
+}
+
+// Create a self-signed certificate for the given key
+X509* createCertificate(EVP_PKEY* key, const char* name, long validity)
+{
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), -3600);
+    X509_gmtime_adj(X509_getm_notAfter(cert), validity);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN", MBSTRING_ASC,
+        (const unsigned char*)name, -1, -1, 0);
+    X509_set_issuer_name(cert, X509_get_subject_name(cert));
+    X509_set_pubkey(cert, key);
+    X509_sign(cert, key, EVP_sha256());
+    return cert;
+}
+
+charbuff createCertificateDer(const char* name, long validity)
+{
+    static unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key(EVP_RSA_gen(2048), EVP_PKEY_free);
+    X509* cert = createCertificate(key.get(), name, validity);
+    unsigned char* der = nullptr;
+    int size = i2d_X509(cert, &der);
+    charbuff ret((const char*)der, (size_t)size);
+    OPENSSL_free(der);
+    X509_free(cert);
+    return ret;
+}
+
+size_t getTimestampTokenSize(const string& base64Tsr)
+{
+    auto tsr = decodeBase64(base64Tsr);
+    auto in = (const unsigned char*)tsr.data();
+    TS_RESP* response = d2i_TS_RESP(nullptr, &in, (long)tsr.size());
+    REQUIRE(response != nullptr);
+    int size = i2d_PKCS7(TS_RESP_get_token(response), nullptr);
+    TS_RESP_free(response);
+    return (size_t)size;
+}
+
+// Get the offsets of the xref sections of all the
+// revisions, from the first to the last one
+vector<size_t> getRevisionXRefOffsets(const bufferview& buffer)
+{
+    vector<size_t> ret;
+    string_view view(buffer.data(), buffer.size());
+    size_t pos = 0;
+    while ((pos = view.find("startxref", pos)) != string_view::npos)
+    {
+        pos += char_traits<char>::length("startxref");
+        ret.push_back((size_t)std::stoull(string(view.substr(pos, 32))));
+    }
+    return ret;
+}
@@ -11,6 +11,73 @@ using namespace PoDoFo;
 
 constexpr string_view TestSignatureRefHash = "1CC60CEA1A7A8D3ECDD18B20FAAAEFE7"sv;
 
+static void verifySignature(const bufferview& buffer, const string_view& fieldName);
+
+namespace PoDoFo
+{
+    class PdfSigningTest
+    {
+    public:
+        static void TestMultipleSigners();
+    };
+}
+
+METHOD_AS_TEST_CASE(PdfSigningTest::TestMultipleSigners, "TestMultipleSigners")
+
+namespace
+{
+    // Signer that just digests the data it's fed with
+    class DigestSigner final : public PdfSigner
+    {
+    public:
+        DigestSigner(PdfHashingAlgorithm hashing)
+            : m_hashing(hashing) { }
+
+        void Reset() override
+        {
+            m_data.clear();
+        }
+
+        void AppendData(const bufferview& data) override
+        {
+            m_data.append(data.data(), data.size());
+        }
+
+        void ComputeSignature(charbuff& contents, bool dryrun) override
+        {
+            (void)dryrun;
+            contents = ssl::ComputeHash(m_data, m_hashing);
+        }
+
+        void FetchIntermediateResult(charbuff& result) override
+        {
+            result = ssl::ComputeHash(m_data, m_hashing);
+        }
+
+        void ComputeSignatureDeferred(const bufferview& processedResult, charbuff& contents, bool dryrun) override
+        {
+            if (dryrun)
+                contents.resize(ssl::GetEVP_Size(m_hashing));
+            else
+                contents = processedResult;
+        }
+
+        string GetSignatureSubFilter() const override
+        {
+            return "adbe.pkcs7.detached";
+        }
+
+        string GetSignatureType() const override
+        {
+            return "Sig";
+        }
+
+    private:
+        PdfHashingAlgorithm m_hashing;
+        charbuff m_data;
+    };
+}
+
 TEST_CASE("TestLoadCertificate")
 {
     // Load a PEM certificate should fail
@@ -18,7 +85,7 @@ TEST_CASE("TestLoadCertificate")
     string cert;
     TestUtils::ReadTestInputFile("mycert.pem", cert);
 
-    PdfSignerCms signer(cert);
+    PdfSignerCms signer(cert, { });
     try
     {
         // Dummy data append to enforce certificate load
@@ -60,7 +127,7 @@ TEST_CASE("TestSignature1")
         auto& field = dynamic_cast<PdfAnnotationWidget&>(annot).GetField();
         auto& signature = dynamic_cast<PdfSignature&>(field);
 
-        auto signer = PdfSignerCms(cert, pkey);
+        auto signer = PdfSignerCms(cert, pkey, { });
         PoDoFo::SignDocument(doc, *stream, signer, signature, PdfSaveOptions::NoMetadataUpdate);
     };
 
@@ -119,7 +186,7 @@ TEST_CASE("TestSignature2")
         (void)dryrun;
         ssl::DoSign(hashToSign, pkey, params.Hashing, signedHash);
     };
-    auto signer = PdfSignerCms(cert, params);
+    auto signer = PdfSignerCms(cert, { }, params);
     PoDoFo::SignDocument(doc, *stream, signer, signature, PdfSaveOptions::NoMetadataUpdate);
 
     utls::ReadTo(buff, outputPath);
@@ -156,7 +223,7 @@ TEST_CASE("TestSignature3")
     auto& signature = dynamic_cast<PdfSignature&>(field);
 
     PdfSignerCmsParams params;
-    auto signer = std::make_shared<PdfSignerCms>(cert, params);
+    auto signer = std::make_shared<PdfSignerCms>(cert, vector<charbuff>(), params);
     PdfSigningContext ctx;
     auto signerId = ctx.AddSigner(signature, signer);
     PdfSigningResults results;
@@ -193,7 +260,7 @@ TEST_CASE("TestSignEncryptedDoc")
         auto& page = doc.GetPages().GetPageAt(0);
         auto& signature = page.CreateField<PdfSignature>("Signature", Rect());
         signature.SetSignatureDate(date);
-        auto signer = PdfSignerCms(cert, pkey);
+        auto signer = PdfSignerCms(cert, pkey, { });
         PoDoFo::SignDocument(doc, *stream, signer, signature, PdfSaveOptions::NoMetadataUpdate);
     }
 
@@ -229,7 +296,7 @@ TEST_CASE("TestSaveOnSigning")
     painter.DrawImage(*image, 0, 0, 1, 1);
     painter.FinishDrawing();
 
-    auto signer = PdfSignerCms(x509certbuffer, pkeybuffer);
+    auto signer = PdfSignerCms(x509certbuffer, pkeybuffer, { });
 
     signature.MustGetWidget().SetAppearanceStream(*xformObj);
 
@@ -237,6 +304,71 @@ TEST_CASE("TestSaveOnSigning")
     PoDoFo::SignDocument(doc, output, signer, signature, PdfSaveOptions::SaveOnSigning);
 }
 
+TEST_CASE("TestSignObjectStreams")
+{
+    string cert;
+    TestUtils::ReadTestInputFile("mycert.der", cert);
+    string pkey;
+    TestUtils::ReadTestInputFile("mykey-pkcs8.der", pkey);
+
+    PdfMemDocument doc;
+    auto& page = doc.GetPages().CreatePage(PdfPageSize::A4);
+    auto& signature = page.CreateField<PdfSignature>("Signature", Rect(100, 600, 100, 100));
+    auto signer = PdfSignerCms(cert, pkey, { });
+
+    charbuff buffer;
+    BufferStreamDevice output(buffer);
+    PoDoFo::SignDocument(doc, output, signer, signature,
+        PdfSaveOptions::SaveOnSigning | PdfSaveOptions::ObjectStreams);
+
+    // The other objects are compressed in object streams, while the
+    // signature dictionary must be written uncompressed in place
+    REQUIRE(buffer.find("/ObjStm") != string::npos);
+    REQUIRE(buffer.find("/ByteRange") != string::npos);
+    verifySignature(buffer, "Signature");
+}
+
+TEST_CASE("TestSignParallelWrite")
+{
+    string cert;
+    TestUtils::ReadTestInputFile("mycert.der", cert);
+    string pkey;
+    TestUtils::ReadTestInputFile("mykey-pkcs8.der", pkey);
+
+    // Enough objects to be written in parallel
+    PdfMemDocument doc;
+    auto& page = TestUtils::CreateTestObjects(doc, 1000, [](PdfObject& obj, unsigned i) {
+        obj.GetDictionary().AddKey("Index"_n, static_cast<int64_t>(i));
+    });
+
+    SECTION("Signing")
+    {
+        auto& signature = page.CreateField<PdfSignature>("Signature", Rect(100, 600, 100, 100));
+        auto signer = PdfSignerCms(cert, pkey, { });
+        charbuff buffer;
+        BufferStreamDevice output(buffer);
+        PoDoFo::SignDocument(doc, output, signer, signature,
+            PdfSaveOptions::SaveOnSigning | PdfSaveOptions::ParallelWrite);
+        verifySignature(buffer, "Signature");
+    }
+
+    SECTION("Writing raw data in parallel")
+    {
+        // Raw data written by the parallel writer must
+        // record its offset in the final device
+        auto beacon = std::make_shared<size_t>(0);
+        auto& obj = doc.GetObjects().CreateDictionaryObject();
+        obj.GetDictionary().AddKey("Raw"_n, PdfVariant(PdfData(charbuff("<0123456789ABCDEF>"sv), beacon)));
+        doc.GetCatalog().GetDictionary().AddKeyIndirect("Raw"_n, obj);
+
+        charbuff buffer;
+        BufferStreamDevice output(buffer);
+        doc.Save(output, PdfSaveOptions::ParallelWrite | PdfSaveOptions::NoMetadataUpdate);
+        REQUIRE(*beacon != 0);
+        REQUIRE(string_view(buffer.data(), buffer.size()).substr(*beacon, 18) == "<0123456789ABCDEF>");
+    }
+}
+
 TEST_CASE("TestPdfSignerCms")
 {
     // X509 Certificate
@@ -245,7 +377,7 @@ TEST_CASE("TestPdfSignerCms")
 
     charbuff buff;
     {
-        PdfSignerCms signer(cert);
+        PdfSignerCms signer(cert, { });
         signer.ComputeSignatureDeferred({ }, buff, true);
 
         try
@@ -260,7 +392,7 @@ TEST_CASE("TestPdfSignerCms")
     }
 
     {
-        PdfSignerCms signer(cert);
+        PdfSignerCms signer(cert, { });
         try
         {
             signer.ComputeSignature(buff, true);
@@ -279,7 +411,7 @@ TEST_CASE("TestPdfSignerCms")
             // Do nothing
         };
 
-        PdfSignerCms signer(cert, params);
+        PdfSignerCms signer(cert, { }, params);
         signer.ComputeSignature(buff, true);
 
         try
@@ -338,3 +470,94 @@ TEST_CASE("TestGetPreviousRevision")
         REQUIRE(!signature.TryGetPreviousRevision(*input, output));
     }
 }
+
+void PdfSigningTest::TestMultipleSigners()
+{
+    PdfMemDocument doc;
+    auto& page = doc.GetPages().CreatePage(PdfPageSize::A4);
+
+    // Make the document span several read chunks
+    charbuff data(3 * 1048576 + 1000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (char)(i * 7919 % 251);
+    auto& dataObj = doc.GetObjects().CreateDictionaryObject();
+    dataObj.GetOrCreateStream().SetData(data, true);
+    doc.GetCatalog().GetDictionary().AddKeyIndirect("TestData"_n, dataObj);
+
+    PdfHashingAlgorithm hashings[] = { PdfHashingAlgorithm::SHA256,
+        PdfHashingAlgorithm::SHA384, PdfHashingAlgorithm::SHA512 };
+    vector<unique_ptr<DigestSigner>> signers;
+    vector<PdfSignerId> signerIds;
+    PdfSigningContext ctx;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        auto& signature = page.CreateField<PdfSignature>("Signature" + std::to_string(i),
+            Rect(100, 100 + i * 100, 100, 50));
+        signers.push_back(std::make_unique<DigestSigner>(hashings[i]));
+        ctx.AddSignerUnsafe(signature, *signers.back());
+        signerIds.push_back(PdfSignerId(signature.GetObject().GetIndirectReference(), 0));
+    }
+
+    charbuff buff;
+    auto device = std::make_shared<BufferStreamDevice>(buff);
+    PdfSigningResults results;
+    ctx.StartSigning(doc, device, results, PdfSaveOptions::SaveOnSigning);
+
+    // Every signer must have been fed exactly with its /ByteRange
+    for (unsigned i = 0; i < 3; i++)
+    {
+        auto prepared = ctx.GetPreparedSignature(signerIds[i]);
+        size_t byteRange[4];
+        REQUIRE(std::sscanf(buff.data() + prepared.ByteRangeOffset, "[ %zu %zu %zu %zu]",
+            &byteRange[0], &byteRange[1], &byteRange[2], &byteRange[3]) == 4);
+        REQUIRE(byteRange[0] == 0);
+        REQUIRE(byteRange[1] == prepared.ContentsOffset);
+        REQUIRE(byteRange[2] + byteRange[3] == buff.size());
+
+        charbuff signedData;
+        signedData.append(buff.data(), byteRange[1]);
+        signedData.append(buff.data() + byteRange[2], byteRange[3]);
+        REQUIRE(results.Intermediate[signerIds[i]] == ssl::ComputeHash(signedData, hashings[i]));
+    }
+}
+
+// Verify the CMS signature of the given field over its /ByteRange
+void verifySignature(const bufferview& buffer, const string_view& fieldName)
+{
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    const PdfDictionary* sigDict = nullptr;
+    for (auto field : doc.GetFieldsIterator())
+    {
+        if (field->GetType() == PdfFieldType::Signature && field->GetFullName() == fieldName)
+        {
+            sigDict = &field->GetDictionary().MustFindKey("V").GetDictionary();
+            break;
+        }
+    }
+    REQUIRE(sigDict != nullptr);
+
+    auto& byteRange = sigDict->MustFindKey("ByteRange").GetArray();
+    REQUIRE(byteRange.size() == 4);
+    REQUIRE(byteRange[0].GetNumber() == 0);
+    size_t offset2 = (size_t)byteRange[2].GetNumber();
+    size_t length2 = (size_t)byteRange[3].GetNumber();
+    REQUIRE(offset2 + length2 == buffer.size());
+
+    charbuff signedData;
+    signedData.append(buffer.data(), (size_t)byteRange[1].GetNumber());
+    signedData.append(buffer.data() + offset2, length2);
+    auto contents = sigDict->MustFindKey("Contents").GetString().GetRawData();
+
+    auto in = (const unsigned char*)contents.data();
+    CMS_ContentInfo* cms = d2i_CMS_ContentInfo(nullptr, &in, (long)contents.size());
+    REQUIRE(cms != nullptr);
+    BIO* data = BIO_new_mem_buf(signedData.data(), (int)signedData.size());
+    X509_STORE* store = X509_STORE_new();
+    int rc = CMS_verify(cms, nullptr, store, data, nullptr,
+        CMS_DETACHED | CMS_BINARY | CMS_NO_SIGNER_CERT_VERIFY);
+    X509_STORE_free(store);
+    BIO_free(data);
+    CMS_ContentInfo_free(cms);
+    REQUIRE(rc == 1);
+}
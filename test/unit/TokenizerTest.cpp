@@ -171,6 +171,39 @@ TEST_CASE("TestComments")
     TestStreamIsNextToken(pszBuffer, pszTokens);
 }
 
+TEST_CASE("TestContiguousBuffer")
+{
+    // The contiguous buffer fast path must tokenize exactly
+    // as the generic character by character one
+    string_view buffer = "1 0 obj\n<</Type/Catalog%comment\n/Kids[2 0 R 3 4 5]"
+        "/Value 12%trailing comment\n/N null>>\nendobj\n<<<>>>%eof";
+
+    SpanStreamDevice spanDevice(buffer);
+    istringstream stream((string)buffer);
+    StandardStreamDevice streamDevice(stream);
+    PdfTokenizer spanTokenizer;
+    PdfTokenizer streamTokenizer;
+    string_view spanToken;
+    string_view streamToken;
+    PdfTokenType spanType;
+    PdfTokenType streamType;
+    while (true)
+    {
+        bool gotSpanToken = spanTokenizer.TryReadNextToken(spanDevice, spanToken, spanType);
+        bool gotStreamToken = streamTokenizer.TryReadNextToken(streamDevice, streamToken, streamType);
+        REQUIRE(gotSpanToken == gotStreamToken);
+        if (!gotSpanToken)
+            break;
+
+        REQUIRE(spanToken == streamToken);
+        REQUIRE(spanType == streamType);
+        REQUIRE(spanDevice.GetPosition() == streamDevice.GetPosition());
+    }
+
+    // Lookahead for references must not consume tokens
+    Test("[1 2 3 4 0 R 5 /A]", PdfDataType::Array, "[ 1 2 3 4 0 R 5/A]");
+}
+
 TEST_CASE("TestLocale")
 {
     // Test with a locale thate uses "," instead of "." for doubles 
@@ -9,6 +9,8 @@
 #include <PdfTest.h>
 #include <podofo/private/PdfParserObject.h>
 
+#include <thread>
+
 using namespace std;
 using namespace PoDoFo;
 
@@ -170,6 +172,69 @@ TEST_CASE("TestIsDirtyFalse")
     TestObjectsDirty(objBool, objNum, objReal, objStr, objRef, objArray, objDict, objStream, objVariant, false);
 }
 
+TEST_CASE("TestDictionaryMemoryPool")
+{
+    // Dictionaries created in a thread and destroyed in another
+    // must be correctly recycled by the memory pool
+    vector<unique_ptr<PdfObject>> objs;
+    thread producer([&objs]() {
+        for (unsigned i = 0; i < 1000; i++)
+        {
+            auto obj = unique_ptr<PdfObject>(new PdfObject(PdfDictionary()));
+            auto& dict = obj->GetDictionary();
+            dict.AddKey("Type"_n, PdfName("Annot"));
+            dict.AddKey("Index"_n, static_cast<int64_t>(i));
+            dict.AddKey("Nested"_n, PdfDictionary());
+            objs.push_back(std::move(obj));
+        }
+    });
+    producer.join();
+
+    for (unsigned i = 0; i < objs.size(); i++)
+    {
+        auto& dict = objs[i]->GetDictionary();
+        REQUIRE(dict.GetSize() == 3);
+        REQUIRE(dict.MustFindKey("Index").GetNumber() == (int64_t)i);
+        dict.RemoveKey("Nested");
+        REQUIRE(dict.GetSize() == 2);
+    }
+
+    PdfDictionary copy = objs[500]->GetDictionary();
+    REQUIRE(copy == objs[500]->GetDictionary());
+    objs.clear();
+
+    thread consumer([&copy]() {
+        PdfDictionary moved(std::move(copy));
+        REQUIRE(moved.MustFindKey("Index").GetNumber() == 500);
+        for (unsigned i = 0; i < 1000; i++)
+            moved.AddKey(PdfName(utls::Format("Key{}", i)), static_cast<int64_t>(i));
+        REQUIRE(moved.GetSize() == 1002);
+    });
+    consumer.join();
+}
+
+TEST_CASE("TestDictionaryMemoryPoolRelease")
+{
+    // Chunks are released when all their blocks are freed, also
+    // the ones cached by a thread when the thread exits
+    size_t chunkCount = PdfDictionaryMemoryPool::GetChunkCount();
+    size_t peakChunkCount;
+    thread worker([&peakChunkCount]() {
+        vector<PdfDictionary> dicts(20000);
+        for (unsigned i = 0; i < dicts.size(); i++)
+        {
+            dicts[i].AddKey("Type"_n, PdfName("Annot"));
+            dicts[i].AddKey("Index"_n, static_cast<int64_t>(i));
+        }
+        peakChunkCount = PdfDictionaryMemoryPool::GetChunkCount();
+    });
+    worker.join();
+
+    // Allow one spare chunk for each block size
+    REQUIRE(peakChunkCount > chunkCount + 16);
+    REQUIRE(PdfDictionaryMemoryPool::GetChunkCount() <= chunkCount + 16);
+}
+
 void TestObjectsDirty(
     const PdfObject& objBool,
     const PdfObject& objNum,
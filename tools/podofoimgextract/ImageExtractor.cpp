@@ -25,7 +25,8 @@ ImageExtractor::ImageExtractor()
 void ImageExtractor::Init(const string_view& input, const string_view& output)
 {
     PdfMemDocument document;
-    document.Load(input);
+    // Image data is written straight from the mapped file
+    document.Load(input, { }, PdfLoadOptions::MemoryMap);
 
     m_outputDirectory = output;
 
@@ -79,9 +80,16 @@ void ImageExtractor::ExtractImage(const PdfObject& obj, bool jpeg)
 
     if (jpeg)
     {
-        auto& memprovider = dynamic_cast<const PdfMemoryObjectStream&>(obj.GetStream()->GetProvider());
-        auto& buffer = memprovider.GetBuffer();
-        fwrite(buffer.data(), buffer.size(), sizeof(char), file);
+        // Write the raw JPEG data, without copying it if possible
+        bufferview view;
+        charbuff buffer;
+        if (!obj.TryGetRawStreamView(view))
+        {
+            buffer = obj.MustGetStream().GetCopy(true);
+            view = buffer;
+        }
+
+        fwrite(view.data(), view.size(), sizeof(char), file);
     }
     else
     {